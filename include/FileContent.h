@@ -60,13 +60,11 @@ public:
 	void PushLayer(const std::string& name) {
 		layers.push_back(Layer(name));
 		ActivateLayer(layers[layers.size() - 1].GetID()); // Select just created layer
-		GeneratePreviews();
 	}
 
 	void PushLayer(Layer&& layer) {
 		layers.push_back(layer);
 		ActivateLayer(layers[layers.size() - 1].GetID()); // Select just created layer
-		GeneratePreviews();
 	}
 
 	bool ActivateLayer(LayerID id) {
@@ -131,12 +129,6 @@ public:
 		return true;
 	}
 
-	void GeneratePreviews() {
-		for (auto& layer : layers) {
-			layer.GeneratePreview();
-		}
-	}
-
 public:
 	// Correct activeLayer, if it's -1 or too large
 	void p_CorrectLayers() {
@@ -14,9 +14,16 @@ class Layer {
 	LayerID id = -1;
 	inline static LayerID nextID = 0;
 
+	// The copy of the shape the properties window edits, valid while the state has the revision
+	ShapePTR propertiesShape;
+	ShapeID propertiesShapeID = 0;
+	uint64_t propertiesRevision = 0;
+	bool propertiesChanged = false;		// An undo step was started for the shape
+
 public:
 	std::string name;
 	Battery::Bitmap previewImage;
+	uint64_t previewRevision = 0;	// Revision of the state the preview shows, see PreviewGenerator
 	bool layerChanged = false;
 
 	Layer(const std::string& name);
@@ -53,14 +60,18 @@ public:
 	void UndoAction();
 
 	void SetPreviewImage(const Battery::Bitmap& image);
-	void GeneratePreview();
 
-	std::optional<std::reference_wrapper<GenericShape>> FindShape(const ShapeID& shape);
+	std::optional<std::reference_wrapper<const GenericShape>> FindShape(const ShapeID& shape) const;
 	bool ShapeExists(const ShapeID& id) const;
+	bool ShowPropertiesWindow(const ShapeID& id);
+	std::vector<ShapeID> FindShapesNear(const glm::vec2& cursor, float thresholdDistance) const;
+	std::vector<ShapeID> FindShapesInBox(const glm::vec2& a, const glm::vec2& b) const;
+	uint64_t GetGeneration() const;
+	uint64_t GetRevision() const;
+	bool ForEachChangedShape(uint64_t since, const std::function<void(ShapeID, const ShapePTR&)>& callback) const;
 	std::pair<glm::vec2, glm::vec2> GetBoundingBox() const;
 
 	float MapFloat(float x, float in_min, float in_max, float out_min, float out_max);
-	void RenderLayerToBitmap(ALLEGRO_BITMAP* bitmap);
 
 	bool LoadJson(nlohmann::json json);
 	nlohmann::json GetJson();
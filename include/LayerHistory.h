@@ -2,36 +2,52 @@
 
 #include "pch.h"
 #include "LayerState.h"
+#include <deque>
 
+// Every undo step only stores the changes that were made during it. The shapes in these
+// changes are the previous versions, which are never shared with the current state, so
+// the memory of the history grows with the size of the edits and not with the size of the layer.
 template <size_t capacity>
 class LayerHistory {
 
-	std::vector<LayerState> states;
+	std::deque<LayerAction> actions;
 
 public:
 	LayerHistory() {}
 
-	void PushState(const LayerState& state) {
-		states.push_back(state);
+	// Starts a new undo step, all following changes are recorded into it
+	void BeginAction() {
+		if (actions.size() > 0) {
+			actions.back().copiedShapes = std::unordered_set<ShapeID>();
+		}
+		actions.emplace_back();
 
-		// Delete the first elements if there's too many
-		while (states.size() > capacity) {
-			states.erase(states.begin());
+		// Delete the oldest steps if there's too many
+		while (actions.size() > capacity) {
+			actions.pop_front();
 		}
 	}
 
-	std::pair<LayerState, bool> PopState() {
+	// The step that is currently recorded into, or nullptr if there is none
+	LayerAction* GetOpenAction() {
+		if (actions.size() == 0) {
+			return nullptr;
+		}
+		return &actions.back();
+	}
 
-		if (states.size() == 0) {
-			return std::make_pair<LayerState, bool>(LayerState(), false);
+	// Reverts all changes since the last BeginAction, returns false if there is nothing to undo
+	bool UndoAction(LayerState& state) {
+		if (actions.size() == 0) {
+			return false;
 		}
 
-		std::pair<LayerState, bool> pair = std::make_pair<LayerState, bool>(LayerState(states[states.size() - 1]), true);
-		states.pop_back();
-		return pair;
+		state.Revert(actions.back());
+		actions.pop_back();
+		return true;
 	}
 
 	void Clear() {
-		states.clear();
+		actions.clear();
 	}
 };
@@ -1,27 +1,115 @@
 #pragma once
 
 #include <vector>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
 #include "Shapes/GenericShape.h"
+#include "ShapeTree.h"
+#include "ShapeStore.h"
 
 typedef size_t LayerID;
 
+/// <summary>
+/// A single change of the shape list of a layer, with everything needed to revert it.
+/// </summary>
+struct LayerChange {
+	enum class Type {
+		INSERT,		// A shape was inserted at the index
+		ERASE,		// The shape was erased from the index
+		REPLACE		// The shape at the index was replaced by a changed copy
+	};
+
+	Type type;
+	size_t index;
+	ShapePTR shape;		// The previous shape for ERASE and REPLACE
+	size_t count = 1;	// Number of shapes that were inserted together for INSERT
+};
+
+/// <summary>
+/// All changes between two undo steps, in the order they were made.
+/// </summary>
+struct LayerAction {
+	std::vector<LayerChange> changes;
+	std::unordered_set<ShapeID> copiedShapes;	// Shapes that were already copied while this action was open
+};
+
 class LayerState {
 
 	std::vector<ShapePTR> shapes;
+	std::unordered_map<ShapeID, size_t> indices;	// Position of every shape in the vector above
+	ShapeTree tree;
+	ShapeStore store;								// Read-side cache of the geometry of the shapes above
+	uint64_t generation = 0;
+	uint64_t revision = 0;
+	inline static uint64_t nextGeneration = 1;
+	inline static uint64_t nextRevision = 1;
+
+	// The IDs of the shapes that were added, changed or removed, oldest first, and the revisions
+	// the state went through with the number of changes that were made up to each of them
+	std::vector<ShapeID> changedShapes;
+	std::vector<std::pair<uint64_t, size_t>> revisions;
+
+	void RebuildIndices();
+	void RebuildTree();
+	void RebuildStore();
+	void UpdateIndices(size_t firstIndex);
+	void NextRevision();
 
 public:
 	LayerState();
 	LayerState(const LayerState& state);
 	void operator=(const LayerState& state);
+	LayerState(LayerState&& state) noexcept;
+	void operator=(LayerState&& state) noexcept;
 	
-	void PushShape(ShapePTR&& shape);
-	bool RemoveShape(ShapeID id);
-	std::optional<std::reference_wrapper<GenericShape>> FindShape(ShapeID id);
+	// All changes are recorded into the action, if one is given
+	void PushShape(ShapePTR&& shape, LayerAction* action = nullptr);
+	void PushShapes(std::vector<ShapePTR>&& shapes, LayerAction* action = nullptr);
+	bool RemoveShape(ShapeID id, LayerAction* action = nullptr);
+	bool RemoveShapes(const std::vector<ShapeID>& ids, LayerAction* action = nullptr);
+	bool EditShape(ShapeID id, LayerAction* action, const std::function<void(GenericShape&)>& edit);
+	bool ReplaceShape(ShapeID id, ShapePTR&& shape, LayerAction* action = nullptr);
+	bool MoveShapes(const std::vector<ShapeID>& ids, const glm::vec2& amount, LayerAction* action = nullptr);
+	void Revert(const LayerAction& action);
+
+	std::optional<std::reference_wrapper<const GenericShape>> FindShape(ShapeID id) const;
 	bool ShapeExists(const ShapeID& id) const;
+
+	/// <summary>
+	/// All shapes within the threshold distance of the cursor, the nearest first.
+	/// </summary>
+	std::vector<ShapeID> FindShapesNear(const glm::vec2& cursor, float thresholdDistance) const;
+
+	/// <summary>
+	/// All shapes that are selected by a selection box with the corners a and b, in draw order.
+	/// </summary>
+	std::vector<ShapeID> FindShapesInBox(const glm::vec2& a, const glm::vec2& b) const;
 	std::pair<glm::vec2, glm::vec2> GetBoundingBox() const;
 	
 	const std::vector<ShapePTR>& GetShapes() const;
 
+	/// <summary>
+	/// Changes whenever shapes are removed or the whole state is replaced, which are the only ways
+	/// a ShapeID can become invalid. Generations are unique across all states, so a cached value
+	/// also detects a switch to a different layer.
+	/// </summary>
+	uint64_t GetGeneration() const;
+
+	/// <summary>
+	/// Changes with every change of the state. Copies keep the revision of the original,
+	/// as they show the same shapes.
+	/// </summary>
+	uint64_t GetRevision() const;
+
+	/// <summary>
+	/// Calls the function for every shape that was added, changed or removed since the state had
+	/// the given revision, with the shape or nullptr if it was removed. A shape can come more than
+	/// once. Returns false without calling it if the state never had the revision or the changes
+	/// since then were not kept, then all shapes have to be looked at again.
+	/// </summary>
+	bool ForEachChangedShape(uint64_t since, const std::function<void(ShapeID, const ShapePTR&)>& callback) const;
+
 	bool LoadJson(nlohmann::json json);
 	nlohmann::json GetJson();
 };
@@ -4,6 +4,9 @@
 #include "SketchFile.h"
 #include "ApplicationRenderer.h"
 #include "SelectionHandler.h"
+#include "ShapeBatch.h"
+#include "SnapIndex.h"
+#include "PreviewGenerator.h"
 #include "config.h"
 
 #include "Tools/SelectionTool.h"
@@ -75,12 +78,18 @@ public:
 	// Controls
 	glm::vec2 mousePosition = { 0, 0 };			// Those mouse positions are in workspace coordinates
 	glm::vec2 mouseSnapped = { 0, 0 };
+	SnapType mouseSnapType = SnapType::NONE;
+	std::optional<glm::vec2> snapReference;		// Start of the line that is being drawn, for tangent snapping
 	bool controlKeyPressed = false;
 	bool shiftKeyPressed = false;
 
 	glm::vec2 previewPointPosition = { 0, 0 };
 	bool previewPointShown = false;
 
+	std::unordered_map<LayerID, ShapeBatch> shapeBatches;	// Render data of every layer
+	PreviewGenerator previewGenerator;
+	SnapIndex snapIndex;									// Snap points of the active layer
+
 	SelectionTool selectionTool;
 	LineTool lineTool;
 	LineStripTool lineStripTool;
@@ -104,6 +113,7 @@ public:
 	glm::vec2 ConvertWorkspaceToScreenCoords(const glm::vec2& v);
 	float ConvertWorkspaceToScreenDistance(float distance);
 	float ConvertScreenToWorkspaceDistance(float distance);
+	SnapPoint GetSnappedPosition(const glm::vec2& position);
 
 	void MouseScrolled(float amount);
 	void UpdateEvents();
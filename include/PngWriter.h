@@ -0,0 +1,49 @@
+#pragma once
+
+#include "pch.h"
+
+/// <summary>
+/// Writes an RGBA PNG row by row, so the image never has to be in memory as a whole.
+/// Rows are compressed with a run-length deflate stream, which is ideal for drawings with large empty areas.
+/// </summary>
+class PngWriter {
+
+	std::ofstream file;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t rowsWritten = 0;
+
+	std::vector<uint8_t> previousRow;
+	std::vector<uint8_t> filteredRow;
+	std::vector<uint8_t> candidateRow;
+	std::vector<uint8_t> idat;		// Compressed bytes not yet written as IDAT chunk
+
+	uint32_t bitBuffer = 0;
+	int bitCount = 0;
+	int lastByte = -1;				// Previous byte of the uncompressed stream, for run-length matches
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+
+	void WriteChunk(const char* type, const uint8_t* data, size_t length);
+	void WriteBits(uint32_t bits, int count);
+	void WriteHuffman(uint32_t code, int length);
+	void WriteLiteral(int value);
+	void WriteRun(int length);
+	void Deflate(const uint8_t* data, size_t length);
+	void FlushIdat(bool force);
+
+public:
+	PngWriter() {}
+	~PngWriter();
+
+	bool Open(const std::string& path, uint32_t width, uint32_t height);
+
+	// Expects width * 4 bytes of RGBA
+	void WriteRow(const uint8_t* rgba);
+
+	// Returns false if not all rows were written or the file could not be written
+	bool Close();
+
+	// Closes the file without finishing the image, for when the caller will remove it
+	void Abort();
+};
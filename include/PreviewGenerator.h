@@ -0,0 +1,35 @@
+#pragma once
+
+#include "pch.h"
+#include "Layer.h"
+#include "ShapeBatch.h"
+#include "config.h"
+
+class SketchFile;
+
+/// <summary>
+/// Keeps the layer previews up to date. A preview is only drawn again when the revision of
+/// its own layer has changed. The drawing is spread over several frames, each frame only
+/// spends PREVIEW_FRAME_BUDGET_MS on it, and it uses the retained batch of the layer.
+/// The old preview stays visible until the new one is complete.
+/// </summary>
+class PreviewGenerator {
+
+	struct Job {
+		LayerID layer = -1;
+		uint64_t revision = 0;
+		Battery::Bitmap bitmap;
+		glm::vec2 min = { 0, 0 };
+		glm::vec2 max = { 0, 0 };
+		size_t nextShape = 0;
+	};
+
+	std::optional<Job> job;
+
+	void StartJob(const Layer& layer, const ShapeBatch& batch);
+
+public:
+	PreviewGenerator() {}
+
+	void Update(SketchFile& file, std::unordered_map<LayerID, ShapeBatch>& batches);
+};
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "Shapes/GenericShape.h"
+#include <unordered_map>
 
 class SelectionHandler {
 
 	std::vector<ShapeID> selectedShapes;
+	std::unordered_map<ShapeID, size_t> selectedIndices;	// Position of every id in selectedShapes
+	uint64_t validatedGeneration = 0;	// Layer generation the selection was last checked against
 	size_t nextPossibleIndex = 0;
 	ShapeID lastHoveredShape;
 	ShapeID shapeBelowMouse;
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "pch.h"
+#include "Shapes/GenericShape.h"
+#include <unordered_map>
+
+class Layer;
+
+/// <summary>
+/// Retained render data of one layer. The parameters of all shapes are kept in one array
+/// per primitive type and are only extracted again from shapes that changed, which is
+/// detected by the revision of the layer and the identity of the shape objects.
+/// Selection and hover are flags on the instances, so drawing needs no lookups per shape.
+/// </summary>
+class ShapeBatch {
+public:
+	enum InstanceFlags : uint32_t {
+		INSTANCE_SELECTED = 1 << 0,
+		INSTANCE_HOVERED = 1 << 1
+	};
+
+	struct LineInstance {
+		glm::vec2 p1;
+		glm::vec2 p2;
+		float thickness;
+		glm::vec4 color;
+		glm::vec2 min;
+		glm::vec2 max;
+		uint32_t flags;
+	};
+
+	struct CircleInstance {
+		glm::vec2 center;
+		float radius;
+		float thickness;
+		glm::vec4 color;
+		glm::vec2 min;
+		glm::vec2 max;
+		uint32_t flags;
+	};
+
+	struct ArcInstance {
+		glm::vec2 center;
+		float radius;
+		float startAngle;
+		float endAngle;
+		float thickness;
+		glm::vec4 color;
+		glm::vec2 min;
+		glm::vec2 max;
+		uint32_t flags;
+		ShapeID shape;		// Key of the cached tessellation
+	};
+
+private:
+	enum class Primitive {
+		NONE,
+		LINE,
+		CIRCLE,
+		ARC
+	};
+
+	struct Entry {
+		ShapePTR shape;		// Holding it makes LayerState copy the shape before it is changed
+		Primitive primitive = Primitive::NONE;
+		uint32_t instance = 0;
+	};
+
+	struct ArcTessellation {
+		float startAngle = 0;
+		float endAngle = 0;
+		int level = -1;
+		std::vector<glm::vec2> directions;	// From the center to the points of the polyline, unit length
+	};
+
+	struct EntryIndex {
+		size_t index = 0;
+		uint64_t revision = 0;	// The revision of the update that last saw the shape
+	};
+
+	std::vector<Entry> entries;							// In draw order
+	std::unordered_map<ShapeID, EntryIndex> entryIndices;
+	std::vector<LineInstance> lines;
+	std::vector<CircleInstance> circles;
+	std::vector<ArcInstance> arcs;
+	std::vector<std::pair<Primitive, uint32_t>> flagged;	// Instances which currently have flags set
+	std::vector<std::pair<Primitive, uint32_t>> runs;		// Consecutive instances of the same type, in draw order
+	mutable std::unordered_map<ShapeID, ArcTessellation> arcTessellations;	// Filled when the arcs are drawn
+	uint64_t revision = 0;
+	glm::vec2 boundsMin = { 0, 0 };
+	glm::vec2 boundsMax = { 0, 0 };
+
+	// The arrays of the previous update, kept to reuse their memory
+	std::vector<Entry> previousEntries;
+	std::vector<LineInstance> previousLines;
+	std::vector<CircleInstance> previousCircles;
+	std::vector<ArcInstance> previousArcs;
+
+	void CopyInstance(const Entry& previous);
+	uint32_t& GetFlags(Primitive primitive, uint32_t instance);
+	void UpdateBounds();
+	void UpdateRuns();
+	void DrawCircle(const CircleInstance& circle, const glm::vec4& color, const glm::vec2& visibleMin,
+		const glm::vec2& visibleMax, float pixelsPerUnit) const;
+	void DrawArc(const ArcInstance& arc, const glm::vec4& color, const glm::vec2& visibleMin,
+		const glm::vec2& visibleMax, float pixelsPerUnit) const;
+
+public:
+	ShapeBatch() {}
+
+	/// <summary>
+	/// Brings the instances up to date with the layer. Does nothing if the layer didn't change.
+	/// </summary>
+	void Update(const Layer& layer);
+
+	/// <summary>
+	/// Sets the flags of the given shapes and clears all others, in O(number of flagged shapes).
+	/// </summary>
+	void SetHighlights(const std::vector<ShapeID>& selected, ShapeID hovered);
+
+	// Called by the shapes from GenericShape::AddToBatch
+	void AddLine(const glm::vec2& p1, const glm::vec2& p2, float thickness, const glm::vec4& color);
+	void AddCircle(const glm::vec2& center, float radius, float thickness, const glm::vec4& color);
+	void AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle, float thickness, const glm::vec4& color);
+
+	/// <summary>
+	/// Draws all instances that overlap the visible workspace area in the draw order of the layer,
+	/// each run of consecutive instances of the same type in one loop. Instances of inactive layers
+	/// are drawn in the disabled color. Circles and arcs of any size are drawn as polylines, with
+	/// twice the segments for every level of detail until the deviation from the curve is below
+	/// SHAPE_LOD_MAX_ERROR pixels. Segments outside of the visible area are skipped.
+	/// </summary>
+	void Draw(const glm::vec2& visibleMin, const glm::vec2& visibleMax, float pixelsPerUnit, bool layerSelected) const;
+
+	/// <summary>
+	/// Draws the selected and hovered instances again, so that they are on top of everything else.
+	/// </summary>
+	void DrawHighlights(const glm::vec2& visibleMin, const glm::vec2& visibleMax, float pixelsPerUnit) const;
+
+	/// <summary>
+	/// Draws the shapes [first, first + count) in draw order and in their own colors into a bitmap
+	/// that shows the workspace area from min to max. Returns the index of the next shape, so that a
+	/// large layer can be drawn over several calls.
+	/// </summary>
+	size_t DrawExport(size_t first, size_t count, glm::vec2 min, glm::vec2 max, float width, float height) const;
+
+	size_t GetNumberOfInstances() const {
+		return lines.size() + circles.size() + arcs.size();
+	}
+
+	size_t GetNumberOfShapes() const {
+		return entries.size();
+	}
+
+	uint64_t GetRevision() const {
+		return revision;
+	}
+
+	// Bounding box of all instances, { 0, 0 } if the batch is empty
+	std::pair<glm::vec2, glm::vec2> GetBounds() const {
+		return std::make_pair(boundsMin, boundsMax);
+	}
+};
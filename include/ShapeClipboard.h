@@ -0,0 +1,39 @@
+#pragma once
+
+#include "pch.h"
+#include "Shapes/GenericShape.h"
+
+/// <summary>
+/// Binary clipboard payload for shapes. The parameters of every shape are written as raw
+/// floats after a one byte type, and the whole block is Base64 encoded behind a short prefix,
+/// as the clipboard only transports strings. Payloads without the prefix are read as the JSON
+/// of older versions.
+/// </summary>
+class ShapeClipboard {
+
+	enum class Record : uint8_t {
+		LINE = 1,
+		CIRCLE = 2,
+		ARC = 3
+	};
+
+	std::string data;
+	uint32_t numberOfShapes = 0;
+
+	void WriteFloats(std::initializer_list<float> values);
+
+public:
+	ShapeClipboard();
+
+	// Called by the shapes from GenericShape::AddToClipboard
+	void AddLine(const glm::vec2& p1, const glm::vec2& p2, float thickness, const glm::vec4& color);
+	void AddCircle(const glm::vec2& center, float radius, float thickness, const glm::vec4& color);
+	void AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle, float thickness, const glm::vec4& color);
+
+	std::string GetPayload() const;
+
+	/// <summary>
+	/// Creates all shapes of a binary or JSON payload. Returns nothing if the payload is invalid.
+	/// </summary>
+	static std::optional<std::vector<ShapePTR>> ReadPayload(const std::string& payload);
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "pch.h"
+#include "Shapes/GenericShape.h"
+#include <optional>
+#include <unordered_map>
+
+/// <summary>
+/// A read-side cache of the geometry of all shapes of a layer: one contiguous array per shape
+/// type, with a table from the ShapeID to the type and the position in that array. Hit tests,
+/// bounds and the boxes of the ShapeTree run as loops over this plain data instead of virtual
+/// calls on shapes that are spread over the heap. It does not replace the shape objects, which
+/// stay the owners of the data and are shared with the undo history and the caches. LayerState
+/// writes every change to both, and the geometry is held twice, which costs about 50 bytes per
+/// shape plus the handle table.
+/// The bounding boxes of the shapes and of the whole layer are kept up to date on every change,
+/// the layer bounds are only computed again when a shape on their edge was removed or moved.
+/// </summary>
+class ShapeStore {
+public:
+	struct Line {
+		glm::vec2 p1;
+		glm::vec2 p2;
+		float thickness;
+		ShapeID id;
+		glm::vec2 min;		// Bounding box, set by the store
+		glm::vec2 max;
+	};
+
+	struct Circle {
+		glm::vec2 center;
+		float radius;
+		float thickness;
+		ShapeID id;
+		glm::vec2 min;		// Bounding box, set by the store
+		glm::vec2 max;
+	};
+
+	struct Arc {
+		glm::vec2 center;
+		float radius;
+		float startAngle;
+		float endAngle;
+		float thickness;
+		ShapeID id;
+		glm::vec2 min;		// Bounding box, set by the store
+		glm::vec2 max;
+	};
+
+	struct Handle {
+		ShapeType type = ShapeType::NONE;
+		uint32_t index = 0;
+	};
+
+private:
+	std::vector<Line> lines;
+	std::vector<Circle> circles;
+	std::vector<Arc> arcs;
+	std::unordered_map<ShapeID, Handle> handles;
+	ShapeID currentShape = 0;		// The shape the Add functions write to
+
+	mutable glm::vec2 boundsMin = glm::vec2(std::numeric_limits<float>::infinity());
+	mutable glm::vec2 boundsMax = glm::vec2(-std::numeric_limits<float>::infinity());
+	mutable bool boundsValid = true;
+
+	template<typename T>
+	void Write(std::vector<T>& array, ShapeType type, const T& data);
+
+	template<typename T>
+	void Erase(std::vector<T>& array, uint32_t index);
+
+	void GrowBounds(const glm::vec2& min, const glm::vec2& max);
+	void ShrinkBounds(const glm::vec2& min, const glm::vec2& max);
+	void UpdateBounds() const;
+
+	static inline bool IsInbetween(float v, float v1, float v2) {
+		return (v < v1 && v > v2) || (v > v1 && v < v2);
+	}
+
+public:
+	ShapeStore() {}
+
+	/// <summary>
+	/// Adds the shape, or updates its data if it is already in the store.
+	/// </summary>
+	void Set(const GenericShape& shape);
+	void Remove(ShapeID id);
+	void Clear();
+
+	// Called by the shapes from GenericShape::AddToStore
+	void AddLine(const glm::vec2& p1, const glm::vec2& p2, float thickness);
+	void AddCircle(const glm::vec2& center, float radius, float thickness);
+	void AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle, float thickness);
+
+	// The shape must be in the store. The bounding box is the cached one.
+	std::pair<glm::vec2, glm::vec2> GetBoundingBox(ShapeID id) const;
+	bool IsInSelectionBox(ShapeID id, const glm::vec2& s1, const glm::vec2& s2) const;
+	float GetDistanceToCursor(ShapeID id, const glm::vec2& p) const;
+
+	/// <summary>
+	/// Moves all given shapes by the amount, shapes that are not in the store are skipped.
+	/// Returns false if any of them was not found.
+	/// </summary>
+	bool Move(const std::vector<ShapeID>& ids, const glm::vec2& amount);
+
+	/// <summary>
+	/// The bounding box of all shapes, or nothing if the store is empty. Usually it is cached,
+	/// otherwise it is reduced from the boxes of all shapes on multiple threads.
+	/// </summary>
+	std::optional<std::pair<glm::vec2, glm::vec2>> GetBoundingBox() const;
+
+	size_t GetNumberOfShapes() const {
+		return handles.size();
+	}
+
+	// The geometry of the shape types, which the shape classes use as well
+
+	static inline std::pair<glm::vec2, glm::vec2> GetBoundingBox(const Line& line) {
+		float u = line.thickness / 2.f;
+		return std::make_pair(glm::min(line.p1, line.p2) - glm::vec2(u), glm::max(line.p1, line.p2) + glm::vec2(u));
+	}
+
+	static inline std::pair<glm::vec2, glm::vec2> GetBoundingBox(const Circle& circle) {
+		float u = abs(circle.radius) + abs(circle.thickness) / 2.f;
+		return std::make_pair(circle.center - glm::vec2(u), circle.center + glm::vec2(u));
+	}
+
+	static inline std::pair<glm::vec2, glm::vec2> GetBoundingBox(const Arc& arc) {
+		float u = abs(arc.radius) + abs(arc.thickness) / 2.f;
+		return std::make_pair(arc.center - glm::vec2(u), arc.center + glm::vec2(u));
+	}
+
+	// Lines are selected by either of their points, circles and arcs by their center
+	static inline bool IsInSelectionBox(const Line& line, const glm::vec2& s1, const glm::vec2& s2) {
+		return (IsInbetween(line.p1.x, s1.x, s2.x) && IsInbetween(line.p1.y, s1.y, s2.y)) ||
+			(IsInbetween(line.p2.x, s1.x, s2.x) && IsInbetween(line.p2.y, s1.y, s2.y));
+	}
+
+	static inline bool IsInSelectionBox(const Circle& circle, const glm::vec2& s1, const glm::vec2& s2) {
+		return IsInbetween(circle.center.x, s1.x, s2.x) && IsInbetween(circle.center.y, s1.y, s2.y);
+	}
+
+	static inline bool IsInSelectionBox(const Arc& arc, const glm::vec2& s1, const glm::vec2& s2) {
+		return IsInbetween(arc.center.x, s1.x, s2.x) && IsInbetween(arc.center.y, s1.y, s2.y);
+	}
+
+	static inline float GetDistanceToCursor(const Line& line, const glm::vec2& p) {
+		glm::vec2 aToB = line.p2 - line.p1;
+		float length = glm::length(aToB);
+
+		if (length == 0 || glm::dot(aToB, p - line.p1) < 0) {
+			return glm::distance(line.p1, p);
+		}
+		else if (glm::dot(-aToB, p - line.p2) < 0) {
+			return glm::distance(line.p2, p);
+		}
+		return abs(aToB.y * p.x - aToB.x * p.y + line.p2.x * line.p1.y - line.p2.y * line.p1.x) / length;
+	}
+
+	// Circles and arcs can also be picked at their center
+	static inline float GetDistanceToCursor(const Circle& circle, const glm::vec2& p) {
+		float centerDistance = glm::distance(p, circle.center);
+		return std::min(abs(centerDistance - circle.radius), centerDistance);
+	}
+
+	static inline float GetDistanceToCursor(const Arc& arc, const glm::vec2& p) {
+		float centerDistance = glm::distance(p, arc.center);
+		return std::min(abs(centerDistance - arc.radius), centerDistance);
+	}
+};
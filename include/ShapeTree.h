@@ -0,0 +1,105 @@
+#pragma once
+
+#include "pch.h"
+#include "Shapes/GenericShape.h"
+#include "config.h"
+#include <unordered_map>
+
+/// <summary>
+/// Dynamic AABB tree over the bounding boxes of the shapes in a layer. Every leaf stores
+/// a box that is enlarged by a margin, so small moves of a shape don't touch the tree at all.
+/// The tree is kept balanced with rotations like an AVL tree, queries are O(log n + k).
+/// </summary>
+class ShapeTree {
+
+	struct Node {
+		glm::vec2 min;
+		glm::vec2 max;
+		ShapeID shape = -1;
+		int32_t parent = -1;	// Doubles as the next free node when the node is unused
+		int32_t child1 = -1;
+		int32_t child2 = -1;
+		int32_t height = 0;		// 0 for leaves, -1 for unused nodes
+
+		bool IsLeaf() const {
+			return child1 == -1;
+		}
+	};
+
+	std::vector<Node> nodes;
+	std::unordered_map<ShapeID, int32_t> leaves;
+	int32_t root = -1;
+	int32_t freeList = -1;
+
+	int32_t AllocateNode();
+	void FreeNode(int32_t node);
+	void InsertLeaf(int32_t leaf);
+	void RemoveLeaf(int32_t leaf);
+	int32_t Balance(int32_t node);
+	void Refit(int32_t node);
+	int32_t BuildNodes(int32_t* leafNodes, size_t count);
+
+	static bool Overlaps(const Node& node, const glm::vec2& min, const glm::vec2& max) {
+		return node.min.x <= max.x && node.max.x >= min.x && node.min.y <= max.y && node.max.y >= min.y;
+	}
+
+public:
+	ShapeTree() {}
+
+	void Insert(ShapeID id, const std::pair<glm::vec2, glm::vec2>& bounds);
+	bool Remove(ShapeID id);
+
+	/// <summary>
+	/// Must be called after a shape has changed. Returns true if the tree had to be changed,
+	/// which only happens if the shape has left its enlarged box.
+	/// </summary>
+	bool Update(ShapeID id, const std::pair<glm::vec2, glm::vec2>& bounds);
+	void Clear();
+
+	/// <summary>
+	/// Replaces the whole tree by one built top-down from the given boxes, which is much faster
+	/// than inserting them one by one and gives a tree of minimal height.
+	/// </summary>
+	void Build(const std::vector<std::pair<ShapeID, std::pair<glm::vec2, glm::vec2>>>& shapes);
+
+	size_t GetSize() const {
+		return leaves.size();
+	}
+
+	/// <summary>
+	/// Calls callback(ShapeID) for all shapes whose enlarged box overlaps the given box.
+	/// The results are candidates, the exact test is up to the caller.
+	/// </summary>
+	template<typename Callback>
+	void Query(const glm::vec2& min, const glm::vec2& max, Callback&& callback) const {
+		if (root == -1) {
+			return;
+		}
+
+		// The tree is balanced, so the depth stays far below the size of the stack
+		int32_t stack[SHAPE_TREE_MAX_DEPTH];
+		int32_t count = 0;
+		stack[count++] = root;
+
+		while (count > 0) {
+			const Node& node = nodes[stack[--count]];
+			if (!Overlaps(node, min, max)) {
+				continue;
+			}
+
+			if (node.IsLeaf()) {
+				callback(node.shape);
+			}
+			else {
+				stack[count++] = node.child1;
+				stack[count++] = node.child2;
+			}
+		}
+	}
+};
+
+/// <summary>
+/// Compares hover and box select queries of the tree with linear scans over the same
+/// shapes and logs the timings. Started with the command line argument "benchmark".
+/// </summary>
+void BenchmarkShapeTree(size_t numberOfShapes);
@@ -14,7 +14,7 @@ public:
 	CircleShape();
 	CircleShape(const glm::vec2& center, float radius, float thickness, const glm::vec4& color);
 	CircleShape(const nlohmann::json& j);
-	ShapePTR Duplicate();
+	ShapePTR Duplicate() const;
 	std::string GetTypeString() const;
 
 	std::pair<glm::vec2, glm::vec2> GetBoundingBox() const;
@@ -44,7 +44,10 @@ public:
 
 	void OnMouseHovered(const glm::vec2& position, const glm::vec2& snapped);
 	void RenderPreview() const;
-	void Render(bool layerSelected, bool shapeSelected, bool shapeHovered) const;
+	void AddToBatch(ShapeBatch& batch) const;
+	void AddSnapFeatures(SnapIndex& index) const;
+	void AddToClipboard(ShapeClipboard& clipboard) const;
+	void AddToStore(ShapeStore& store) const;
 	void RenderExport(glm::vec2 min, glm::vec2 max, float width, float height) const;
 
 	nlohmann::json GetJson() const;
@@ -4,6 +4,10 @@
 
 typedef size_t ShapeID;
 class GenericShape;
+class ShapeBatch;
+class SnapIndex;
+class ShapeClipboard;
+class ShapeStore;
 typedef std::shared_ptr<GenericShape> ShapePTR;
 
 enum class ShapeType {
@@ -43,12 +47,13 @@ public:
 		float radius, float startAngle, float endAngle, float thickness, const glm::vec4& color);
 	static ShapePTR MakeShape(const nlohmann::json& json);
 
-	virtual ShapePTR Duplicate() = 0;
+	virtual ShapePTR Duplicate() const = 0;
 	virtual std::string GetTypeString() const = 0;
 
 	virtual std::pair<glm::vec2, glm::vec2> GetBoundingBox() const = 0;
 	virtual bool ShouldBeRendered(float screenWidth, float screenHeight) const = 0;
 	virtual bool IsInSelectionBox(const glm::vec2& s1, const glm::vec2& s2) const = 0;
+	virtual float GetDistanceToCursor(const glm::vec2& p) const = 0;
 	virtual bool IsShapeHovered(const glm::vec2& cursor, float thresholdDistance) const = 0;
 
 	virtual glm::vec2 GetCenterPosition() const = 0;
@@ -64,7 +69,10 @@ public:
 	virtual void OnMouseHovered(const glm::vec2& position, const glm::vec2& snapped) = 0;
 
 	virtual void RenderPreview() const = 0;
-	virtual void Render(bool layerSelected, bool shapeSelected, bool shapeHovered) const = 0;
+	virtual void AddToBatch(ShapeBatch& batch) const = 0;
+	virtual void AddSnapFeatures(SnapIndex& index) const = 0;
+	virtual void AddToClipboard(ShapeClipboard& clipboard) const = 0;
+	virtual void AddToStore(ShapeStore& store) const = 0;
 	virtual void RenderExport(glm::vec2 min, glm::vec2 max, float width, float height) const = 0;
 
 	virtual nlohmann::json GetJson() const = 0;
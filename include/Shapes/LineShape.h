@@ -13,7 +13,7 @@ public:
 	LineShape();
 	LineShape(const glm::vec2& p1, const glm::vec2& p2, float thickness, const glm::vec4& color);
 	LineShape(const nlohmann::json& j);
-	ShapePTR Duplicate();
+	ShapePTR Duplicate() const;
 	std::string GetTypeString() const;
 
 	std::pair<glm::vec2, glm::vec2> GetBoundingBox() const;
@@ -43,7 +43,10 @@ public:
 
 	void OnMouseHovered(const glm::vec2& position, const glm::vec2& snapped);
 	void RenderPreview() const;
-	void Render(bool layerSelected, bool shapeSelected, bool shapeHovered) const;
+	void AddToBatch(ShapeBatch& batch) const;
+	void AddSnapFeatures(SnapIndex& index) const;
+	void AddToClipboard(ShapeClipboard& clipboard) const;
+	void AddToStore(ShapeStore& store) const;
 	void RenderExport(glm::vec2 min, glm::vec2 max, float width, float height) const;
 
 	nlohmann::json GetJson() const;
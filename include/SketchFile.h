@@ -4,6 +4,7 @@
 #include "config.h"
 #include "FileContent.h"
 #include "Layer.h"
+#include "ShapeClipboard.h"
 
 /// <summary>
 /// This class guarantees, that always at least 1 layer exists
@@ -38,8 +39,22 @@ public:
 		fileChanged = true;
 	}
 
-	void GeneratePreviews() {
-		content.GeneratePreviews();
+	std::optional<std::reference_wrapper<const Layer>> FindLayer(LayerID id) {
+		auto layer = content.FindLayer(id);
+		if (layer.has_value()) {
+			return std::make_optional<std::reference_wrapper<const Layer>>(layer->get());
+		}
+		return std::nullopt;
+	}
+
+	bool SetLayerPreview(LayerID id, const Battery::Bitmap& image, uint64_t revision) {
+		auto layer = content.FindLayer(id);
+		if (layer.has_value()) {
+			layer->get().SetPreviewImage(image);
+			layer->get().previewRevision = revision;
+			return true;
+		}
+		return false;
 	}
 
 	const std::vector<Layer>& GetLayers() {
@@ -171,12 +186,8 @@ public:
 	}
 
 	void ShowPropertiesWindow(ShapeID id) {
-		auto opt = content.GetActiveLayer().FindShape(id);
-
-		if (opt.has_value()) {
-			if (opt.value().get().ShowPropertiesWindow()) {
-				fileChanged = true;
-			}
+		if (content.GetActiveLayer().ShowPropertiesWindow(id)) {
+			fileChanged = true;
 		}
 	}
 
@@ -204,6 +215,20 @@ public:
 		return json;
 	}
 
+	std::string GetClipboardPayloadFromShapes(const std::vector<ShapeID>& ids) {
+		ShapeClipboard clipboard;
+
+		for (auto id : ids) {
+			auto shape = FindShape(id);
+
+			if (shape.has_value()) {
+				shape.value().get().AddToClipboard(clipboard);
+			}
+		}
+
+		return clipboard.GetPayload();
+	}
+
 	bool ContainsChanges() {
 		return fileChanged;
 	}
@@ -213,7 +238,9 @@ public:
 	bool OpenEmptyFile();
 	bool OpenFile(const std::string& path, bool silent = false);
 	
+	bool GetExportFrame(float dpi, glm::vec2& min, glm::vec2& max, float& width, float& height);
 	Battery::Bitmap ExportImage(bool transparent = true, float dpi = 300);
+	bool ExportImageToFile(const std::string& path, bool transparent = true, float dpi = 300);
 
 	nlohmann::json GetJson() {
 		nlohmann::json j = nlohmann::json();
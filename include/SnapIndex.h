@@ -0,0 +1,126 @@
+#pragma once
+
+#include "pch.h"
+#include "Shapes/GenericShape.h"
+#include "ShapeTree.h"
+#include "config.h"
+#include <optional>
+#include <unordered_map>
+
+class Layer;
+
+enum class SnapType {
+	NONE,
+	GRID,
+	ENDPOINT,
+	MIDPOINT,
+	CENTER,
+	INTERSECTION,
+	TANGENT
+};
+
+const char* GetSnapTypeName(SnapType type);
+
+struct SnapPoint {
+	glm::vec2 position = { 0, 0 };
+	SnapType type = SnapType::NONE;
+};
+
+/// <summary>
+/// Object snapping for one layer. The fixed snap points of all shapes (endpoints, midpoints and
+/// centers) are kept in a k-d tree, the curves themselves in a ShapeTree, from which the
+/// intersections and tangents around the cursor are computed when they are asked for.
+/// An update only looks at the shapes the layer reports as changed since the last one. Their new
+/// points are appended to a short list that is scanned linearly, until the tree is rebuilt.
+/// </summary>
+class SnapIndex {
+
+	enum class Primitive {
+		NONE,
+		LINE,
+		CIRCLE,
+		ARC
+	};
+
+	struct Curve {
+		Primitive primitive = Primitive::NONE;
+		glm::vec2 p1 = { 0, 0 };		// Start and end of a line
+		glm::vec2 p2 = { 0, 0 };
+		glm::vec2 center = { 0, 0 };
+		float radius = 0;
+		float startAngle = 0;		// Degrees, counterclockwise
+		float endAngle = 0;
+	};
+
+	struct Slot {
+		ShapePTR shape;				// Holding it makes LayerState copy the shape before it is changed
+		Curve curve;
+		uint32_t version = 0;		// Points with a different version belong to a previous shape
+		uint32_t numberOfPoints = 0;
+		uint64_t revision = 0;		// The revision of the last update that looked at all shapes and saw this one
+	};
+
+	struct Feature {
+		glm::vec2 position;
+		uint32_t slot;
+		uint32_t version;
+		SnapType type;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<ShapeID, uint32_t> slotIndices;
+	ShapeTree curves;
+
+	std::vector<Feature> features;		// [0, treeSize) is the k-d tree, the rest is scanned linearly
+	size_t treeSize = 0;
+	size_t deadFeatures = 0;
+	uint64_t revision = 0;
+	uint32_t currentSlot = 0;			// The slot the Add functions write to
+
+	bool IsAlive(const Feature& feature) const {
+		return slots[feature.slot].version == feature.version;
+	}
+
+	uint32_t SetShape(const ShapePTR& shape);
+	void AddShape(uint32_t slot);
+	void RemoveShape(uint32_t slot);
+	void AddFeature(const glm::vec2& position, SnapType type);
+	void Rebuild();
+	void Build(size_t begin, size_t end, int axis);
+	void FindNearest(size_t begin, size_t end, int axis, const glm::vec2& cursor, float& bestDistance2, size_t& best) const;
+
+	static float GetDistanceToCurve(const Curve& curve, const glm::vec2& p);
+	static void AddIntersections(const Curve& a, const Curve& b, std::vector<glm::vec2>& points);
+	static void AddTangents(const Curve& curve, const glm::vec2& reference, std::vector<glm::vec2>& points);
+
+public:
+	SnapIndex() {}
+
+	/// <summary>
+	/// Brings the index up to date with the layer. Does nothing if the layer didn't change.
+	/// </summary>
+	void Update(const Layer& layer);
+
+	// Called by the shapes from GenericShape::AddSnapFeatures
+	void AddLine(const glm::vec2& p1, const glm::vec2& p2);
+	void AddCircle(const glm::vec2& center, float radius);
+	void AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle);
+
+	/// <summary>
+	/// The nearest snap point within the radius of the cursor. Tangents are only searched if
+	/// a reference point is given, they are the points where a line from there touches a curve.
+	/// </summary>
+	std::optional<SnapPoint> FindSnapPoint(const glm::vec2& cursor, float radius,
+		const std::optional<glm::vec2>& reference = std::nullopt) const;
+
+	size_t GetNumberOfFeatures() const {
+		return features.size() - deadFeatures;
+	}
+};
+
+/// <summary>
+/// Measures snap queries on a layer with the given number of lines, circles and arcs and logs
+/// the timings. Started with the command line argument "benchmark".
+/// </summary>
+void BenchmarkSnapIndex(size_t numberOfShapes);
@@ -317,7 +317,8 @@ public:
 			ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 15);
 			ImGui::Separator();
 
-			Navigator::GetInstance()->exportDPI = std::min(std::max(Navigator::GetInstance()->exportDPI, 50.f), 1000.f);
+			// Saving to a file is tiled and has no upper limit, copies to the clipboard are limited in ExportToClipboard
+			Navigator::GetInstance()->exportDPI = std::max(Navigator::GetInstance()->exportDPI, 50.f);
 
 			if (ImGui::Button("Copy to clipboard", ImVec2(120, 0))) {
 				ImGui::CloseCurrentPopup();
@@ -521,10 +522,6 @@ public:
 
 	void OnRender() override {
 
-		if (!wasMouseOnWindow && mouseOnPanel) {
-			Navigator::GetInstance()->file.GeneratePreviews();
-		}
-
 		ImGui::PushFont(GetFontContainer<FontContainer>()->segoeFont22);
 		ImGui::Text("\uE81E"); ImGui::SameLine();
 		ImGui::PopFont();
@@ -848,8 +845,8 @@ public:
 		auto nav = Navigator::GetInstance();
 
 		char str[1024];
-		snprintf(str, 1024, "Mouse: %.2f|%.2f Snap: %.2f|%.2f", nav->mousePosition.x,
-			nav->mousePosition.y, nav->mouseSnapped.x, nav->mouseSnapped.y);
+		snprintf(str, 1024, "Mouse: %.2f|%.2f Snap: %.2f|%.2f (%s)", nav->mousePosition.x,
+			nav->mousePosition.y, nav->mouseSnapped.x, nav->mouseSnapped.y, GetSnapTypeName(nav->mouseSnapType));
 		ImGui::Text(str);
 
 		ImGui::PopFont();
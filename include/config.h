@@ -11,6 +11,7 @@
 
 #define DEFAULT_FILENAME "Unnamed.tsk"
 #define CLIPBOARD_FORMAT "com.TechnicalSketcher.Shapes"
+#define CLIPBOARD_BINARY_PREFIX "TSKB1:"	// Marks binary clipboard payloads, older versions wrote JSON
 
 #define RECENT_FILES_FILENAME "recent.json"
 #define SETTINGS_FILENAME "settings.json"
@@ -26,14 +27,34 @@
 #define DEFAULT_WINDOW_HEIGHT 800
 #define SCREEN_SIZE_MARGIN 1.1f
 #define GUI_PREVIEWWINDOW_SIZE 100
+#define PREVIEW_FRAME_BUDGET_MS 2.0		// Time per frame that is spent on drawing layer previews
+#define PREVIEW_INSTANCES_PER_STEP 256	// Shapes drawn between two checks of the time budget
 
-#define MAX_NUMBER_OF_UNDOS 20
+#define MAX_NUMBER_OF_UNDOS 5000
 #define MAX_NUMBER_OF_RECENT_FILES 5
 
 #define DEFAULT_BACKGROUND_COLOR glm::vec4(255, 255, 255, 255)
 #define COLOR_TRANSPARENT glm::vec4(255, 255, 255, 0)
 #define EXPORT_BACKGROUND_COLOR glm::vec4(255, 255, 255, 255)
 #define EXPORT_FALLOFF 1
+#define EXPORT_TILE_SIZE 1024
+#define EXPORT_TILE_CULL_MARGIN 4	// Pixels
+#define EXPORT_CLIPBOARD_MAX_DPI 1000	// The image on the clipboard is not tiled, so its size is limited
+
+#define SHAPE_LOD_MAX_ERROR 0.2f		// Pixels a tessellated circle may deviate from the exact one
+#define SHAPE_LOD_MIN_SEGMENTS 8		// Segments of a full circle at the lowest level of detail,
+#define SHAPE_LOD_LEVELS 12				// doubled with every level, enough for a radius of millions of pixels
+
+#define SHAPE_TREE_MARGIN 2.f		// Workspace units a shape can move before the tree is updated
+#define SHAPE_TREE_MAX_DEPTH 128
+#define SHAPE_BOUNDS_MIN_PER_THREAD 16384	// Shapes below which the bounds of a layer are computed on one thread
+#define LAYER_CHANGES_MIN_KEPT 4096		// Changed shapes a layer remembers, or its number of shapes if that is more
+
+#define SNAP_DISTANCE 10				// Pixels around the cursor in which it snaps to shapes
+#define SNAP_MAX_CURVES 16				// Curves near the cursor that are intersected with each other
+#define SNAP_ANGLE_TOLERANCE 0.01f		// Degrees, for points on the ends of arcs
+#define SNAP_INDEX_MIN_PENDING 1024		// New snap points that are scanned linearly until the tree is rebuilt,
+#define SNAP_INDEX_PENDING_RATIO 16		// or the size of the tree divided by this, if that is more
 
 #define DEFAULT_LINE_THICKNESS 1
 #define DEFAULT_LINE_COLOR glm::vec4(0, 0, 0, 255)
@@ -3,6 +3,8 @@
 
 #include "../resource/resource.h"
 #include "Application.h"
+#include "ShapeTree.h"
+#include "SnapIndex.h"
 #include "NavigatorLayer.h"
 #include "Updater.h"
 #include "UserInterface.h"
@@ -18,6 +20,13 @@ App::App()
 
 bool App::OnStartup()
 {
+  // Only measure the spatial indices, without opening the window
+  if (args.size() >= 2 && args[1] == "benchmark") {
+    size_t numberOfShapes = args.size() >= 3 ? std::stoul(args[2]) : 50000;
+    BenchmarkShapeTree(numberOfShapes);
+    BenchmarkSnapIndex(numberOfShapes);
+    return false;
+  }
 
   Battery::Bitmap bitmap(500, 500);
 
@@ -46,7 +46,7 @@ bool Layer::AddShape(const nlohmann::json& json) {
 	ShapePTR shape = GenericShape::MakeShape(json);
 	if (shape) {
 		LOG_TRACE("Shape added to layer {} with id ", shape->GetID());
-		state.PushShape(std::move(shape));
+		state.PushShape(std::move(shape), history.GetOpenAction());
 		return true;
 	}
 	return false;
@@ -57,7 +57,7 @@ void Layer::AddShape(enum class ShapeType type, glm::vec2 p1, glm::vec2 p2, floa
 	ShapePTR shape = GenericShape::MakeShape(type, p1, p2, thickness, color);
 	if (shape) {
 		LOG_TRACE("Shape added to layer {} with id ", shape->GetID());
-		state.PushShape(std::move(shape));
+		state.PushShape(std::move(shape), history.GetOpenAction());
 	}
 }
 
@@ -66,7 +66,7 @@ void Layer::AddShape(enum class ShapeType type, glm::vec2 center, float radius,
 	ShapePTR shape = GenericShape::MakeShape(type, center, radius, thickness, color);
 	if (shape) {
 		LOG_TRACE("Shape added to layer {} with id ", shape->GetID());
-		state.PushShape(std::move(shape));
+		state.PushShape(std::move(shape), history.GetOpenAction());
 	}
 }
 
@@ -75,7 +75,7 @@ void Layer::AddShape(enum class ShapeType type, glm::vec2 center, float radius,
 	ShapePTR shape = GenericShape::MakeShape(type, center, radius, startAngle, endAngle, thickness, color);
 	if (shape) {
 		LOG_TRACE("Shape added to layer {} with id ", shape->GetID());
-		state.PushShape(std::move(shape));
+		state.PushShape(std::move(shape), history.GetOpenAction());
 	}
 }
 
@@ -95,7 +95,7 @@ bool Layer::AddShapes(const std::vector<nlohmann::json>& jsonArray) {
 	// Now apply the shapes
 	SaveState();
 	for (auto& shape : shapes) {
-		state.PushShape(std::move(shape));
+		state.PushShape(std::move(shape), history.GetOpenAction());
 	}
 	return true;
 }
@@ -103,183 +103,73 @@ bool Layer::AddShapes(const std::vector<nlohmann::json>& jsonArray) {
 void Layer::AddShapes(std::vector<ShapePTR>&& shapes) {
 	// Apply the shapes
 	SaveState();
-	for (auto& shape : shapes) {
-		state.PushShape(std::move(shape));
-	}
+	state.PushShapes(std::move(shapes), history.GetOpenAction());
 }
 
 bool Layer::RemoveShape(const ShapeID& id) {
 	SaveState();
 	LOG_TRACE("Removing shape #{}", id);
-	return state.RemoveShape(id);
+	return state.RemoveShape(id, history.GetOpenAction());
 }
 
 bool Layer::RemoveShapes(const std::vector<ShapeID>& ids) {
-	bool failed = false;
 	SaveState();
-
-	for (auto shape : ids) {
-		LOG_TRACE("Removing shape #{}", shape);
-
-		if (!state.RemoveShape(shape)) {
-			failed = true;
-		}
-	}
-
-	return !failed;
+	LOG_TRACE("Removing {} shapes", ids.size());
+	return state.RemoveShapes(ids, history.GetOpenAction());
 }
 
 bool Layer::MoveShapeLeft(const ShapeID& id, float amount) {
 	SaveState();
-	auto shape = FindShape(id);
-
-	if (shape.has_value()) {
-		shape.value().get().MoveLeft(amount);
-		return true;
-	}
-
-	return false;
+	return state.EditShape(id, history.GetOpenAction(), [&](GenericShape& shape) { shape.MoveLeft(amount); });
 }
 
 bool Layer::MoveShapeRight(const ShapeID& id, float amount) {
 	SaveState();
-	auto shape = FindShape(id);
-
-	if (shape) {
-		shape.value().get().MoveRight(amount);
-		return true;
-	}
-
-	return false;
+	return state.EditShape(id, history.GetOpenAction(), [&](GenericShape& shape) { shape.MoveRight(amount); });
 }
 
 bool Layer::MoveShapeUp(const ShapeID& id, float amount) {
 	SaveState();
-	auto shape = FindShape(id);
-
-	if (shape) {
-		shape.value().get().MoveUp(amount);
-		return true;
-	}
-
-	return false;
+	return state.EditShape(id, history.GetOpenAction(), [&](GenericShape& shape) { shape.MoveUp(amount); });
 }
 
 bool Layer::MoveShapeDown(const ShapeID& id, float amount) {
 	SaveState();
-	auto shape = FindShape(id);
-
-	if (shape) {
-		shape.value().get().MoveDown(amount);
-		return true;
-	}
-
-	return false;
+	return state.EditShape(id, history.GetOpenAction(), [&](GenericShape& shape) { shape.MoveDown(amount); });
 }
 
 bool Layer::MoveShapesLeft(const std::vector<ShapeID>& ids, float amount) {
 	SaveState();
-
-	bool failed = false;
-	for (auto id : ids) {
-		auto shape = FindShape(id);
-
-		if (shape) {
-			shape.value().get().MoveLeft(amount);
-		}
-		else {
-			failed = true;
-		}
-	}
-
-	return !failed;
+	return state.MoveShapes(ids, glm::vec2(-amount, 0), history.GetOpenAction());
 }
 
 bool Layer::MoveShapesRight(const std::vector<ShapeID>& ids, float amount) {
 	SaveState();
-
-	bool failed = false;
-	for (auto id : ids) {
-		auto shape = FindShape(id);
-
-		if (shape) {
-			shape.value().get().MoveRight(amount);
-		}
-		else {
-			failed = true;
-		}
-	}
-
-	return !failed;
+	return state.MoveShapes(ids, glm::vec2(amount, 0), history.GetOpenAction());
 }
 
 bool Layer::MoveShapesUp(const std::vector<ShapeID>& ids, float amount) {
 	SaveState();
-
-	bool failed = false;
-	for (auto id : ids) {
-		auto shape = FindShape(id);
-
-		if (shape) {
-			shape.value().get().MoveUp(amount);
-		}
-		else {
-			failed = true;
-		}
-	}
-
-	return !failed;
+	return state.MoveShapes(ids, glm::vec2(0, -amount), history.GetOpenAction());
 }
 
 bool Layer::MoveShapesDown(const std::vector<ShapeID>& ids, float amount) {
 	SaveState();
-
-	bool failed = false;
-	for (auto id : ids) {
-		auto shape = FindShape(id);
-
-		if (shape) {
-			shape.value().get().MoveDown(amount);
-		}
-		else {
-			failed = true;
-		}
-	}
-	
-	return !failed;
+	return state.MoveShapes(ids, glm::vec2(0, amount), history.GetOpenAction());
 }
 
 bool Layer::MoveShapes(const std::vector<ShapeID>& ids, glm::vec2 amount) {
 	SaveState();
-
-	bool failed = false;
-	for (auto id : ids) {
-		auto shape = FindShape(id);
-
-		if (shape) {
-			shape.value().get().Move(amount);
-		}
-		else {
-			failed = true;
-		}
-	}
-
-	return !failed;
+	return state.MoveShapes(ids, amount, history.GetOpenAction());
 }
 
 void Layer::SaveState() {
-	// Save state for undo
-	history.PushState(GetState());
+	// Start a new undo step, the following changes are recorded into it
+	history.BeginAction();
 }
 
 void Layer::UndoAction() {
-
-	auto pair = history.PopState();
-
-	if (pair.second) {
-		LoadState(pair.first);
-	}
-	else {
+	if (!history.UndoAction(state)) {
 		LOG_WARN("Can't undo action: No more actions are stored!");
 	}
 }
@@ -288,14 +178,7 @@ void Layer::SetPreviewImage(const Battery::Bitmap& image) {
 	previewImage = image;
 }
 
-void Layer::GeneratePreview() {
-	previewImage.Reset();
-	previewImage = Battery::Bitmap();
-	previewImage.CreateBitmap(GUI_PREVIEWWINDOW_SIZE, GUI_PREVIEWWINDOW_SIZE);
-	RenderLayerToBitmap(previewImage.GetAllegroBitmap());
-}
-
-std::optional<std::reference_wrapper<GenericShape>> Layer::FindShape(const ShapeID& shape) {
+std::optional<std::reference_wrapper<const GenericShape>> Layer::FindShape(const ShapeID& shape) const {
 	return state.FindShape(shape);
 }
 
@@ -303,71 +186,63 @@ bool Layer::ShapeExists(const ShapeID& id) const {
 	return state.ShapeExists(id);
 }
 
-std::pair<glm::vec2, glm::vec2> Layer::GetBoundingBox() const {
-	return state.GetBoundingBox();
-}
-
-float Layer::MapFloat(float x, float in_min, float in_max, float out_min, float out_max) {
-	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
-}
-
-void Layer::RenderLayerToBitmap(ALLEGRO_BITMAP* bitmap) {
-	const auto& shapes = GetShapes();
-
-	// Save current draw buffer to return to later
-	ALLEGRO_BITMAP* previousBuffer = al_get_target_bitmap();
-
-	ApplicationRenderer::BeginFrame();
+// The window edits a copy, so that the shape that may be shared with the history is never modified
+bool Layer::ShowPropertiesWindow(const ShapeID& id) {
+	// The shape is only copied again when it or another one was changed in the meantime
+	if (!propertiesShape || propertiesShapeID != id || propertiesRevision != state.GetRevision()) {
+		auto shape = state.FindShape(id);
+		if (!shape) {
+			propertiesShape.reset();
+			return false;
+		}
+		propertiesShape = shape.value().get().Duplicate();
+		propertiesShapeID = id;
+		propertiesRevision = state.GetRevision();
+		propertiesChanged = false;
+	}
 
-	// If no shapes, just render white
-	if (shapes.size() == 0) {
-		al_set_target_bitmap(bitmap);
-		Battery::Renderer2D::DrawBackground({ 255, 255, 255, 255 });
-		ApplicationRenderer::EndFrame();
-		al_set_target_bitmap(previousBuffer);
-		return;
+	if (!propertiesShape->ShowPropertiesWindow()) {
+		return false;
 	}
 
-	// Calculate the encapsulated frame
-	glm::vec2 min = shapes[0]->GetBoundingBox().first;
-	glm::vec2 max = shapes[0]->GetBoundingBox().second;
+	// All changes in a row to the same shape are undone together
+	if (!propertiesChanged) {
+		SaveState();
+		propertiesChanged = true;
+	}
+	if (!state.ReplaceShape(id, propertiesShape->Duplicate(), history.GetOpenAction())) {
+		return false;
+	}
+	propertiesRevision = state.GetRevision();
+	return true;
+}
 
-	for (const auto& s : shapes) {
+std::vector<ShapeID> Layer::FindShapesNear(const glm::vec2& cursor, float thresholdDistance) const {
+	return state.FindShapesNear(cursor, thresholdDistance);
+}
 
-		auto smin = s->GetBoundingBox().first;
-		auto smax = s->GetBoundingBox().second;
+std::vector<ShapeID> Layer::FindShapesInBox(const glm::vec2& a, const glm::vec2& b) const {
+	return state.FindShapesInBox(a, b);
+}
 
-		if (smin.x < min.x) min.x = smin.x;
-		if (smin.y < min.y) min.y = smin.y;
-		if (smax.x > max.x) max.x = smax.x;
-		if (smax.y > max.y) max.y = smax.y;
-	}
+uint64_t Layer::GetGeneration() const {
+	return state.GetGeneration();
+}
 
-	float brim = 1.2f;
-	glm::vec2 center = { (max.x + min.x) / 2.f, (max.y + min.y) / 2.f };
-	int width = al_get_bitmap_width(bitmap);
-	int height = al_get_bitmap_height(bitmap);
-	float range = 0;
-	if (width / (max.x - min.x) <= height / (max.y - min.y)) {	// X is larger, adapt Y
-		range = max.x - min.x;
-	}
-	else {		// Y is larger, adapt X
-		range = max.y - min.y;
-	}
-	min.x = center.x - range / 2 * brim;
-	max.x = center.x + range / 2 * brim;
-	min.y = center.y - range / 2 * brim;
-	max.y = center.y + range / 2 * brim;
+uint64_t Layer::GetRevision() const {
+	return state.GetRevision();
+}
 
-	al_set_target_bitmap(bitmap);
-	Battery::Renderer2D::DrawBackground({ 255, 255, 255, 255 });
+bool Layer::ForEachChangedShape(uint64_t since, const std::function<void(ShapeID, const ShapePTR&)>& callback) const {
+	return state.ForEachChangedShape(since, callback);
+}
 
-	for (const auto& s : shapes) {
-		s->RenderExport(min, max, width, height);
-	}
+std::pair<glm::vec2, glm::vec2> Layer::GetBoundingBox() const {
+	return state.GetBoundingBox();
+}
 
-	ApplicationRenderer::EndFrame();
-	al_set_target_bitmap(previousBuffer);
+float Layer::MapFloat(float x, float in_min, float in_max, float out_min, float out_max) {
+	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
 bool Layer::LoadJson(nlohmann::json json) {
@@ -2,61 +2,388 @@
 
 #include "pch.h"
 #include "LayerState.h"
+#include "config.h"
 
 #undef max
 #undef min
 
 LayerState::LayerState() {
+	generation = nextGeneration++;
+	NextRevision();
 }
 
+// Shapes are never modified while they are part of more than one state, see EditShape,
+// so copies of a state share them instead of duplicating every shape
 LayerState::LayerState(const LayerState& state) {
-	for (size_t i = 0; i < state.shapes.size(); i++) {
-		shapes.push_back(state.shapes[i]->Duplicate());
-	}
+	shapes = state.shapes;
+	indices = state.indices;
+	tree = state.tree;
+	store = state.store;
+	changedShapes = state.changedShapes;
+	revisions = state.revisions;
+	generation = nextGeneration++;
+	revision = state.revision;
 }
 
 void LayerState::operator=(const LayerState& state) {
-	shapes.clear();
-	for (size_t i = 0; i < state.shapes.size(); i++) {
-		shapes.push_back(state.shapes[i]->Duplicate());
+	shapes = state.shapes;
+	indices = state.indices;
+	tree = state.tree;
+	store = state.store;
+	changedShapes = state.changedShapes;
+	revisions = state.revisions;
+	generation = nextGeneration++;
+	revision = state.revision;
+}
+
+// A moved state keeps its generation, all IDs stay valid. This is what layers use when they are
+// moved around, so only real copies pay for duplicating the tree and the store
+LayerState::LayerState(LayerState&& state) noexcept {
+	*this = std::move(state);
+}
+
+void LayerState::operator=(LayerState&& state) noexcept {
+	shapes = std::move(state.shapes);
+	indices = std::move(state.indices);
+	tree = std::move(state.tree);
+	store = std::move(state.store);
+	changedShapes = std::move(state.changedShapes);
+	revisions = std::move(state.revisions);
+	generation = state.generation;
+	revision = state.revision;
+	state.generation = nextGeneration++;
+}
+
+void LayerState::RebuildIndices() {
+	indices.clear();
+	indices.reserve(shapes.size());
+	for (size_t i = 0; i < shapes.size(); i++) {
+		indices[shapes[i]->GetID()] = i;
+	}
+}
+
+void LayerState::RebuildTree() {
+	std::vector<std::pair<ShapeID, std::pair<glm::vec2, glm::vec2>>> boxes;
+	boxes.reserve(shapes.size());
+	for (auto& shape : shapes) {
+		boxes.push_back(std::make_pair(shape->GetID(), store.GetBoundingBox(shape->GetID())));
+	}
+	tree.Build(boxes);
+}
+
+void LayerState::RebuildStore() {
+	store.Clear();
+	for (auto& shape : shapes) {
+		store.Set(*shape);
 	}
 }
 
-void LayerState::PushShape(ShapePTR&& shape) {
+// Ends a change, the IDs of the shapes it touched must be in changedShapes by now. Once the
+// changes are more than the shapes, looking at all shapes is cheaper, so older ones are dropped.
+void LayerState::NextRevision() {
+	if (changedShapes.size() > std::max<size_t>(LAYER_CHANGES_MIN_KEPT, shapes.size())) {
+		changedShapes.clear();
+		revisions.clear();
+	}
+	revision = nextRevision++;
+	revisions.push_back({ revision, changedShapes.size() });
+}
+
+// Updates the indices of all shapes from the given one to the end
+void LayerState::UpdateIndices(size_t firstIndex) {
+	for (size_t i = firstIndex; i < shapes.size(); i++) {
+		indices[shapes[i]->GetID()] = i;
+	}
+}
+
+void LayerState::PushShape(ShapePTR&& shape, LayerAction* action) {
+	if (action) {
+		action->changes.push_back({ LayerChange::Type::INSERT, shapes.size(), nullptr });
+	}
+	indices[shape->GetID()] = shapes.size();
+	store.Set(*shape);
+	tree.Insert(shape->GetID(), store.GetBoundingBox(shape->GetID()));
+	changedShapes.push_back(shape->GetID());
 	shapes.push_back(std::move(shape));
+	NextRevision();
 }
 
-bool LayerState::RemoveShape(ShapeID id) {
-	for (size_t i = 0; i < shapes.size(); i++) {
-		if (shapes[i]->GetID() == id) {
-			shapes.erase(shapes.begin() + i);
-			return true;
+void LayerState::PushShapes(std::vector<ShapePTR>&& newShapes, LayerAction* action) {
+	if (newShapes.empty()) {
+		return;
+	}
+
+	// All shapes are undone in one step
+	size_t firstIndex = shapes.size();
+	if (action) {
+		action->changes.push_back({ LayerChange::Type::INSERT, firstIndex, nullptr, newShapes.size() });
+	}
+
+	shapes.reserve(firstIndex + newShapes.size());
+	indices.reserve(firstIndex + newShapes.size());
+	for (auto& shape : newShapes) {
+		store.Set(*shape);
+		changedShapes.push_back(shape->GetID());
+		shapes.push_back(std::move(shape));
+	}
+	UpdateIndices(firstIndex);
+
+	// Building a new tree is cheaper than inserting more shapes than the tree already has
+	if (shapes.size() - firstIndex > firstIndex) {
+		RebuildTree();
+	}
+	else {
+		for (size_t i = firstIndex; i < shapes.size(); i++) {
+			tree.Insert(shapes[i]->GetID(), store.GetBoundingBox(shapes[i]->GetID()));
 		}
 	}
+	NextRevision();
+}
 
-	return false;
+bool LayerState::RemoveShape(ShapeID id, LayerAction* action) {
+	auto it = indices.find(id);
+	if (it == indices.end()) {
+		return false;
+	}
+
+	// Erase instead of swapping with the last one, the order of the shapes is the draw order
+	size_t index = it->second;
+	if (action) {
+		action->changes.push_back({ LayerChange::Type::ERASE, index, shapes[index] });
+	}
+	indices.erase(it);
+	tree.Remove(id);
+	store.Remove(id);
+	changedShapes.push_back(id);
+	shapes.erase(shapes.begin() + index);
+	UpdateIndices(index);
+	generation = nextGeneration++;
+	NextRevision();
+
+	return true;
+}
+
+// Removes all shapes in a single pass, returns false if any of them did not exist
+bool LayerState::RemoveShapes(const std::vector<ShapeID>& ids, LayerAction* action) {
+	bool failed = false;
+	std::vector<bool> remove(shapes.size(), false);
+	size_t firstIndex = shapes.size();
+	for (ShapeID id : ids) {
+		auto it = indices.find(id);
+		if (it != indices.end()) {
+			remove[it->second] = true;
+			firstIndex = std::min(firstIndex, it->second);
+			tree.Remove(id);
+			store.Remove(id);
+			changedShapes.push_back(id);
+			indices.erase(it);
+		}
+		else {
+			failed = true;
+		}
+	}
+
+	// Recorded from the back, so that every index is still valid when the changes are reverted in reverse
+	if (action) {
+		for (size_t i = shapes.size(); i > firstIndex; i--) {
+			if (remove[i - 1]) {
+				action->changes.push_back({ LayerChange::Type::ERASE, i - 1, shapes[i - 1] });
+			}
+		}
+	}
+
+	size_t count = firstIndex;
+	for (size_t i = firstIndex; i < shapes.size(); i++) {
+		if (!remove[i]) {
+			shapes[count++] = std::move(shapes[i]);
+		}
+	}
+	shapes.resize(count);
+	UpdateIndices(firstIndex);
+	generation = nextGeneration++;
+	NextRevision();
+
+	return !failed;
 }
 
-std::optional<std::reference_wrapper<GenericShape>> LayerState::FindShape(ShapeID id) {
+// Shapes may be shared with copies of this state and with the undo history, so a shape is copied
+// before it is changed for the first time within an action. Later changes in the same action
+// modify that copy directly.
+bool LayerState::EditShape(ShapeID id, LayerAction* action, const std::function<void(GenericShape&)>& edit) {
+	auto it = indices.find(id);
+	if (it == indices.end()) {
+		return false;
+	}
 
-	for (auto& shape : shapes) {
-		if (shape->GetID() == id) {
-			return std::make_optional<std::reference_wrapper<GenericShape>>(*shape);
+	size_t index = it->second;
+	bool copied = action && action->copiedShapes.find(id) != action->copiedShapes.end();
+	if (!copied || shapes[index].use_count() > 1) {
+		ShapePTR copy = shapes[index]->Duplicate();
+		copy->SetID(id);
+		if (action && !copied) {
+			action->changes.push_back({ LayerChange::Type::REPLACE, index, shapes[index] });
+			action->copiedShapes.insert(id);
 		}
+		shapes[index] = std::move(copy);
+	}
+
+	edit(*shapes[index]);
+	store.Set(*shapes[index]);
+	changedShapes.push_back(id);
+	tree.Update(id, store.GetBoundingBox(id));
+	NextRevision();
+	return true;
+}
+
+bool LayerState::ReplaceShape(ShapeID id, ShapePTR&& shape, LayerAction* action) {
+	auto it = indices.find(id);
+	if (it == indices.end()) {
+		return false;
+	}
+
+	size_t index = it->second;
+	if (action && action->copiedShapes.find(id) == action->copiedShapes.end()) {
+		action->changes.push_back({ LayerChange::Type::REPLACE, index, shapes[index] });
+		action->copiedShapes.insert(id);
+	}
+	shape->SetID(id);
+	shapes[index] = std::move(shape);
+	store.Set(*shapes[index]);
+	changedShapes.push_back(id);
+	tree.Update(id, store.GetBoundingBox(id));
+	NextRevision();
+	return true;
+}
+
+// The geometry is kept twice: once in the shapes, which the undo history, the render batch and the
+// snap index share and compare by identity, and once in the store, which the queries run on. So a
+// move is two passes, the store shifts its arrays type by type and every shape that is shared is
+// copied like in EditShape and moved as well. Shapes nobody else holds are moved in place.
+bool LayerState::MoveShapes(const std::vector<ShapeID>& ids, const glm::vec2& amount, LayerAction* action) {
+	bool failed = !store.Move(ids, amount);
+
+	for (ShapeID id : ids) {
+		auto it = indices.find(id);
+		if (it == indices.end()) {
+			continue;
+		}
+
+		size_t index = it->second;
+		bool copied = action && action->copiedShapes.find(id) != action->copiedShapes.end();
+		if ((action && !copied) || shapes[index].use_count() > 1) {
+			ShapePTR copy = shapes[index]->Duplicate();
+			copy->SetID(id);
+			if (action && !copied) {
+				action->changes.push_back({ LayerChange::Type::REPLACE, index, shapes[index] });
+				action->copiedShapes.insert(id);
+			}
+			shapes[index] = std::move(copy);
+		}
+
+		shapes[index]->Move(amount);
+		tree.Update(id, store.GetBoundingBox(id));
+		changedShapes.push_back(id);
+	}
+
+	NextRevision();
+	return !failed;
+}
+
+// Undoes all changes of the action, newest first
+void LayerState::Revert(const LayerAction& action) {
+	size_t firstIndex = shapes.size();
+
+	for (auto it = action.changes.rbegin(); it != action.changes.rend(); it++) {
+		const LayerChange& change = *it;
+		switch (change.type) {
+
+		case LayerChange::Type::INSERT: {
+			for (size_t i = change.index; i < change.index + change.count; i++) {
+				ShapeID id = shapes[i]->GetID();
+				indices.erase(id);
+				tree.Remove(id);
+				store.Remove(id);
+				changedShapes.push_back(id);
+			}
+			shapes.erase(shapes.begin() + change.index, shapes.begin() + change.index + change.count);
+			firstIndex = std::min(firstIndex, change.index);
+			break;
+		}
+
+		case LayerChange::Type::ERASE:
+			store.Set(*change.shape);
+			changedShapes.push_back(change.shape->GetID());
+			tree.Insert(change.shape->GetID(), store.GetBoundingBox(change.shape->GetID()));
+			shapes.insert(shapes.begin() + change.index, change.shape);
+			firstIndex = std::min(firstIndex, change.index);
+			break;
+
+		case LayerChange::Type::REPLACE:
+			store.Set(*change.shape);
+			changedShapes.push_back(change.shape->GetID());
+			tree.Update(change.shape->GetID(), store.GetBoundingBox(change.shape->GetID()));
+			shapes[change.index] = change.shape;
+			break;
+		}
+	}
+
+	UpdateIndices(firstIndex);
+	generation = nextGeneration++;
+	NextRevision();
+}
+
+std::optional<std::reference_wrapper<const GenericShape>> LayerState::FindShape(ShapeID id) const {
+
+	auto it = indices.find(id);
+	if (it != indices.end()) {
+		return std::make_optional<std::reference_wrapper<const GenericShape>>(*shapes[it->second]);
 	}
 
 	return std::nullopt;
 }
 
 bool LayerState::ShapeExists(const ShapeID& id) const {
+	return indices.find(id) != indices.end();
+}
 
-	for (auto& shape : shapes) {
-		if (shape->GetID() == id) {
-			return true;
+std::vector<ShapeID> LayerState::FindShapesNear(const glm::vec2& cursor, float thresholdDistance) const {
+	std::vector<std::pair<float, size_t>> found;	// Distance and index
+
+	// A shape can only be within the threshold if its bounding box is
+	glm::vec2 margin = glm::vec2(thresholdDistance);
+	tree.Query(cursor - margin, cursor + margin, [&](ShapeID id) {
+		float distance = store.GetDistanceToCursor(id, cursor);
+		if (distance <= thresholdDistance) {
+			found.push_back(std::make_pair(distance, indices.at(id)));
 		}
+	});
+	std::sort(found.begin(), found.end());
+
+	std::vector<ShapeID> ids;
+	ids.reserve(found.size());
+	for (auto& pair : found) {
+		ids.push_back(shapes[pair.second]->GetID());
 	}
+	return ids;
+}
 
-	return false;
+std::vector<ShapeID> LayerState::FindShapesInBox(const glm::vec2& a, const glm::vec2& b) const {
+	std::vector<size_t> found;
+
+	// Shapes are selected by points that lie within their bounding box
+	tree.Query(glm::min(a, b), glm::max(a, b), [&](ShapeID id) {
+		if (store.IsInSelectionBox(id, a, b)) {
+			found.push_back(indices.at(id));
+		}
+	});
+	std::sort(found.begin(), found.end());
+
+	std::vector<ShapeID> ids;
+	ids.reserve(found.size());
+	for (size_t index : found) {
+		ids.push_back(shapes[index]->GetID());
+	}
+	return ids;
 }
 
 std::pair<glm::vec2, glm::vec2> LayerState::GetBoundingBox() const {
@@ -64,11 +391,10 @@ std::pair<glm::vec2, glm::vec2> LayerState::GetBoundingBox() const {
 	glm::vec2 min = { 0, 0 };
 	glm::vec2 max = { 0, 0 };
 
-	for (auto& shape : shapes) {
-		auto bound = shape->GetBoundingBox();
-
-		min = glm::min(min, bound.first);
-		max = glm::max(max, bound.second);
+	auto bound = store.GetBoundingBox();
+	if (bound.has_value()) {
+		min = glm::min(min, bound->first);
+		max = glm::max(max, bound->second);
 	}
 
 	return std::make_pair(min, max);
@@ -78,6 +404,28 @@ const std::vector<ShapePTR>& LayerState::GetShapes() const {
 	return shapes;
 }
 
+uint64_t LayerState::GetGeneration() const {
+	return generation;
+}
+
+uint64_t LayerState::GetRevision() const {
+	return revision;
+}
+
+bool LayerState::ForEachChangedShape(uint64_t since, const std::function<void(ShapeID, const ShapePTR&)>& callback) const {
+	auto it = std::lower_bound(revisions.begin(), revisions.end(), std::make_pair(since, size_t(0)));
+	if (it == revisions.end() || it->first != since) {
+		return false;
+	}
+
+	static const ShapePTR removed;
+	for (size_t i = it->second; i < changedShapes.size(); i++) {
+		auto index = indices.find(changedShapes[i]);
+		callback(changedShapes[i], index != indices.end() ? shapes[index->second] : removed);
+	}
+	return true;
+}
+
 bool LayerState::LoadJson(nlohmann::json json) {
 	try {
 		// Store all shapes temporarily
@@ -97,6 +445,13 @@ bool LayerState::LoadJson(nlohmann::json json) {
 		for (ShapePTR& shape : tempShapes) {
 			shapes.push_back(std::move(shape));
 		}
+		RebuildIndices();
+		RebuildStore();
+		RebuildTree();
+		changedShapes.clear();
+		revisions.clear();
+		generation = nextGeneration++;
+		NextRevision();
 		return true;
 	}
 	catch (...) {
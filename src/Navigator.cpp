@@ -47,19 +47,20 @@ void Navigator::OnDetach() {
 void Navigator::OnUpdate() {
 	windowSize = glm::ivec2(Battery::GetMainWindow().GetWidth(), Battery::GetMainWindow().GetHeight());
 	mousePosition = ConvertScreenToWorkspaceCoords(Battery::GetMainWindow().GetMousePosition());
-	mouseSnapped = round(mousePosition / snapSize) * snapSize;
 
 	// Key control
 	controlKeyPressed = Battery::GetApp().GetKey(ALLEGRO_KEY_LCTRL) || Battery::GetApp().GetKey(ALLEGRO_KEY_RCTRL);
 	shiftKeyPressed = Battery::GetApp().GetKey(ALLEGRO_KEY_LSHIFT) || Battery::GetApp().GetKey(ALLEGRO_KEY_RSHIFT);
-	
-	// Allow smooth positioning when CTRL is pressed
-	if (controlKeyPressed) {
-		mouseSnapped = mousePosition;
-	}
+
+	SnapPoint snap = GetSnappedPosition(mousePosition);
+	mouseSnapped = snap.position;
+	mouseSnapType = snap.type;
 
 	// Update window title
 	file.UpdateWindowTitle();
+
+	// Spend a bit of every frame on outdated layer previews
+	previewGenerator.Update(file, shapeBatches);
 	
 	// Handle all queued events
 	UpdateEvents();
@@ -171,6 +172,23 @@ float Navigator::ConvertScreenToWorkspaceDistance(float distance) {
 	return distance / scale;
 }
 
+SnapPoint Navigator::GetSnappedPosition(const glm::vec2& position) {
+
+	// Allow smooth positioning when CTRL is pressed
+	if (controlKeyPressed) {
+		return { position, SnapType::NONE };
+	}
+
+	// Points on shapes take precedence over the grid
+	snapIndex.Update(file.GetActiveLayer());
+	auto point = snapIndex.FindSnapPoint(position, ConvertScreenToWorkspaceDistance(SNAP_DISTANCE), snapReference);
+	if (point) {
+		return point.value();
+	}
+
+	return { round(position / snapSize) * snapSize, SnapType::GRID };
+}
+
 
 
 
@@ -215,12 +233,7 @@ void Navigator::UpdateEvents() {
 	// Then update mouse pressed events
 	for (Battery::MouseButtonPressedEvent event : mousePressedEventBuffer) {
 		glm::vec2 position = ConvertScreenToWorkspaceCoords({ event.x, event.y });
-		glm::vec2 snapped = round(position / snapSize) * snapSize;
-
-		// Allow smooth positioning when CTRL is pressed
-		if (controlKeyPressed) {
-			snapped = position;
-		}
+		glm::vec2 snapped = GetSnappedPosition(position).position;
 
 		// Call all event functions
 		bool left = event.button == 1;
@@ -233,12 +246,6 @@ void Navigator::UpdateEvents() {
 	// Next, mouse released events
 	for (Battery::MouseButtonReleasedEvent event : mouseReleasedEventBuffer) {
 		glm::vec2 position = ConvertScreenToWorkspaceCoords({ event.x, event.y });
-		glm::vec2 snapped = round(position / snapSize) * snapSize;
-
-		// Allow smooth positioning when CTRL is pressed
-		if (controlKeyPressed) {
-			snapped = position;
-		}
 
 		// Call all event functions
 		bool left = event.button == 1;
@@ -251,12 +258,7 @@ void Navigator::UpdateEvents() {
 	// And finally mouse moved events
 	for (Battery::MouseMovedEvent event : mouseMovedEventBuffer) {
 		glm::vec2 position = ConvertScreenToWorkspaceCoords({ event.x, event.y });
-		glm::vec2 snapped = round(position / snapSize) * snapSize;
-		
-		// Allow smooth positioning when CTRL is pressed
-		if (controlKeyPressed) {
-			snapped = position;
-		}
+		glm::vec2 snapped = GetSnappedPosition(position).position;
 		
 		OnMouseMoved(position, snapped, event.dx, event.dy);
 	}
@@ -317,6 +319,7 @@ void Navigator::UseTool(enum class ToolType tool) {
 		break;
 	}
 
+	snapReference.reset();
 	OnToolChanged();
 }
 
@@ -702,7 +705,9 @@ void Navigator::ResetViewport() {
 
 bool Navigator::ExportToClipboard() {
 	Battery::GetMainWindow().SetMouseCursor(ALLEGRO_SYSTEM_MOUSE_CURSOR_BUSY);
-	auto image = file.ExportImage(exportTransparent, exportDPI);
+
+	// The clipboard needs the whole image in one bitmap, unlike the tiled export to a file
+	auto image = file.ExportImage(exportTransparent, std::min(exportDPI, (float)EXPORT_CLIPBOARD_MAX_DPI));
 
 	if (!image)
 		return false;
@@ -723,11 +728,12 @@ bool Navigator::ExportToFile() {
 	}
 
 	// TODO: Overwrite message if png is added
-	Battery::Bitmap image = file.ExportImage(exportTransparent, exportDPI);
-	if (!image)
+	Battery::GetMainWindow().SetMouseCursor(ALLEGRO_SYSTEM_MOUSE_CURSOR_BUSY);
+	bool success = file.ExportImageToFile(filename, exportTransparent, exportDPI);
+	Battery::GetMainWindow().SetMouseCursor(ALLEGRO_SYSTEM_MOUSE_CURSOR_DEFAULT);
+	if (!success)
 		return false;
 
-	bool success = image.SaveToFile(filename);
 	Battery::ExecuteShellCommand("explorer.exe /select," + filename);
 	return success;
 }
@@ -984,10 +990,22 @@ void Navigator::AddArc(const ArcShape& arc) {
 
 
 void Navigator::RenderShapes() {
-	using namespace Battery;
-	
-	// Render in reverse order, except for the active layer
+
+	// Only shapes within the visible part of the workspace are drawn
+	glm::vec2 corner1 = ConvertScreenToWorkspaceCoords({ 0, 0 });
+	glm::vec2 corner2 = ConvertScreenToWorkspaceCoords(glm::vec2(Battery::GetMainWindow().GetWidth(),
+														 Battery::GetMainWindow().GetHeight()));
+	glm::vec2 visibleMin = glm::min(corner1, corner2);
+	glm::vec2 visibleMax = glm::max(corner1, corner2);
+
+	// Forget the batches of deleted layers
 	auto& layers = file.GetLayers();
+	for (auto it = shapeBatches.begin(); it != shapeBatches.end();) {
+		bool exists = std::any_of(layers.begin(), layers.end(), [&](const Layer& layer) { return layer.GetID() == it->first; });
+		it = exists ? std::next(it) : shapeBatches.erase(it);
+	}
+
+	// Render in reverse order, except for the active layer
 	for (size_t layerIndex = layers.size() - 1; layerIndex < layers.size(); layerIndex--) {
 		auto& layer = layers[layerIndex];
 
@@ -995,80 +1013,26 @@ void Navigator::RenderShapes() {
 			continue;
 		}
 
-		for (auto& shape : layer.GetShapes()) {
-
-			// Skip the shape if it's not on the screen
-			if (shape->ShouldBeRendered(Battery::GetMainWindow().GetWidth(), 
-										Battery::GetMainWindow().GetHeight()))
-			{
-				// Render the shape
-				ShapeID id = shape->GetID();
-				bool shapeSelected = false;
-				ShapeID shapeHovered = false;
-
-				if (selectedTool) {
-					if (selectedTool->GetType() == ToolType::SELECT) {
-						shapeSelected = static_cast<SelectionTool*>(selectedTool)->selectionHandler.IsShapeSelected(id);
-						shapeHovered = static_cast<SelectionTool*>(selectedTool)->selectionHandler.GetLastHoveredShape();
-					}
-				}
-
-				shape->Render(false, shapeSelected, id == shapeHovered);
-			}
-			else {
-				LOG_TRACE(__FUNCTION__ "(): Skipping rendering shape #{}: Not on screen", shape->GetID());
-			}
-		}
+		auto& batch = shapeBatches[layer.GetID()];
+		batch.Update(layer);
+		batch.SetHighlights({}, -1);
+		batch.Draw(visibleMin, visibleMax, scale, false);
 	}
 
 	// Now render the active layer
-	for (auto& shape : file.GetActiveLayer().GetShapes()) {
+	auto& activeLayer = file.GetActiveLayer();
+	auto& batch = shapeBatches[activeLayer.GetID()];
+	batch.Update(activeLayer);
 
-		// Skip the shape if it's not on the screen
-		if (shape->ShouldBeRendered(Battery::GetMainWindow().GetWidth(),
-			Battery::GetMainWindow().GetHeight()))
-		{
-			// Render the shape
-			ShapeID id = shape->GetID();
-			bool shapeSelected = false;
-			ShapeID shapeHovered = false;
-
-			if (selectedTool) {
-				if (selectedTool->GetType() == ToolType::SELECT) {
-					shapeSelected = static_cast<SelectionTool*>(selectedTool)->selectionHandler.IsShapeSelected(id);
-					shapeHovered = static_cast<SelectionTool*>(selectedTool)->selectionHandler.GetLastHoveredShape();
-				}
-			}
-
-			shape->Render(true, shapeSelected, id == shapeHovered);
-		}
-		else {
-			LOG_TRACE(__FUNCTION__ "(): Skipping rendering shape #{}: Not on screen", shape->GetID());
-		}
+	if (selectedTool && selectedTool->GetType() == ToolType::SELECT) {
+		auto& selectionHandler = static_cast<SelectionTool*>(selectedTool)->selectionHandler;
+		batch.SetHighlights(selectionHandler.GetSelectedShapes(), selectionHandler.GetLastHoveredShape());
+	}
+	else {
+		batch.SetHighlights({}, -1);
 	}
+	batch.Draw(visibleMin, visibleMax, scale, true);
 
 	// Now render all selected shapes again, so the highlighted ones are on top
-	for (const auto& shape : file.GetActiveLayer().GetShapes()) {
-
-		// Skip the shape if it's not on the screen
-		if (shape->ShouldBeRendered(Battery::GetMainWindow().GetWidth(),
-			Battery::GetMainWindow().GetHeight()))
-		{
-			// Render the shape on top of all others
-			ShapeID id = shape->GetID();
-			bool shapeSelected = false;
-			ShapeID shapeHovered = false;
-
-			if (selectedTool) {
-				if (selectedTool->GetType() == ToolType::SELECT) {
-					shapeSelected = static_cast<SelectionTool*>(selectedTool)->selectionHandler.IsShapeSelected(id);
-					shapeHovered = static_cast<SelectionTool*>(selectedTool)->selectionHandler.GetLastHoveredShape();
-
-					if (shapeSelected || id == shapeHovered) {
-						shape->Render(true, shapeSelected, id == shapeHovered);
-					}
-				}
-			}
-		}
-	}
+	batch.DrawHighlights(visibleMin, visibleMax, scale);
 }
@@ -0,0 +1,250 @@
+
+#include "pch.h"
+#include "PngWriter.h"
+
+#define PNG_IDAT_CHUNK_SIZE (64 * 1024)
+#define DEFLATE_MAX_RUN 258
+
+static uint32_t crcTable[256];
+
+static void InitCrcTable() {
+	static bool initialized = false;
+	if (initialized)
+		return;
+
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		crcTable[n] = c;
+	}
+	initialized = true;
+}
+
+static uint32_t UpdateCrc(uint32_t crc, const uint8_t* data, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+static void PutBigEndian(uint8_t* out, uint32_t value) {
+	out[0] = (uint8_t)(value >> 24);
+	out[1] = (uint8_t)(value >> 16);
+	out[2] = (uint8_t)(value >> 8);
+	out[3] = (uint8_t)value;
+}
+
+PngWriter::~PngWriter() {
+	if (file.is_open()) {
+		file.close();
+	}
+}
+
+bool PngWriter::Open(const std::string& path, uint32_t width, uint32_t height) {
+	InitCrcTable();
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		LOG_ERROR("Can't open '{}' for writing", path);
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+	rowsWritten = 0;
+	previousRow.assign((size_t)width * 4, 0);
+	filteredRow.resize((size_t)width * 4 + 1);
+	candidateRow.resize((size_t)width * 4 + 1);
+	idat.clear();
+	bitBuffer = 0;
+	bitCount = 0;
+	lastByte = -1;
+	adlerA = 1;
+	adlerB = 0;
+
+	const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write((const char*)signature, sizeof(signature));
+
+	uint8_t header[13];
+	PutBigEndian(header, width);
+	PutBigEndian(header + 4, height);
+	header[8] = 8;		// Bit depth
+	header[9] = 6;		// Color type RGBA
+	header[10] = 0;		// Deflate
+	header[11] = 0;		// Adaptive filtering
+	header[12] = 0;		// No interlace
+	WriteChunk("IHDR", header, sizeof(header));
+
+	// zlib header, followed by a single deflate block with the fixed Huffman codes
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	WriteBits(1, 1);	// BFINAL
+	WriteBits(1, 2);	// BTYPE = fixed Huffman
+
+	return true;
+}
+
+void PngWriter::WriteChunk(const char* type, const uint8_t* data, size_t length) {
+	uint8_t buffer[4];
+	PutBigEndian(buffer, (uint32_t)length);
+	file.write((const char*)buffer, 4);
+	file.write(type, 4);
+	if (length > 0) {
+		file.write((const char*)data, length);
+	}
+	uint32_t crc = UpdateCrc(0xFFFFFFFFu, (const uint8_t*)type, 4);
+	crc = UpdateCrc(crc, data, length) ^ 0xFFFFFFFFu;
+	PutBigEndian(buffer, crc);
+	file.write((const char*)buffer, 4);
+}
+
+void PngWriter::WriteBits(uint32_t bits, int count) {
+	bitBuffer |= bits << bitCount;
+	bitCount += count;
+	while (bitCount >= 8) {
+		idat.push_back((uint8_t)bitBuffer);
+		bitBuffer >>= 8;
+		bitCount -= 8;
+	}
+}
+
+void PngWriter::WriteHuffman(uint32_t code, int length) {
+	// Huffman codes are stored starting with the most significant bit
+	uint32_t reversed = 0;
+	for (int i = 0; i < length; i++) {
+		reversed = (reversed << 1) | ((code >> i) & 1);
+	}
+	WriteBits(reversed, length);
+}
+
+void PngWriter::WriteLiteral(int value) {
+	if (value < 144) {
+		WriteHuffman(0x30 + value, 8);
+	}
+	else if (value < 256) {
+		WriteHuffman(0x190 + value - 144, 9);
+	}
+	else if (value < 280) {
+		WriteHuffman(value - 256, 7);
+	}
+	else {
+		WriteHuffman(0xC0 + value - 280, 8);
+	}
+}
+
+// Repeats the previous byte, encoded as a match with distance 1
+void PngWriter::WriteRun(int length) {
+	static const int bases[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const int extraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+	int code = 28;
+	while (bases[code] > length) {
+		code--;
+	}
+	WriteLiteral(257 + code);
+	if (extraBits[code] > 0) {
+		WriteBits(length - bases[code], extraBits[code]);
+	}
+	WriteHuffman(0, 5);		// Distance code 0: distance 1
+}
+
+void PngWriter::Deflate(const uint8_t* data, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		adlerA = (adlerA + data[i]) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+
+	size_t i = 0;
+	while (i < length) {
+		size_t run = 0;
+		while (i + run < length && run < DEFLATE_MAX_RUN && data[i + run] == lastByte) {
+			run++;
+		}
+		if (run >= 3) {
+			WriteRun((int)run);
+			i += run;
+		}
+		else {
+			WriteLiteral(data[i]);
+			lastByte = data[i];
+			i++;
+		}
+	}
+	FlushIdat(false);
+}
+
+void PngWriter::FlushIdat(bool force) {
+	if (idat.size() >= PNG_IDAT_CHUNK_SIZE || (force && !idat.empty())) {
+		WriteChunk("IDAT", idat.data(), idat.size());
+		idat.clear();
+	}
+}
+
+void PngWriter::WriteRow(const uint8_t* rgba) {
+	if (!file.is_open() || rowsWritten >= height)
+		return;
+
+	// Pick the filter with the smallest sum of absolute differences, the usual PNG heuristic
+	size_t rowSize = (size_t)width * 4;
+	uint64_t bestScore = UINT64_MAX;
+	for (uint8_t filter = 0; filter <= 2; filter++) {
+		candidateRow[0] = filter;
+		uint64_t score = 0;
+		for (size_t x = 0; x < rowSize; x++) {
+			uint8_t predicted = 0;
+			if (filter == 1 && x >= 4) {
+				predicted = rgba[x - 4];
+			}
+			else if (filter == 2) {
+				predicted = previousRow[x];
+			}
+			uint8_t value = rgba[x] - predicted;
+			candidateRow[x + 1] = value;
+			score += value < 128 ? value : 256 - value;
+		}
+		if (score < bestScore) {
+			bestScore = score;
+			std::swap(filteredRow, candidateRow);
+		}
+	}
+
+	Deflate(filteredRow.data(), filteredRow.size());
+	memcpy(previousRow.data(), rgba, rowSize);
+	rowsWritten++;
+}
+
+bool PngWriter::Close() {
+	if (!file.is_open())
+		return false;
+
+	// Missing rows are filled with transparent pixels, so the file is still valid
+	std::vector<uint8_t> emptyRow((size_t)width * 4, 0);
+	bool complete = rowsWritten == height;
+	while (rowsWritten < height) {
+		WriteRow(emptyRow.data());
+	}
+
+	WriteLiteral(256);		// End of block
+	if (bitCount > 0) {
+		WriteBits(0, 8 - bitCount);
+	}
+	uint8_t adler[4];
+	PutBigEndian(adler, (adlerB << 16) | adlerA);
+	idat.insert(idat.end(), adler, adler + 4);
+	FlushIdat(true);
+	WriteChunk("IEND", nullptr, 0);
+
+	bool success = file.good();
+	file.close();
+	return success && complete;
+}
+
+void PngWriter::Abort() {
+	if (file.is_open()) {
+		file.close();
+	}
+}
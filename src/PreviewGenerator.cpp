@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "Battery/AllegroDeps.h"
+#include "PreviewGenerator.h"
+#include "SketchFile.h"
+#include "ApplicationRenderer.h"
+
+#include <chrono>
+
+// Prepares a new preview bitmap and the part of the workspace it shows
+void PreviewGenerator::StartJob(const Layer& layer, const ShapeBatch& batch) {
+	job.emplace();
+	job->layer = layer.GetID();
+	job->revision = layer.GetRevision();
+	job->bitmap.CreateBitmap(GUI_PREVIEWWINDOW_SIZE, GUI_PREVIEWWINDOW_SIZE);
+
+	// Square frame around all shapes, with a brim
+	auto bounds = batch.GetBounds();
+	glm::vec2 min = bounds.first;
+	glm::vec2 max = bounds.second;
+	float brim = 1.2f;
+	glm::vec2 center = { (max.x + min.x) / 2.f, (max.y + min.y) / 2.f };
+	float range = std::max(max.x - min.x, max.y - min.y);
+	job->min = center - glm::vec2(range / 2 * brim);
+	job->max = center + glm::vec2(range / 2 * brim);
+}
+
+void PreviewGenerator::Update(SketchFile& file, std::unordered_map<LayerID, ShapeBatch>& batches) {
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+	auto budget = std::chrono::duration<double, std::milli>(PREVIEW_FRAME_BUDGET_MS);
+
+	// A job for a layer that was deleted or changed again is started over
+	if (job) {
+		auto layer = file.FindLayer(job->layer);
+		if (!layer || layer->get().GetRevision() != job->revision) {
+			job.reset();
+		}
+	}
+
+	// Otherwise look for the next outdated preview
+	if (!job) {
+		for (const Layer& layer : file.GetLayers()) {
+			if (layer.previewRevision != layer.GetRevision()) {
+				auto& batch = batches[layer.GetID()];
+				batch.Update(layer);
+				StartJob(layer, batch);
+				break;
+			}
+		}
+	}
+
+	if (!job) {
+		return;
+	}
+
+	const ShapeBatch& batch = batches[job->layer];
+	int width = GUI_PREVIEWWINDOW_SIZE;
+	int height = GUI_PREVIEWWINDOW_SIZE;
+
+	// Save current draw buffer to return to later
+	ALLEGRO_BITMAP* previousBuffer = al_get_target_bitmap();
+	ApplicationRenderer::BeginFrame();
+	al_set_target_bitmap(job->bitmap.GetAllegroBitmap());
+
+	if (job->nextShape == 0) {
+		Battery::Renderer2D::DrawBackground({ 255, 255, 255, 255 });
+	}
+	while (job->nextShape < batch.GetNumberOfShapes() && Clock::now() - start < budget) {
+		job->nextShape = batch.DrawExport(job->nextShape, PREVIEW_INSTANCES_PER_STEP,
+			job->min, job->max, width, height);
+	}
+
+	ApplicationRenderer::EndFrame();
+	al_set_target_bitmap(previousBuffer);
+
+	if (job->nextShape >= batch.GetNumberOfShapes()) {
+		file.SetLayerPreview(job->layer, job->bitmap, job->revision);
+		job.reset();
+	}
+}
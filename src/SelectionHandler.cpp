@@ -5,17 +5,27 @@
 
 const std::vector<ShapeID>& SelectionHandler::GetSelectedShapes() {
 
-	std::vector<ShapeID> removeSelection;
-	for (ShapeID id : selectedShapes) {
-		if (!Navigator::GetInstance()->file.GetActiveLayer().ShapeExists(id)) {
-			removeSelection.push_back(id);
-		}
+	// Shapes can only disappear when the generation of the layer changes, only then the
+	// selection must be checked again
+	auto& layer = Navigator::GetInstance()->file.GetActiveLayer();
+	if (layer.GetGeneration() == validatedGeneration) {
+		return selectedShapes;
 	}
 
-	// Now remove all non-existing shapes
-	for (ShapeID id : removeSelection) {
-		UnselectShape(id);
+	size_t count = 0;
+	for (size_t i = 0; i < selectedShapes.size(); i++) {
+		if (layer.ShapeExists(selectedShapes[i])) {
+			selectedShapes[count++] = selectedShapes[i];
+		}
+	}
+	if (count != selectedShapes.size()) {
+		selectedShapes.resize(count);
+		selectedIndices.clear();
+		for (size_t i = 0; i < selectedShapes.size(); i++) {
+			selectedIndices[selectedShapes[i]] = i;
+		}
 	}
+	validatedGeneration = layer.GetGeneration();
 
 	return selectedShapes;
 }
@@ -23,15 +33,9 @@ const std::vector<ShapeID>& SelectionHandler::GetSelectedShapes() {
 
 
 ShapeID SelectionHandler::GetHoveredShape(const glm::vec2& mousePosition) {
-	std::vector<ShapeID> possible;
-
-	for (const auto& shape : Navigator::GetInstance()->file.GetActiveLayer().GetShapes()) {
-		float dist = Navigator::GetInstance()->ConvertScreenToWorkspaceDistance(
-			Navigator::GetInstance()->mouseHighlightThresholdDistance);
-		if (shape->IsShapeHovered(mousePosition, dist)) {
-			possible.push_back(shape->GetID());
-		}
-	}
+	float dist = Navigator::GetInstance()->ConvertScreenToWorkspaceDistance(
+		Navigator::GetInstance()->mouseHighlightThresholdDistance);
+	std::vector<ShapeID> possible = Navigator::GetInstance()->file.GetActiveLayer().FindShapesNear(mousePosition, dist);
 
 	// Reset index if out of bounds
 	if (nextPossibleIndex >= possible.size()) {
@@ -61,14 +65,7 @@ void SelectionHandler::SelectNextPossibleShape() {
 
 
 bool SelectionHandler::IsShapeSelected(ShapeID id) {
-
-	for (ShapeID shapeID : selectedShapes) {
-		if (shapeID == id) {
-			return true;
-		}
-	}
-
-	return false;
+	return selectedIndices.find(id) != selectedIndices.end();
 }
 
 bool SelectionHandler::SelectShape(ShapeID id) {
@@ -77,6 +74,7 @@ bool SelectionHandler::SelectShape(ShapeID id) {
 
 		// Shape exists, select it now if it's not already
 		if (!IsShapeSelected(id)) {
+			selectedIndices[id] = selectedShapes.size();
 			selectedShapes.push_back(id);
 		}
 		return true;
@@ -87,14 +85,21 @@ bool SelectionHandler::SelectShape(ShapeID id) {
 
 bool SelectionHandler::UnselectShape(ShapeID id) {
 
-	for (size_t i = 0; i < selectedShapes.size(); i++) {
-		if (selectedShapes[i] == id) {
-			selectedShapes.erase(selectedShapes.begin() + i);
-			return true;
-		}
+	auto it = selectedIndices.find(id);
+	if (it == selectedIndices.end()) {
+		return false;
 	}
 
-	return false;
+	// The order of the selection does not matter, so the last one takes the free place
+	size_t index = it->second;
+	selectedIndices.erase(it);
+	if (index != selectedShapes.size() - 1) {
+		selectedShapes[index] = selectedShapes.back();
+		selectedIndices[selectedShapes[index]] = index;
+	}
+	selectedShapes.pop_back();
+
+	return true;
 }
 
 bool SelectionHandler::ToggleSelection(ShapeID id) {
@@ -108,13 +113,19 @@ bool SelectionHandler::ToggleSelection(ShapeID id) {
 }
 
 void SelectionHandler::SelectAll() {
-	selectedShapes.clear();
+	ClearSelection();
 
-	for (const auto& shape : Navigator::GetInstance()->file.GetActiveLayer().GetShapes()) {
+	auto& layer = Navigator::GetInstance()->file.GetActiveLayer();
+	selectedShapes.reserve(layer.GetShapes().size());
+	selectedIndices.reserve(layer.GetShapes().size());
+	for (const auto& shape : layer.GetShapes()) {
+		selectedIndices[shape->GetID()] = selectedShapes.size();
 		selectedShapes.push_back(shape->GetID());
 	}
+	validatedGeneration = layer.GetGeneration();
 }
 
 void SelectionHandler::ClearSelection() {
 	selectedShapes.clear();
+	selectedIndices.clear();
 }
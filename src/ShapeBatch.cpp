@@ -0,0 +1,395 @@
+#include "pch.h"
+#include "ShapeBatch.h"
+#include "Layer.h"
+#include "ApplicationRenderer.h"
+#include "config.h"
+
+#undef max
+#undef min
+
+static glm::vec4 GetInstanceColor(const glm::vec4& color, uint32_t flags, bool layerSelected) {
+	auto& ref = ApplicationRenderer::GetInstance();
+
+	if (!layerSelected) {
+		return ref.disabledLineColor;
+	}
+
+	bool selected = flags & ShapeBatch::INSTANCE_SELECTED;
+	bool hovered = flags & ShapeBatch::INSTANCE_HOVERED;
+	if (selected && hovered) {
+		return (ref.hoveredLineColor + ref.selectedLineColor) / 2.f;
+	}
+	else if (selected) {
+		return ref.selectedLineColor;
+	}
+	else if (hovered) {
+		return ref.hoveredLineColor;
+	}
+	return color;
+}
+
+// The lowest level of detail whose segments deviate less than the maximum error from a circle
+// with the given radius in pixels. A segment spanning the angle a deviates by r * (1 - cos(a / 2)).
+static int GetDetailLevel(float screenRadius) {
+	if (screenRadius <= SHAPE_LOD_MAX_ERROR) {
+		return 0;
+	}
+
+	float segmentAngle = 2.f * acos(1.f - SHAPE_LOD_MAX_ERROR / screenRadius);
+	float segments = 2.f * glm::pi<float>() / segmentAngle;
+	int level = 0;
+	while (level < SHAPE_LOD_LEVELS - 1 && (SHAPE_LOD_MIN_SEGMENTS << level) < segments) {
+		level++;
+	}
+	return level;
+}
+
+// Points of a unit circle for every level of detail, shared by all circles
+static const std::vector<glm::vec2>& GetUnitCircle(int level) {
+	static std::vector<glm::vec2> circles[SHAPE_LOD_LEVELS];
+
+	auto& circle = circles[level];
+	if (circle.empty()) {
+		int segments = SHAPE_LOD_MIN_SEGMENTS << level;
+		for (int i = 0; i <= segments; i++) {
+			float angle = 2.f * glm::pi<float>() * i / segments;
+			circle.push_back(glm::vec2(cos(angle), sin(angle)));
+		}
+	}
+	return circle;
+}
+
+// Segments that are entirely on one side of the visible area are skipped, which keeps
+// arcs that are much larger than the screen cheap
+static void DrawPolyline(const glm::vec2& center, float radius, const std::vector<glm::vec2>& directions,
+	float thickness, const glm::vec4& color, const glm::vec2& visibleMin, const glm::vec2& visibleMax) {
+
+	glm::vec2 margin = glm::vec2(abs(thickness) / 2.f);
+	glm::vec2 min = visibleMin - margin;
+	glm::vec2 max = visibleMax + margin;
+
+	for (size_t i = 1; i < directions.size(); i++) {
+		glm::vec2 p1 = center + directions[i - 1] * radius;
+		glm::vec2 p2 = center + directions[i] * radius;
+		if ((p1.x < min.x && p2.x < min.x) || (p1.x > max.x && p2.x > max.x) ||
+			(p1.y < min.y && p2.y < min.y) || (p1.y > max.y && p2.y > max.y)) {
+			continue;
+		}
+		ApplicationRenderer::DrawLineWorkspace(p1, p2, thickness, color);
+	}
+}
+
+template<typename T>
+static bool IsVisible(const T& instance, const glm::vec2& visibleMin, const glm::vec2& visibleMax) {
+	return instance.min.x <= visibleMax.x && instance.max.x >= visibleMin.x &&
+		instance.min.y <= visibleMax.y && instance.max.y >= visibleMin.y;
+}
+
+void ShapeBatch::Update(const Layer& layer) {
+	if (layer.GetRevision() == revision) {
+		return;
+	}
+	uint64_t previousRevision = revision;
+	revision = layer.GetRevision();
+
+	std::swap(entries, previousEntries);
+	std::swap(lines, previousLines);
+	std::swap(circles, previousCircles);
+	std::swap(arcs, previousArcs);
+	entries.clear();
+	lines.clear();
+	circles.clear();
+	arcs.clear();
+	flagged.clear();
+
+	// Unchanged shapes are still the same objects, their instances are copied over.
+	// Only new and changed shapes have to extract their parameters again.
+	const auto& shapes = layer.GetShapes();
+	entries.reserve(shapes.size());
+	for (const auto& shape : shapes) {
+		EntryIndex& index = entryIndices[shape->GetID()];
+		bool existed = previousRevision != 0 && index.revision == previousRevision;
+		size_t previousIndex = index.index;
+		index.index = entries.size();
+		index.revision = revision;
+
+		if (existed && previousEntries[previousIndex].shape == shape) {
+			CopyInstance(previousEntries[previousIndex]);
+		}
+		else {
+			entries.push_back({ shape, Primitive::NONE, 0 });
+			shape->AddToBatch(*this);
+		}
+	}
+
+	UpdateBounds();
+	UpdateRuns();
+
+	// Forget removed shapes and release the references to the previous versions
+	for (const auto& entry : previousEntries) {
+		auto it = entryIndices.find(entry.shape->GetID());
+		if (it != entryIndices.end() && it->second.revision != revision) {
+			entryIndices.erase(it);
+			arcTessellations.erase(entry.shape->GetID());
+		}
+	}
+	previousEntries.clear();
+}
+
+void ShapeBatch::UpdateBounds() {
+	bool first = true;
+	auto add = [&](const glm::vec2& min, const glm::vec2& max) {
+		boundsMin = first ? min : glm::min(boundsMin, min);
+		boundsMax = first ? max : glm::max(boundsMax, max);
+		first = false;
+	};
+
+	boundsMin = { 0, 0 };
+	boundsMax = { 0, 0 };
+	for (const auto& line : lines) {
+		add(line.min, line.max);
+	}
+	for (const auto& circle : circles) {
+		add(circle.min, circle.max);
+	}
+	for (const auto& arc : arcs) {
+		add(arc.min, arc.max);
+	}
+}
+
+// The instances of every type are in draw order, so the runs are all that is needed to draw them in that order
+void ShapeBatch::UpdateRuns() {
+	runs.clear();
+	for (const auto& entry : entries) {
+		if (entry.primitive == Primitive::NONE) {
+			continue;
+		}
+		if (!runs.empty() && runs.back().first == entry.primitive) {
+			runs.back().second++;
+		}
+		else {
+			runs.push_back(std::make_pair(entry.primitive, 1u));
+		}
+	}
+}
+
+void ShapeBatch::CopyInstance(const Entry& previous) {
+	Entry entry = { previous.shape, previous.primitive, 0 };
+
+	switch (previous.primitive) {
+	case Primitive::LINE:
+		entry.instance = (uint32_t)lines.size();
+		lines.push_back(previousLines[previous.instance]);
+		lines.back().flags = 0;
+		break;
+	case Primitive::CIRCLE:
+		entry.instance = (uint32_t)circles.size();
+		circles.push_back(previousCircles[previous.instance]);
+		circles.back().flags = 0;
+		break;
+	case Primitive::ARC:
+		entry.instance = (uint32_t)arcs.size();
+		arcs.push_back(previousArcs[previous.instance]);
+		arcs.back().flags = 0;
+		break;
+	default:
+		break;
+	}
+
+	entries.push_back(entry);
+}
+
+uint32_t& ShapeBatch::GetFlags(Primitive primitive, uint32_t instance) {
+	switch (primitive) {
+	case Primitive::LINE:
+		return lines[instance].flags;
+	case Primitive::CIRCLE:
+		return circles[instance].flags;
+	default:
+		return arcs[instance].flags;
+	}
+}
+
+void ShapeBatch::SetHighlights(const std::vector<ShapeID>& selected, ShapeID hovered) {
+	for (auto& instance : flagged) {
+		GetFlags(instance.first, instance.second) = 0;
+	}
+	flagged.clear();
+
+	auto setFlag = [&](ShapeID id, uint32_t flag) {
+		auto it = entryIndices.find(id);
+		if (it == entryIndices.end() || it->second.revision != revision) {
+			return;
+		}
+
+		const Entry& entry = entries[it->second.index];
+		if (entry.primitive == Primitive::NONE) {
+			return;
+		}
+
+		uint32_t& flags = GetFlags(entry.primitive, entry.instance);
+		if (flags == 0) {
+			flagged.push_back(std::make_pair(entry.primitive, entry.instance));
+		}
+		flags |= flag;
+	};
+
+	for (ShapeID id : selected) {
+		setFlag(id, INSTANCE_SELECTED);
+	}
+	setFlag(hovered, INSTANCE_HOVERED);
+}
+
+void ShapeBatch::AddLine(const glm::vec2& p1, const glm::vec2& p2, float thickness, const glm::vec4& color) {
+	float u = abs(thickness) / 2.f;
+	entries.back().primitive = Primitive::LINE;
+	entries.back().instance = (uint32_t)lines.size();
+	lines.push_back({ p1, p2, thickness, color, glm::min(p1, p2) - glm::vec2(u), glm::max(p1, p2) + glm::vec2(u), 0 });
+}
+
+void ShapeBatch::AddCircle(const glm::vec2& center, float radius, float thickness, const glm::vec4& color) {
+	glm::vec2 extent = glm::vec2(abs(radius) + abs(thickness) / 2.f);
+	entries.back().primitive = Primitive::CIRCLE;
+	entries.back().instance = (uint32_t)circles.size();
+	circles.push_back({ center, radius, thickness, color, center - extent, center + extent, 0 });
+}
+
+void ShapeBatch::AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle, float thickness, const glm::vec4& color) {
+	glm::vec2 extent = glm::vec2(abs(radius) + abs(thickness) / 2.f);
+	entries.back().primitive = Primitive::ARC;
+	entries.back().instance = (uint32_t)arcs.size();
+	arcs.push_back({ center, radius, startAngle, endAngle, thickness, color, center - extent, center + extent, 0,
+		entries.back().shape->GetID() });
+}
+
+void ShapeBatch::DrawCircle(const CircleInstance& circle, const glm::vec4& color, const glm::vec2& visibleMin,
+	const glm::vec2& visibleMax, float pixelsPerUnit) const {
+
+	float screenRadius = abs(circle.radius) * pixelsPerUnit;
+	DrawPolyline(circle.center, circle.radius, GetUnitCircle(GetDetailLevel(screenRadius)), circle.thickness,
+		color, visibleMin, visibleMax);
+}
+
+void ShapeBatch::DrawArc(const ArcInstance& arc, const glm::vec4& color, const glm::vec2& visibleMin,
+	const glm::vec2& visibleMax, float pixelsPerUnit) const {
+
+	// Arcs are tessellated for their own angles, which is only redone when the level changes
+	int level = GetDetailLevel(abs(arc.radius) * pixelsPerUnit);
+	ArcTessellation& tessellation = arcTessellations[arc.shape];
+	if (tessellation.level != level || tessellation.startAngle != arc.startAngle || tessellation.endAngle != arc.endAngle) {
+		tessellation.level = level;
+		tessellation.startAngle = arc.startAngle;
+		tessellation.endAngle = arc.endAngle;
+		tessellation.directions.clear();
+
+		float span = fmod(arc.endAngle - arc.startAngle, 360.f);
+		span = span < 0 ? span + 360.f : span;
+		int segments = std::max((int)ceil((SHAPE_LOD_MIN_SEGMENTS << level) * span / 360.f), 1);
+		for (int i = 0; i <= segments; i++) {
+			float angle = glm::radians(arc.startAngle + span * i / segments);
+			tessellation.directions.push_back(glm::vec2(cos(angle), sin(angle)));
+		}
+	}
+
+	DrawPolyline(arc.center, arc.radius, tessellation.directions, arc.thickness, color, visibleMin, visibleMax);
+}
+
+void ShapeBatch::Draw(const glm::vec2& visibleMin, const glm::vec2& visibleMax, float pixelsPerUnit, bool layerSelected) const {
+
+	size_t line = 0;
+	size_t circle = 0;
+	size_t arc = 0;
+	for (const auto& run : runs) {
+		switch (run.first) {
+		case Primitive::LINE:
+			for (size_t end = line + run.second; line < end; line++) {
+				if (IsVisible(lines[line], visibleMin, visibleMax)) {
+					ApplicationRenderer::DrawLineWorkspace(lines[line].p1, lines[line].p2, lines[line].thickness,
+						GetInstanceColor(lines[line].color, lines[line].flags, layerSelected));
+				}
+			}
+			break;
+		case Primitive::CIRCLE:
+			for (size_t end = circle + run.second; circle < end; circle++) {
+				if (IsVisible(circles[circle], visibleMin, visibleMax)) {
+					DrawCircle(circles[circle], GetInstanceColor(circles[circle].color, circles[circle].flags, layerSelected),
+						visibleMin, visibleMax, pixelsPerUnit);
+				}
+			}
+			break;
+		case Primitive::ARC:
+			for (size_t end = arc + run.second; arc < end; arc++) {
+				if (IsVisible(arcs[arc], visibleMin, visibleMax)) {
+					DrawArc(arcs[arc], GetInstanceColor(arcs[arc].color, arcs[arc].flags, layerSelected),
+						visibleMin, visibleMax, pixelsPerUnit);
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void ShapeBatch::DrawHighlights(const glm::vec2& visibleMin, const glm::vec2& visibleMax, float pixelsPerUnit) const {
+
+	for (const auto& instance : flagged) {
+		switch (instance.first) {
+		case Primitive::LINE: {
+			const auto& line = lines[instance.second];
+			if (IsVisible(line, visibleMin, visibleMax)) {
+				ApplicationRenderer::DrawLineWorkspace(line.p1, line.p2, line.thickness,
+					GetInstanceColor(line.color, line.flags, true));
+			}
+			break;
+		}
+		case Primitive::CIRCLE: {
+			const auto& circle = circles[instance.second];
+			if (IsVisible(circle, visibleMin, visibleMax)) {
+				DrawCircle(circle, GetInstanceColor(circle.color, circle.flags, true), visibleMin, visibleMax, pixelsPerUnit);
+			}
+			break;
+		}
+		case Primitive::ARC: {
+			const auto& arc = arcs[instance.second];
+			if (IsVisible(arc, visibleMin, visibleMax)) {
+				DrawArc(arc, GetInstanceColor(arc.color, arc.flags, true), visibleMin, visibleMax, pixelsPerUnit);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+size_t ShapeBatch::DrawExport(size_t first, size_t count, glm::vec2 min, glm::vec2 max, float width, float height) const {
+	size_t end = std::min(first + count, entries.size());
+
+	for (size_t i = first; i < end; i++) {
+		const Entry& entry = entries[i];
+		switch (entry.primitive) {
+		case Primitive::LINE: {
+			const auto& line = lines[entry.instance];
+			ApplicationRenderer::DrawLineExport(line.p1, line.p2, line.thickness, line.color, min, max, width, height);
+			break;
+		}
+		case Primitive::CIRCLE: {
+			const auto& circle = circles[entry.instance];
+			ApplicationRenderer::DrawCircleExport(circle.center, circle.radius, circle.thickness, circle.color,
+				min, max, width, height);
+			break;
+		}
+		case Primitive::ARC: {
+			const auto& arc = arcs[entry.instance];
+			ApplicationRenderer::DrawArcExport(arc.center, arc.radius, arc.startAngle, arc.endAngle, arc.thickness,
+				arc.color, min, max, width, height);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	return end;
+}
@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "ShapeClipboard.h"
+#include "Shapes/LineShape.h"
+#include "Shapes/CircleShape.h"
+#include "Shapes/ArcShape.h"
+#include "config.h"
+
+static const char* BASE64_CHARACTERS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static std::string EncodeBase64(const std::string& data) {
+	std::string encoded;
+	encoded.reserve((data.size() + 2) / 3 * 4);
+
+	size_t i = 0;
+	for (; i + 2 < data.size(); i += 3) {
+		uint32_t block = ((uint8_t)data[i] << 16) | ((uint8_t)data[i + 1] << 8) | (uint8_t)data[i + 2];
+		encoded.push_back(BASE64_CHARACTERS[(block >> 18) & 63]);
+		encoded.push_back(BASE64_CHARACTERS[(block >> 12) & 63]);
+		encoded.push_back(BASE64_CHARACTERS[(block >> 6) & 63]);
+		encoded.push_back(BASE64_CHARACTERS[block & 63]);
+	}
+
+	if (i < data.size()) {
+		uint32_t block = (uint8_t)data[i] << 16;
+		if (i + 1 < data.size()) {
+			block |= (uint8_t)data[i + 1] << 8;
+		}
+		encoded.push_back(BASE64_CHARACTERS[(block >> 18) & 63]);
+		encoded.push_back(BASE64_CHARACTERS[(block >> 12) & 63]);
+		encoded.push_back(i + 1 < data.size() ? BASE64_CHARACTERS[(block >> 6) & 63] : '=');
+		encoded.push_back('=');
+	}
+
+	return encoded;
+}
+
+static std::optional<std::string> DecodeBase64(const char* begin, const char* end) {
+	int8_t values[256];
+	std::fill(std::begin(values), std::end(values), -1);
+	for (int i = 0; i < 64; i++) {
+		values[(uint8_t)BASE64_CHARACTERS[i]] = i;
+	}
+
+	std::string decoded;
+	decoded.reserve((end - begin) / 4 * 3);
+
+	uint32_t block = 0;
+	int bits = 0;
+	for (const char* c = begin; c < end && *c != '='; c++) {
+		int8_t value = values[(uint8_t)*c];
+		if (value < 0) {
+			return std::nullopt;
+		}
+		block = (block << 6) | value;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			decoded.push_back((char)((block >> bits) & 0xFF));
+		}
+	}
+
+	return decoded;
+}
+
+ShapeClipboard::ShapeClipboard() {
+	data.resize(sizeof(numberOfShapes));	// The number of shapes comes first and is written at the end
+}
+
+void ShapeClipboard::WriteFloats(std::initializer_list<float> values) {
+	size_t offset = data.size();
+	data.resize(offset + values.size() * sizeof(float));
+	memcpy(&data[offset], values.begin(), values.size() * sizeof(float));
+}
+
+void ShapeClipboard::AddLine(const glm::vec2& p1, const glm::vec2& p2, float thickness, const glm::vec4& color) {
+	data.push_back((char)Record::LINE);
+	WriteFloats({ p1.x, p1.y, p2.x, p2.y, thickness, color.r, color.g, color.b, color.a });
+	numberOfShapes++;
+}
+
+void ShapeClipboard::AddCircle(const glm::vec2& center, float radius, float thickness, const glm::vec4& color) {
+	data.push_back((char)Record::CIRCLE);
+	WriteFloats({ center.x, center.y, radius, thickness, color.r, color.g, color.b, color.a });
+	numberOfShapes++;
+}
+
+void ShapeClipboard::AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle, float thickness, const glm::vec4& color) {
+	data.push_back((char)Record::ARC);
+	WriteFloats({ center.x, center.y, radius, startAngle, endAngle, thickness, color.r, color.g, color.b, color.a });
+	numberOfShapes++;
+}
+
+std::string ShapeClipboard::GetPayload() const {
+	std::string block = data;
+	memcpy(&block[0], &numberOfShapes, sizeof(numberOfShapes));
+	return CLIPBOARD_BINARY_PREFIX + EncodeBase64(block);
+}
+
+static std::optional<std::vector<ShapePTR>> ReadJsonPayload(const std::string& payload) {
+	std::vector<ShapePTR> shapes;
+
+	try {
+		nlohmann::json j = nlohmann::json::parse(payload);
+		shapes.reserve(j.size());
+
+		for (const nlohmann::json& shapeData : j) {
+			ShapePTR shape = GenericShape::MakeShape(shapeData);
+			if (!shape) {
+				return std::nullopt;
+			}
+			shapes.push_back(std::move(shape));
+		}
+	}
+	catch (...) {
+		return std::nullopt;
+	}
+
+	return shapes;
+}
+
+std::optional<std::vector<ShapePTR>> ShapeClipboard::ReadPayload(const std::string& payload) {
+	size_t prefixLength = strlen(CLIPBOARD_BINARY_PREFIX);
+	if (payload.compare(0, prefixLength, CLIPBOARD_BINARY_PREFIX) != 0) {
+		return ReadJsonPayload(payload);
+	}
+
+	auto block = DecodeBase64(payload.data() + prefixLength, payload.data() + payload.size());
+	if (!block || block->size() < sizeof(uint32_t)) {
+		return std::nullopt;
+	}
+
+	const char* position = block->data();
+	const char* end = block->data() + block->size();
+	uint32_t numberOfShapes;
+	memcpy(&numberOfShapes, position, sizeof(numberOfShapes));
+	position += sizeof(numberOfShapes);
+
+	// Every shape takes at least a type and a few floats, which bounds the reservation by the payload size
+	std::vector<ShapePTR> shapes;
+	shapes.reserve(std::min<size_t>(numberOfShapes, (end - position) / (1 + 8 * sizeof(float))));
+
+	float f[10];
+	auto readFloats = [&](size_t count) {
+		if ((size_t)(end - position) < count * sizeof(float)) {
+			return false;
+		}
+		memcpy(f, position, count * sizeof(float));
+		position += count * sizeof(float);
+		return true;
+	};
+
+	for (uint32_t i = 0; i < numberOfShapes; i++) {
+		if (position >= end) {
+			return std::nullopt;
+		}
+
+		switch ((Record)*position++) {
+		case Record::LINE:
+			if (!readFloats(9)) {
+				return std::nullopt;
+			}
+			shapes.push_back(std::make_shared<LineShape>(glm::vec2(f[0], f[1]), glm::vec2(f[2], f[3]), f[4],
+				glm::vec4(f[5], f[6], f[7], f[8])));
+			break;
+
+		case Record::CIRCLE:
+			if (!readFloats(8)) {
+				return std::nullopt;
+			}
+			shapes.push_back(std::make_shared<CircleShape>(glm::vec2(f[0], f[1]), f[2], f[3],
+				glm::vec4(f[4], f[5], f[6], f[7])));
+			break;
+
+		case Record::ARC:
+			if (!readFloats(10)) {
+				return std::nullopt;
+			}
+			shapes.push_back(std::make_shared<ArcShape>(glm::vec2(f[0], f[1]), f[2], f[3], f[4], f[5],
+				glm::vec4(f[6], f[7], f[8], f[9])));
+			break;
+
+		default:
+			return std::nullopt;
+		}
+	}
+
+	return shapes;
+}
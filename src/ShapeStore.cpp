@@ -0,0 +1,226 @@
+#include "pch.h"
+#include "ShapeStore.h"
+#include "config.h"
+#include <future>
+#include <thread>
+
+#undef max
+#undef min
+
+// Overwrites the data of the current shape, or appends it if the shape is new or changed its type
+template<typename T>
+void ShapeStore::Write(std::vector<T>& array, ShapeType type, const T& data) {
+	T record = data;
+	auto bound = GetBoundingBox(record);
+	record.min = bound.first;
+	record.max = bound.second;
+
+	auto it = handles.find(currentShape);
+	if (it != handles.end()) {
+		if (it->second.type == type) {
+			T& previous = array[it->second.index];
+			ShrinkBounds(previous.min, previous.max);
+			previous = record;
+			GrowBounds(record.min, record.max);
+			return;
+		}
+		Remove(currentShape);
+	}
+
+	handles[currentShape] = { type, (uint32_t)array.size() };
+	array.push_back(record);
+	GrowBounds(record.min, record.max);
+}
+
+// The last element takes the place of the erased one, the arrays have no order
+template<typename T>
+void ShapeStore::Erase(std::vector<T>& array, uint32_t index) {
+	ShrinkBounds(array[index].min, array[index].max);
+	if (index + 1 < array.size()) {
+		array[index] = array.back();
+		handles[array[index].id].index = index;
+	}
+	array.pop_back();
+}
+
+void ShapeStore::GrowBounds(const glm::vec2& min, const glm::vec2& max) {
+	if (boundsValid) {
+		boundsMin = glm::min(boundsMin, min);
+		boundsMax = glm::max(boundsMax, max);
+	}
+}
+
+// The bounds can only shrink if the box touched their edge, they are computed again when they are needed
+void ShapeStore::ShrinkBounds(const glm::vec2& min, const glm::vec2& max) {
+	if (min.x <= boundsMin.x || min.y <= boundsMin.y || max.x >= boundsMax.x || max.y >= boundsMax.y) {
+		boundsValid = false;
+	}
+}
+
+// Each array is split into one range per thread, the ranges are reduced in parallel and then combined
+template<typename T>
+static void ReduceBounds(const std::vector<T>& array, glm::vec2& min, glm::vec2& max) {
+	auto reduce = [&array](size_t begin, size_t end) {
+		glm::vec2 rangeMin = glm::vec2(std::numeric_limits<float>::infinity());
+		glm::vec2 rangeMax = -rangeMin;
+		for (size_t i = begin; i < end; i++) {
+			rangeMin = glm::min(rangeMin, array[i].min);
+			rangeMax = glm::max(rangeMax, array[i].max);
+		}
+		return std::make_pair(rangeMin, rangeMax);
+	};
+
+	size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+	threads = std::min(threads, array.size() / SHAPE_BOUNDS_MIN_PER_THREAD + 1);
+	size_t rangeSize = (array.size() + threads - 1) / threads;
+
+	std::vector<std::future<std::pair<glm::vec2, glm::vec2>>> ranges;
+	for (size_t begin = rangeSize; begin < array.size(); begin += rangeSize) {
+		ranges.push_back(std::async(std::launch::async, reduce, begin, std::min(begin + rangeSize, array.size())));
+	}
+
+	auto bound = reduce(0, std::min(rangeSize, array.size()));
+	min = glm::min(min, bound.first);
+	max = glm::max(max, bound.second);
+	for (auto& range : ranges) {
+		bound = range.get();
+		min = glm::min(min, bound.first);
+		max = glm::max(max, bound.second);
+	}
+}
+
+void ShapeStore::UpdateBounds() const {
+	boundsMin = glm::vec2(std::numeric_limits<float>::infinity());
+	boundsMax = -boundsMin;
+	ReduceBounds(lines, boundsMin, boundsMax);
+	ReduceBounds(circles, boundsMin, boundsMax);
+	ReduceBounds(arcs, boundsMin, boundsMax);
+	boundsValid = true;
+}
+
+void ShapeStore::Set(const GenericShape& shape) {
+	currentShape = shape.GetID();
+	shape.AddToStore(*this);
+}
+
+void ShapeStore::Remove(ShapeID id) {
+	auto it = handles.find(id);
+	if (it == handles.end()) {
+		return;
+	}
+
+	Handle handle = it->second;
+	handles.erase(it);
+	switch (handle.type) {
+	case ShapeType::LINE:	Erase(lines, handle.index); break;
+	case ShapeType::CIRCLE:	Erase(circles, handle.index); break;
+	case ShapeType::ARC:	Erase(arcs, handle.index); break;
+	default: break;
+	}
+}
+
+// The bounds are left invalid, so that the shapes of a full rebuild are reduced once on the next query
+void ShapeStore::Clear() {
+	lines.clear();
+	circles.clear();
+	arcs.clear();
+	handles.clear();
+	boundsValid = false;
+}
+
+void ShapeStore::AddLine(const glm::vec2& p1, const glm::vec2& p2, float thickness) {
+	Write(lines, ShapeType::LINE, { p1, p2, thickness, currentShape });
+}
+
+void ShapeStore::AddCircle(const glm::vec2& center, float radius, float thickness) {
+	Write(circles, ShapeType::CIRCLE, { center, radius, thickness, currentShape });
+}
+
+void ShapeStore::AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle, float thickness) {
+	Write(arcs, ShapeType::ARC, { center, radius, startAngle, endAngle, thickness, currentShape });
+}
+
+std::pair<glm::vec2, glm::vec2> ShapeStore::GetBoundingBox(ShapeID id) const {
+	const Handle& handle = handles.at(id);
+	switch (handle.type) {
+	case ShapeType::LINE:	return std::make_pair(lines[handle.index].min, lines[handle.index].max);
+	case ShapeType::CIRCLE:	return std::make_pair(circles[handle.index].min, circles[handle.index].max);
+	case ShapeType::ARC:	return std::make_pair(arcs[handle.index].min, arcs[handle.index].max);
+	default:				return std::make_pair(glm::vec2(0, 0), glm::vec2(0, 0));
+	}
+}
+
+bool ShapeStore::IsInSelectionBox(ShapeID id, const glm::vec2& s1, const glm::vec2& s2) const {
+	const Handle& handle = handles.at(id);
+	switch (handle.type) {
+	case ShapeType::LINE:	return IsInSelectionBox(lines[handle.index], s1, s2);
+	case ShapeType::CIRCLE:	return IsInSelectionBox(circles[handle.index], s1, s2);
+	case ShapeType::ARC:	return IsInSelectionBox(arcs[handle.index], s1, s2);
+	default:				return false;
+	}
+}
+
+float ShapeStore::GetDistanceToCursor(ShapeID id, const glm::vec2& p) const {
+	const Handle& handle = handles.at(id);
+	switch (handle.type) {
+	case ShapeType::LINE:	return GetDistanceToCursor(lines[handle.index], p);
+	case ShapeType::CIRCLE:	return GetDistanceToCursor(circles[handle.index], p);
+	case ShapeType::ARC:	return GetDistanceToCursor(arcs[handle.index], p);
+	default:				return std::numeric_limits<float>::infinity();
+	}
+}
+
+// The handles are sorted by type first, so every array is walked in a loop of its own
+bool ShapeStore::Move(const std::vector<ShapeID>& ids, const glm::vec2& amount) {
+	bool failed = false;
+	std::vector<Handle> moved;
+	moved.reserve(ids.size());
+	for (ShapeID id : ids) {
+		auto it = handles.find(id);
+		if (it != handles.end()) {
+			moved.push_back(it->second);
+		}
+		else {
+			failed = true;
+		}
+	}
+	std::sort(moved.begin(), moved.end(), [](const Handle& a, const Handle& b) {
+		return a.type != b.type ? a.type < b.type : a.index < b.index;
+	});
+
+	auto move = [&](auto& record) {
+		ShrinkBounds(record.min, record.max);
+		record.min += amount;
+		record.max += amount;
+		GrowBounds(record.min, record.max);
+	};
+
+	size_t i = 0;
+	for (; i < moved.size() && moved[i].type == ShapeType::LINE; i++) {
+		Line& line = lines[moved[i].index];
+		line.p1 += amount;
+		line.p2 += amount;
+		move(line);
+	}
+	for (; i < moved.size() && moved[i].type == ShapeType::CIRCLE; i++) {
+		circles[moved[i].index].center += amount;
+		move(circles[moved[i].index]);
+	}
+	for (; i < moved.size() && moved[i].type == ShapeType::ARC; i++) {
+		arcs[moved[i].index].center += amount;
+		move(arcs[moved[i].index]);
+	}
+
+	return !failed;
+}
+
+std::optional<std::pair<glm::vec2, glm::vec2>> ShapeStore::GetBoundingBox() const {
+	if (handles.empty()) {
+		return std::nullopt;
+	}
+
+	if (!boundsValid) {
+		UpdateBounds();
+	}
+	return std::make_pair(boundsMin, boundsMax);
+}
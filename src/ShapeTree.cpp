@@ -0,0 +1,408 @@
+#include "pch.h"
+#include "ShapeTree.h"
+#include "LayerState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#undef max
+#undef min
+
+static float GetPerimeter(const glm::vec2& min, const glm::vec2& max) {
+	return 2.f * ((max.x - min.x) + (max.y - min.y));
+}
+
+int32_t ShapeTree::AllocateNode() {
+	if (freeList == -1) {
+		nodes.emplace_back();
+		return (int32_t)nodes.size() - 1;
+	}
+
+	int32_t node = freeList;
+	freeList = nodes[node].parent;
+	nodes[node] = Node();
+	return node;
+}
+
+void ShapeTree::FreeNode(int32_t node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+void ShapeTree::Refit(int32_t index) {
+	Node& node = nodes[index];
+	const Node& child1 = nodes[node.child1];
+	const Node& child2 = nodes[node.child2];
+	node.min = glm::min(child1.min, child2.min);
+	node.max = glm::max(child1.max, child2.max);
+	node.height = 1 + std::max(child1.height, child2.height);
+}
+
+void ShapeTree::InsertLeaf(int32_t leaf) {
+	if (root == -1) {
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+
+	// Descend to the sibling which increases the total perimeter of the tree the least
+	glm::vec2 leafMin = nodes[leaf].min;
+	glm::vec2 leafMax = nodes[leaf].max;
+	int32_t index = root;
+	while (!nodes[index].IsLeaf()) {
+		const Node& node = nodes[index];
+		float perimeter = GetPerimeter(node.min, node.max);
+		float combinedPerimeter = GetPerimeter(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+		// Cost of creating a new parent for this node and the new leaf
+		float cost = 2.f * combinedPerimeter;
+
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.f * (combinedPerimeter - perimeter);
+
+		auto descendCost = [&](int32_t childIndex) {
+			const Node& child = nodes[childIndex];
+			float newPerimeter = GetPerimeter(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+			if (child.IsLeaf()) {
+				return newPerimeter + inheritanceCost;
+			}
+			return newPerimeter - GetPerimeter(child.min, child.max) + inheritanceCost;
+		};
+		float cost1 = descendCost(node.child1);
+		float cost2 = descendCost(node.child2);
+
+		if (cost < cost1 && cost < cost2) {
+			break;
+		}
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	// Create a new parent for the sibling and the leaf
+	int32_t sibling = index;
+	int32_t oldParent = nodes[sibling].parent;
+	int32_t newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent != -1) {
+		if (nodes[oldParent].child1 == sibling) {
+			nodes[oldParent].child1 = newParent;
+		}
+		else {
+			nodes[oldParent].child2 = newParent;
+		}
+	}
+	else {
+		root = newParent;
+	}
+
+	// Walk back up, fixing heights and boxes
+	index = newParent;
+	while (index != -1) {
+		index = Balance(index);
+		Refit(index);
+		index = nodes[index].parent;
+	}
+}
+
+void ShapeTree::RemoveLeaf(int32_t leaf) {
+	if (leaf == root) {
+		root = -1;
+		return;
+	}
+
+	int32_t parent = nodes[leaf].parent;
+	int32_t grandParent = nodes[parent].parent;
+	int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if (grandParent == -1) {
+		root = sibling;
+		nodes[sibling].parent = -1;
+		FreeNode(parent);
+		return;
+	}
+
+	// Replace the parent by the sibling and refit the ancestors
+	if (nodes[grandParent].child1 == parent) {
+		nodes[grandParent].child1 = sibling;
+	}
+	else {
+		nodes[grandParent].child2 = sibling;
+	}
+	nodes[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	int32_t index = grandParent;
+	while (index != -1) {
+		index = Balance(index);
+		Refit(index);
+		index = nodes[index].parent;
+	}
+}
+
+// Rotates the taller child up if the children of a node differ in height by more than one.
+// Returns the node that is now at the position of the given one.
+int32_t ShapeTree::Balance(int32_t iA) {
+	Node& A = nodes[iA];
+	if (A.IsLeaf() || A.height < 2) {
+		return iA;
+	}
+
+	int32_t iB = A.child1;
+	int32_t iC = A.child2;
+	Node& B = nodes[iB];
+	Node& C = nodes[iC];
+	int32_t balance = C.height - B.height;
+
+	// Rotate C up
+	if (balance > 1) {
+		int32_t iF = C.child1;
+		int32_t iG = C.child2;
+		Node& F = nodes[iF];
+		Node& G = nodes[iG];
+
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if (C.parent != -1) {
+			if (nodes[C.parent].child1 == iA) {
+				nodes[C.parent].child1 = iC;
+			}
+			else {
+				nodes[C.parent].child2 = iC;
+			}
+		}
+		else {
+			root = iC;
+		}
+
+		if (F.height > G.height) {
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+		}
+		else {
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+		}
+		Refit(iA);
+		Refit(iC);
+		return iC;
+	}
+
+	// Rotate B up
+	if (balance < -1) {
+		int32_t iD = B.child1;
+		int32_t iE = B.child2;
+		Node& D = nodes[iD];
+		Node& E = nodes[iE];
+
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if (B.parent != -1) {
+			if (nodes[B.parent].child1 == iA) {
+				nodes[B.parent].child1 = iB;
+			}
+			else {
+				nodes[B.parent].child2 = iB;
+			}
+		}
+		else {
+			root = iB;
+		}
+
+		if (D.height > E.height) {
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+		}
+		else {
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+		}
+		Refit(iA);
+		Refit(iB);
+		return iB;
+	}
+
+	return iA;
+}
+
+void ShapeTree::Insert(ShapeID id, const std::pair<glm::vec2, glm::vec2>& bounds) {
+	Remove(id);
+
+	int32_t leaf = AllocateNode();
+	nodes[leaf].min = bounds.first - glm::vec2(SHAPE_TREE_MARGIN);
+	nodes[leaf].max = bounds.second + glm::vec2(SHAPE_TREE_MARGIN);
+	nodes[leaf].shape = id;
+	leaves[id] = leaf;
+	InsertLeaf(leaf);
+}
+
+bool ShapeTree::Remove(ShapeID id) {
+	auto it = leaves.find(id);
+	if (it == leaves.end()) {
+		return false;
+	}
+
+	RemoveLeaf(it->second);
+	FreeNode(it->second);
+	leaves.erase(it);
+	return true;
+}
+
+bool ShapeTree::Update(ShapeID id, const std::pair<glm::vec2, glm::vec2>& bounds) {
+	auto it = leaves.find(id);
+	if (it != leaves.end()) {
+		const Node& leaf = nodes[it->second];
+		if (leaf.min.x <= bounds.first.x && leaf.min.y <= bounds.first.y &&
+			leaf.max.x >= bounds.second.x && leaf.max.y >= bounds.second.y) {
+			return false;
+		}
+	}
+
+	Insert(id, bounds);
+	return true;
+}
+
+void ShapeTree::Clear() {
+	nodes.clear();
+	leaves.clear();
+	root = -1;
+	freeList = -1;
+}
+
+void ShapeTree::Build(const std::vector<std::pair<ShapeID, std::pair<glm::vec2, glm::vec2>>>& shapes) {
+	Clear();
+	nodes.reserve(shapes.size() * 2);
+	leaves.reserve(shapes.size());
+
+	std::vector<int32_t> leafNodes;
+	leafNodes.reserve(shapes.size());
+	for (const auto& shape : shapes) {
+		int32_t leaf = AllocateNode();
+		nodes[leaf].min = shape.second.first - glm::vec2(SHAPE_TREE_MARGIN);
+		nodes[leaf].max = shape.second.second + glm::vec2(SHAPE_TREE_MARGIN);
+		nodes[leaf].shape = shape.first;
+		leaves[shape.first] = leaf;
+		leafNodes.push_back(leaf);
+	}
+
+	if (!leafNodes.empty()) {
+		root = BuildNodes(leafNodes.data(), leafNodes.size());
+		nodes[root].parent = -1;
+	}
+}
+
+// Splits the leaves at the median of their centers along the longer side of their bounds
+int32_t ShapeTree::BuildNodes(int32_t* leafNodes, size_t count) {
+	if (count == 1) {
+		return leafNodes[0];
+	}
+
+	glm::vec2 min = nodes[leafNodes[0]].min + nodes[leafNodes[0]].max;
+	glm::vec2 max = min;
+	for (size_t i = 1; i < count; i++) {
+		glm::vec2 center = nodes[leafNodes[i]].min + nodes[leafNodes[i]].max;
+		min = glm::min(min, center);
+		max = glm::max(max, center);
+	}
+	int axis = (max.x - min.x) >= (max.y - min.y) ? 0 : 1;
+
+	size_t half = count / 2;
+	std::nth_element(leafNodes, leafNodes + half, leafNodes + count, [&](int32_t a, int32_t b) {
+		return (nodes[a].min[axis] + nodes[a].max[axis]) < (nodes[b].min[axis] + nodes[b].max[axis]);
+	});
+
+	int32_t child1 = BuildNodes(leafNodes, half);
+	int32_t child2 = BuildNodes(leafNodes + half, count - half);
+	int32_t parent = AllocateNode();
+	nodes[parent].child1 = child1;
+	nodes[parent].child2 = child2;
+	nodes[child1].parent = parent;
+	nodes[child2].parent = parent;
+	Refit(parent);
+	return parent;
+}
+
+void BenchmarkShapeTree(size_t numberOfShapes) {
+	using Clock = std::chrono::high_resolution_clock;
+	const size_t numberOfHoverQueries = 10000;
+	const size_t numberOfBoxQueries = 100;
+	const float extent = 10000.f;
+	const float threshold = 2.f;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(0.f, extent);
+	std::uniform_real_distribution<float> offset(-20.f, 20.f);
+
+	LayerState state;
+	for (size_t i = 0; i < numberOfShapes; i++) {
+		glm::vec2 p1 = { position(random), position(random) };
+		glm::vec2 p2 = p1 + glm::vec2(offset(random), offset(random));
+		state.PushShape(GenericShape::MakeShape(ShapeType::LINE, p1, p2, DEFAULT_LINE_THICKNESS, DEFAULT_LINE_COLOR));
+	}
+
+	std::vector<glm::vec2> cursors;
+	for (size_t i = 0; i < numberOfHoverQueries; i++) {
+		cursors.push_back({ position(random), position(random) });
+	}
+
+	// Hover: every shape within the threshold of the cursor
+	size_t linearHits = 0;
+	auto start = Clock::now();
+	for (const auto& cursor : cursors) {
+		for (const auto& shape : state.GetShapes()) {
+			if (shape->IsShapeHovered(cursor, threshold)) {
+				linearHits++;
+			}
+		}
+	}
+	double linearHoverMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	size_t treeHits = 0;
+	start = Clock::now();
+	for (const auto& cursor : cursors) {
+		treeHits += state.FindShapesNear(cursor, threshold).size();
+	}
+	double treeHoverMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	// Box select: a box of a tenth of the drawing at random positions
+	size_t linearSelected = 0;
+	start = Clock::now();
+	for (size_t i = 0; i < numberOfBoxQueries; i++) {
+		glm::vec2 a = cursors[i];
+		glm::vec2 b = a + glm::vec2(extent / 10.f);
+		for (const auto& shape : state.GetShapes()) {
+			if (shape->IsInSelectionBox(a, b)) {
+				linearSelected++;
+			}
+		}
+	}
+	double linearBoxMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	size_t treeSelected = 0;
+	start = Clock::now();
+	for (size_t i = 0; i < numberOfBoxQueries; i++) {
+		glm::vec2 a = cursors[i];
+		glm::vec2 b = a + glm::vec2(extent / 10.f);
+		treeSelected += state.FindShapesInBox(a, b).size();
+	}
+	double treeBoxMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	LOG_INFO("Shape tree benchmark with {} lines", numberOfShapes);
+	LOG_INFO("Hover, {} queries: linear {:.2f} ms, tree {:.2f} ms ({} / {} hits)",
+		numberOfHoverQueries, linearHoverMs, treeHoverMs, linearHits, treeHits);
+	LOG_INFO("Box select, {} queries: linear {:.2f} ms, tree {:.2f} ms ({} / {} shapes)",
+		numberOfBoxQueries, linearBoxMs, treeBoxMs, linearSelected, treeSelected);
+}
@@ -3,6 +3,10 @@
 #include "pch.h"
 #include "Shapes/ArcShape.h"
 #include "Navigator.h"
+#include "ShapeBatch.h"
+#include "SnapIndex.h"
+#include "ShapeClipboard.h"
+#include "ShapeStore.h"
 #include "Fonts/Fonts.h"
 
 
@@ -87,7 +91,7 @@ ArcShape::ArcShape(const nlohmann::json& j) {
 	LoadJson(j);
 }
 
-ShapePTR ArcShape::Duplicate() {
+ShapePTR ArcShape::Duplicate() const {
 	return std::make_shared<ArcShape>(center, radius, startAngle, endAngle, thickness, color);
 }
 
@@ -99,18 +103,11 @@ std::string ArcShape::GetTypeString() const {
 
 
 std::pair<glm::vec2, glm::vec2> ArcShape::GetBoundingBox() const {
-
-	float u = abs(thickness) / 2.f;
-	glm::vec2 min = center - glm::vec2(abs(radius) + u, abs(radius) + u);
-	glm::vec2 max = center + glm::vec2(abs(radius) + u, abs(radius) + u);
-
-	return std::make_pair(min, max);
+	return ShapeStore::GetBoundingBox(ShapeStore::Arc{ center, radius, startAngle, endAngle, thickness, GetID() });
 }
 
 bool ArcShape::IsInSelectionBox(const glm::vec2& s1, const glm::vec2& s2) const {
-
-	// Should be selected if the center of the arc is in the selection
-	return IsInbetween(center.x, s1.x, s2.x) && IsInbetween(center.y, s1.y, s2.y);
+	return ShapeStore::IsInSelectionBox(ShapeStore::Arc{ center, radius, startAngle, endAngle, thickness, GetID() }, s1, s2);
 }
 
 bool ArcShape::ShouldBeRendered(float screenWidth, float screenHeight) const {
@@ -124,9 +121,7 @@ bool ArcShape::ShouldBeRendered(float screenWidth, float screenHeight) const {
 }
 
 float ArcShape::GetDistanceToCursor(const glm::vec2& p) const {
-	float centerDist = dist(Navigator::GetInstance()->mousePosition, center);
-	float arcDist = abs(centerDist - radius);
-	return std::min(arcDist, centerDist);
+	return ShapeStore::GetDistanceToCursor(ShapeStore::Arc{ center, radius, startAngle, endAngle, thickness, GetID() }, p);
 }
 
 bool ArcShape::IsShapeHovered(const glm::vec2& cursor, float thresholdDistance) const {
@@ -241,31 +236,20 @@ void ArcShape::RenderPreview() const {
 	ApplicationRenderer::DrawArcWorkspace(center, radius, startAngle, endAngle, thickness, color);
 }
 
-void ArcShape::Render(bool layerSelected, bool shapeSelected, bool shapeHovered) const {
+void ArcShape::AddToBatch(ShapeBatch& batch) const {
+	batch.AddArc(center, radius, startAngle, endAngle, thickness, color);
+}
 
-	auto& ref = ApplicationRenderer::GetInstance();
-	glm::vec4 col = ref.disabledLineColor;
+void ArcShape::AddSnapFeatures(SnapIndex& index) const {
+	index.AddArc(center, radius, startAngle, endAngle);
+}
 
-	if (layerSelected) { // Shape is selected
-		if (shapeSelected) {
-			if (shapeHovered) {	// Shape is selected and hovered
-				col = (ref.hoveredLineColor + ref.selectedLineColor) / 2.f;
-			}
-			else {
-				col = ref.selectedLineColor;
-			}
-		}
-		else {			// Shape is simply hovered
-			if (shapeHovered) {
-				col = ref.hoveredLineColor;
-			}
-			else {
-				col = color;
-			}
-		}
-	}
+void ArcShape::AddToClipboard(ShapeClipboard& clipboard) const {
+	clipboard.AddArc(center, radius, startAngle, endAngle, thickness, color);
+}
 
-	ApplicationRenderer::DrawArcWorkspace(center, radius, startAngle, endAngle, thickness, col);
+void ArcShape::AddToStore(ShapeStore& store) const {
+	store.AddArc(center, radius, startAngle, endAngle, thickness);
 }
 
 void ArcShape::RenderExport(glm::vec2 min, glm::vec2 max, float width, float height) const {
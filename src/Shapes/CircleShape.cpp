@@ -3,6 +3,10 @@
 #include "pch.h"
 #include "Shapes/CircleShape.h"
 #include "Navigator.h"
+#include "ShapeBatch.h"
+#include "SnapIndex.h"
+#include "ShapeClipboard.h"
+#include "ShapeStore.h"
 #include "Fonts/Fonts.h"
 
 CircleShape::CircleShape() {
@@ -20,7 +24,7 @@ CircleShape::CircleShape(const nlohmann::json& j) {
 	LoadJson(j);
 }
 
-ShapePTR CircleShape::Duplicate() {
+ShapePTR CircleShape::Duplicate() const {
 	return std::make_shared<CircleShape>(center, radius, thickness, color);
 }
 
@@ -32,18 +36,11 @@ std::string CircleShape::GetTypeString() const {
 
 
 std::pair<glm::vec2, glm::vec2> CircleShape::GetBoundingBox() const {
-
-	float u = abs(thickness) / 2.f;
-	glm::vec2 min = center - glm::vec2(abs(radius) + u, abs(radius) + u);
-	glm::vec2 max = center + glm::vec2(abs(radius) + u, abs(radius) + u);
-	
-	return std::make_pair(min, max);
+	return ShapeStore::GetBoundingBox(ShapeStore::Circle{ center, radius, thickness, GetID() });
 }
 
 bool CircleShape::IsInSelectionBox(const glm::vec2& s1, const glm::vec2& s2) const {
-	
-	// Should be selected if the center of the circle is in the selection
-	return IsInbetween(center.x, s1.x, s2.x) && IsInbetween(center.y, s1.y, s2.y);
+	return ShapeStore::IsInSelectionBox(ShapeStore::Circle{ center, radius, thickness, GetID() }, s1, s2);
 }
 
 bool CircleShape::ShouldBeRendered(float screenWidth, float screenHeight) const {
@@ -57,8 +54,7 @@ bool CircleShape::ShouldBeRendered(float screenWidth, float screenHeight) const
 }
 
 float CircleShape::GetDistanceToCursor(const glm::vec2& p) const {
-	float centerDist = dist(Navigator::GetInstance()->mousePosition, center);
-	return std::min(abs(centerDist - radius), centerDist);
+	return ShapeStore::GetDistanceToCursor(ShapeStore::Circle{ center, radius, thickness, GetID() }, p);
 }
 
 bool CircleShape::IsShapeHovered(const glm::vec2& cursor, float thresholdDistance) const {
@@ -157,31 +153,20 @@ void CircleShape::RenderPreview() const {
 	ApplicationRenderer::DrawCircleWorkspace(center, radius, thickness, color);
 }
 
-void CircleShape::Render(bool layerSelected, bool shapeSelected, bool shapeHovered) const {
+void CircleShape::AddToBatch(ShapeBatch& batch) const {
+	batch.AddCircle(center, radius, thickness, color);
+}
 
-	auto& ref = ApplicationRenderer::GetInstance();
-	glm::vec4 col = ref.disabledLineColor;
+void CircleShape::AddSnapFeatures(SnapIndex& index) const {
+	index.AddCircle(center, radius);
+}
 
-	if (layerSelected) { // Shape is selected
-		if (shapeSelected) {
-			if (shapeHovered) {	// Shape is selected and hovered
-				col = (ref.hoveredLineColor + ref.selectedLineColor) / 2.f;
-			}
-			else {
-				col = ref.selectedLineColor;
-			}
-		}
-		else {			// Shape is simply hovered
-			if (shapeHovered) {
-				col = ref.hoveredLineColor;
-			}
-			else {
-				col = color;
-			}
-		}
-	}
+void CircleShape::AddToClipboard(ShapeClipboard& clipboard) const {
+	clipboard.AddCircle(center, radius, thickness, color);
+}
 
-	ApplicationRenderer::DrawCircleWorkspace(center, radius, thickness, col);
+void CircleShape::AddToStore(ShapeStore& store) const {
+	store.AddCircle(center, radius, thickness);
 }
 
 void CircleShape::RenderExport(glm::vec2 min, glm::vec2 max, float width, float height) const {
@@ -3,6 +3,10 @@
 #include "pch.h"
 #include "Shapes/LineShape.h"
 #include "ApplicationRenderer.h"
+#include "ShapeBatch.h"
+#include "SnapIndex.h"
+#include "ShapeClipboard.h"
+#include "ShapeStore.h"
 #include "Navigator.h"
 #include "Fonts/Fonts.h"
 
@@ -21,7 +25,7 @@ LineShape::LineShape(const nlohmann::json& j) {
 	LoadJson(j);
 }
 
-ShapePTR LineShape::Duplicate() {
+ShapePTR LineShape::Duplicate() const {
 	return std::make_shared<LineShape>(p1, p2, thickness, color);
 }
 
@@ -33,19 +37,11 @@ std::string LineShape::GetTypeString() const {
 
 
 std::pair<glm::vec2, glm::vec2> LineShape::GetBoundingBox() const {
-
-	float u = thickness / 2.f;
-	glm::vec2 _min = { std::min(p1.x, p2.x) - u, std::min(p1.y, p2.y) - u };
-	glm::vec2 _max = { std::max(p1.x, p2.x) + u, std::max(p1.y, p2.y) + u };
-
-	return std::make_pair(_min, _max);
+	return ShapeStore::GetBoundingBox(ShapeStore::Line{ p1, p2, thickness, GetID() });
 }
 
 bool LineShape::IsInSelectionBox(const glm::vec2& s1, const glm::vec2& s2) const {
-
-	// Should be selected if at least one of the two points is within the selection box
-	return (IsInbetween(p1.x, s1.x, s2.x) && IsInbetween(p1.y, s1.y, s2.y)) ||
-		(IsInbetween(p2.x, s1.x, s2.x) && IsInbetween(p2.y, s1.y, s2.y));
+	return ShapeStore::IsInSelectionBox(ShapeStore::Line{ p1, p2, thickness, GetID() }, s1, s2);
 }
 
 bool LineShape::ShouldBeRendered(float screenWidth, float screenHeight) const {
@@ -59,23 +55,7 @@ bool LineShape::ShouldBeRendered(float screenWidth, float screenHeight) const {
 }
 
 float LineShape::GetDistanceToCursor(const glm::vec2& p) const {
-	glm::vec2 aToB = p2 - p1;
-	glm::vec2 aToP = p - p1;
-	glm::vec2 bToA = p1 - p2;
-	glm::vec2 bToP = p - p2;
-
-	if (aToB.length() == 0)
-		return (float)aToP.length();
-
-	if (glm::dot(aToB, aToP) < 0) {
-		return dist(p1, p);
-	}
-	else if (glm::dot(bToA, bToP) < 0) {
-		return dist(p2, p);
-	}
-	else {
-		return GetNormalDistanceToLine(p);
-	}
+	return ShapeStore::GetDistanceToCursor(ShapeStore::Line{ p1, p2, thickness, GetID() }, p);
 }
 
 bool LineShape::IsShapeHovered(const glm::vec2& cursor, float thresholdDistance) const {
@@ -179,32 +159,20 @@ void LineShape::RenderPreview() const {
 	ApplicationRenderer::DrawLineWorkspace(p1, p2, thickness, color);
 }
 
-void LineShape::Render(bool layerSelected, bool shapeSelected, bool shapeHovered) const {
-
-	auto& ref = ApplicationRenderer::GetInstance();
-	glm::vec4 col = ref.disabledLineColor;
+void LineShape::AddToBatch(ShapeBatch& batch) const {
+	batch.AddLine(p1, p2, thickness, color);
+}
 
-	if (layerSelected) { // Shape is selected
-		if (shapeSelected) {
-			if (shapeHovered) {	// Shape is selected and hovered
-				col = (ref.hoveredLineColor + ref.selectedLineColor) / 2.f;
-			}
-			else {
-				col = ref.selectedLineColor;
-			}
-		}
-		else {			// Shape is simply hovered
-			if (shapeHovered) {
-				col = ref.hoveredLineColor;
-			}
-			else {
-				col = color;
-			}
-		}
-	}
+void LineShape::AddSnapFeatures(SnapIndex& index) const {
+	index.AddLine(p1, p2);
+}
 
-	ApplicationRenderer::DrawLineWorkspace(p1, p2, thickness, col);
+void LineShape::AddToClipboard(ShapeClipboard& clipboard) const {
+	clipboard.AddLine(p1, p2, thickness, color);
+}
 
+void LineShape::AddToStore(ShapeStore& store) const {
+	store.AddLine(p1, p2, thickness);
 }
 
 void LineShape::RenderExport(glm::vec2 min, glm::vec2 max, float width, float height) const {
@@ -2,7 +2,9 @@
 #include "pch.h"
 #include "SketchFile.h"
 #include "Navigator.h"
+#include "PngWriter.h"
 #include "Battery/AllegroDeps.h"
+#include <future>
 
 void SketchFile::UpdateWindowTitle() {
 	std::string file = Battery::GetBasename(filename);
@@ -266,11 +268,12 @@ bool SketchFile::OpenFile(const std::string& path, bool silent) {
 	return false;
 }
 
-Battery::Bitmap SketchFile::ExportImage(bool transparent, float dpi) {
+bool SketchFile::GetExportFrame(float dpi, glm::vec2& min, glm::vec2& max, float& width, float& height) {
 
 	// Calculate the bounding box
-	glm::vec2 min = GetActiveLayer().GetBoundingBox().first;
-	glm::vec2 max = GetActiveLayer().GetBoundingBox().second;
+	auto activeBound = GetActiveLayer().GetBoundingBox();
+	min = activeBound.first;
+	max = activeBound.second;
 	for (auto& layer : GetLayers()) {
 		auto bound = layer.GetBoundingBox();
 
@@ -287,10 +290,17 @@ Battery::Bitmap SketchFile::ExportImage(bool transparent, float dpi) {
 
 	// Calculate image size
 	float dpmm = dpi / 25.4;	// Convert dots per inch to dots per mm
-	float width = sizeX * dpmm;
-	float height = width / sizeX * sizeY;
+	width = sizeX * dpmm;
+	height = width / sizeX * sizeY;
+
+	return !(width <= 0.0 || height <= 0.0 || isnan(width) || isnan(height));
+}
 
-	if (width <= 0.0 || height <= 0.0 || isnan(width) || isnan(height))
+Battery::Bitmap SketchFile::ExportImage(bool transparent, float dpi) {
+
+	glm::vec2 min, max;
+	float width, height;
+	if (!GetExportFrame(dpi, min, max, width, height))
 		return Battery::Bitmap();
 
 	// Initialize texture image to render on
@@ -329,3 +339,124 @@ Battery::Bitmap SketchFile::ExportImage(bool transparent, float dpi) {
 	//LOG_WARN("Export finished");
 	return image;
 }
+
+// Renders the part [tileMin, tileMax] of the drawing into the tile bitmap, only shapes touching the tile are drawn
+static void RenderExportTile(Battery::Bitmap& tile, const std::vector<std::pair<ShapePTR, std::pair<glm::vec2, glm::vec2>>>& shapes,
+	glm::vec2 tileMin, glm::vec2 tileMax, bool transparent) {
+
+	std::unique_ptr<Battery::Scene> scene = std::make_unique<Battery::Scene>(Battery::GetMainWindow(), tile);
+	Battery::Renderer2D::BeginScene(scene.get());
+
+	if (transparent) {
+		al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_INVERSE_ALPHA);
+		Battery::Renderer2D::DrawBackground(COLOR_TRANSPARENT);
+	}
+	else {
+		Battery::Renderer2D::DrawBackground(EXPORT_BACKGROUND_COLOR);
+	}
+
+	for (auto& [shape, bound] : shapes) {
+		if (bound.second.x < tileMin.x || bound.first.x > tileMax.x ||
+			bound.second.y < tileMin.y || bound.first.y > tileMax.y) {
+			continue;
+		}
+		shape->RenderExport(tileMin, tileMax, EXPORT_TILE_SIZE, EXPORT_TILE_SIZE);
+	}
+
+	Battery::Renderer2D::EndScene();
+}
+
+bool SketchFile::ExportImageToFile(const std::string& path, bool transparent, float dpi) {
+
+	glm::vec2 min, max;
+	float width, height;
+	if (!GetExportFrame(dpi, min, max, width, height))
+		return false;
+
+	uint32_t imageWidth = (uint32_t)width;
+	uint32_t imageHeight = (uint32_t)height;
+	PngWriter png;
+	if (!png.Open(path, imageWidth, imageHeight))
+		return false;
+
+	// Bounding boxes are computed once, grown by a few pixels for the antialiasing falloff.
+	// Layers are rendered in reverse order, like in ExportImage
+	glm::vec2 worldPerPixel = (max - min) / glm::vec2(width, height);
+	glm::vec2 cullMargin = worldPerPixel * (float)EXPORT_TILE_CULL_MARGIN;
+	std::vector<std::pair<ShapePTR, std::pair<glm::vec2, glm::vec2>>> shapes;
+	auto& layers = GetLayers();
+	for (size_t layerIndex = layers.size() - 1; layerIndex < layers.size(); layerIndex--) {
+		for (auto& shape : layers[layerIndex].GetShapes()) {
+			auto bound = shape->GetBoundingBox();
+			shapes.push_back({ shape, { bound.first - cullMargin, bound.second + cullMargin } });
+		}
+	}
+
+	// A failed export must not leave a truncated PNG behind, the file is removed and the user is told
+	auto fail = [&](const std::string& reason) {
+		png.Abort();
+		Battery::RemoveFile(path);
+		LOG_ERROR("Failed to export '{}': {}", path, reason);
+		Battery::ShowErrorMessageBox("The image '" + path + "' could not be exported: " + reason,
+			Battery::GetMainWindow().allegroDisplayPointer);
+		return false;
+	};
+
+	// Tiles are rendered on the main thread, because the Allegro display owns the GL context. A full row of tiles
+	// forms a strip, which is encoded on a worker thread while the next strip is rendered. Two strips are in memory
+	// at once, each the full image width by EXPORT_TILE_SIZE rows, so memory grows with the width but not the height.
+	Battery::Bitmap tile(EXPORT_TILE_SIZE, EXPORT_TILE_SIZE);
+	if (!tile) {
+		return fail("The export tile could not be created");
+	}
+	size_t rowSize = (size_t)imageWidth * 4;
+	std::vector<uint8_t> strips[2];
+	std::future<void> encoder;
+	int stripIndex = 0;
+
+	for (uint32_t tileY = 0; tileY < imageHeight; tileY += EXPORT_TILE_SIZE) {
+		uint32_t rows = std::min<uint32_t>(EXPORT_TILE_SIZE, imageHeight - tileY);
+		auto& strip = strips[stripIndex];
+		strip.resize(rowSize * rows);
+
+		for (uint32_t tileX = 0; tileX < imageWidth; tileX += EXPORT_TILE_SIZE) {
+			uint32_t columns = std::min<uint32_t>(EXPORT_TILE_SIZE, imageWidth - tileX);
+			glm::vec2 tileMin = min + worldPerPixel * glm::vec2(tileX, tileY);
+			glm::vec2 tileMax = tileMin + worldPerPixel * (float)EXPORT_TILE_SIZE;
+			RenderExportTile(tile, shapes, tileMin, tileMax, transparent);
+
+			ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(tile.GetAllegroBitmap(),
+				ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+			if (!region) {
+				if (encoder.valid()) encoder.wait();
+				return fail("The export tile could not be read back");
+			}
+			for (uint32_t y = 0; y < rows; y++) {
+				const uint8_t* source = (const uint8_t*)region->data + (ptrdiff_t)y * region->pitch;
+				memcpy(strip.data() + y * rowSize + (size_t)tileX * 4, source, (size_t)columns * 4);
+			}
+			al_unlock_bitmap(tile.GetAllegroBitmap());
+		}
+
+		if (encoder.valid()) {
+			encoder.wait();
+		}
+		encoder = std::async(std::launch::async, [&png, &strip, rows, rowSize]() {
+			for (uint32_t y = 0; y < rows; y++) {
+				png.WriteRow(strip.data() + y * rowSize);
+			}
+		});
+		stripIndex = 1 - stripIndex;
+	}
+
+	if (encoder.valid()) {
+		encoder.wait();
+	}
+	if (!png.Close()) {
+		Battery::RemoveFile(path);
+		Battery::ShowErrorMessageBox("The image '" + path + "' could not be written!",
+			Battery::GetMainWindow().allegroDisplayPointer);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,493 @@
+#include "pch.h"
+#include "SnapIndex.h"
+#include "Layer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#undef max
+#undef min
+
+// Angle from the X-Axis to the vector in degrees, range 0 to 360 counterclockwise like in the ArcTool
+static float GetAngle(const glm::vec2& v) {
+	float angle = glm::degrees(atan2(v.y, v.x));
+	return angle < 0 ? angle + 360.f : angle;
+}
+
+static float WrapAngle(float angle) {
+	angle = fmod(angle, 360.f);
+	return angle < 0 ? angle + 360.f : angle;
+}
+
+static glm::vec2 GetPointOnCircle(const glm::vec2& center, float radius, float angle) {
+	return center + glm::vec2(cos(glm::radians(angle)), sin(glm::radians(angle))) * radius;
+}
+
+static float Cross(const glm::vec2& a, const glm::vec2& b) {
+	return a.x * b.y - a.y * b.x;
+}
+
+const char* GetSnapTypeName(SnapType type) {
+	switch (type) {
+	case SnapType::GRID:			return "Grid";
+	case SnapType::ENDPOINT:		return "Endpoint";
+	case SnapType::MIDPOINT:		return "Midpoint";
+	case SnapType::CENTER:			return "Center";
+	case SnapType::INTERSECTION:	return "Intersection";
+	case SnapType::TANGENT:			return "Tangent";
+	default:						return "None";
+	}
+}
+
+void SnapIndex::Update(const Layer& layer) {
+	if (layer.GetRevision() == revision) {
+		return;
+	}
+	uint64_t previousRevision = revision;
+	revision = layer.GetRevision();
+
+	// Usually only the shapes that changed since the last update have to be looked at
+	bool updated = previousRevision != 0 && layer.ForEachChangedShape(previousRevision, [&](ShapeID id, const ShapePTR& shape) {
+		if (shape) {
+			SetShape(shape);
+			return;
+		}
+		auto it = slotIndices.find(id);
+		if (it != slotIndices.end()) {
+			RemoveShape(it->second);
+		}
+	});
+
+	// Otherwise, e.g. after switching to another layer, all shapes are compared. Unchanged
+	// shapes are still the same objects and keep their points.
+	if (!updated) {
+		for (const auto& shape : layer.GetShapes()) {
+			slots[SetShape(shape)].revision = revision;
+		}
+		for (uint32_t i = 0; i < slots.size(); i++) {
+			if (slots[i].shape && slots[i].revision != revision) {
+				RemoveShape(i);
+			}
+		}
+	}
+
+	// The points of new shapes are scanned linearly, which only pays off while there are few of them
+	size_t pending = features.size() - treeSize;
+	if (pending > std::max<size_t>(SNAP_INDEX_MIN_PENDING, treeSize / SNAP_INDEX_PENDING_RATIO) ||
+		deadFeatures > features.size() / 2) {
+		Rebuild();
+	}
+}
+
+// Adds the shape, or processes it again if it is a different object than before. Returns its slot.
+uint32_t SnapIndex::SetShape(const ShapePTR& shape) {
+	auto it = slotIndices.find(shape->GetID());
+	if (it != slotIndices.end()) {
+		Slot& slot = slots[it->second];
+		if (slot.shape != shape) {
+			deadFeatures += slot.numberOfPoints;
+			slot.version++;
+			slot.shape = shape;
+			AddShape(it->second);
+			curves.Update(shape->GetID(), shape->GetBoundingBox());
+		}
+		return it->second;
+	}
+
+	uint32_t index;
+	if (freeSlots.empty()) {
+		index = (uint32_t)slots.size();
+		slots.emplace_back();
+	}
+	else {
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	slotIndices[shape->GetID()] = index;
+	slots[index].shape = shape;
+	AddShape(index);
+	curves.Insert(shape->GetID(), shape->GetBoundingBox());
+	return index;
+}
+
+void SnapIndex::AddShape(uint32_t slot) {
+	currentSlot = slot;
+	slots[slot].curve = Curve();
+	slots[slot].numberOfPoints = 0;
+	slots[slot].shape->AddSnapFeatures(*this);
+}
+
+void SnapIndex::RemoveShape(uint32_t slot) {
+	Slot& s = slots[slot];
+	deadFeatures += s.numberOfPoints;
+	s.version++;
+	s.numberOfPoints = 0;
+	curves.Remove(s.shape->GetID());
+	slotIndices.erase(s.shape->GetID());
+	s.shape.reset();
+	freeSlots.push_back(slot);
+}
+
+void SnapIndex::AddFeature(const glm::vec2& position, SnapType type) {
+	Slot& slot = slots[currentSlot];
+	features.push_back({ position, currentSlot, slot.version, type });
+	slot.numberOfPoints++;
+}
+
+void SnapIndex::AddLine(const glm::vec2& p1, const glm::vec2& p2) {
+	Curve& curve = slots[currentSlot].curve;
+	curve.primitive = Primitive::LINE;
+	curve.p1 = p1;
+	curve.p2 = p2;
+
+	AddFeature(p1, SnapType::ENDPOINT);
+	AddFeature(p2, SnapType::ENDPOINT);
+	AddFeature((p1 + p2) / 2.f, SnapType::MIDPOINT);
+}
+
+void SnapIndex::AddCircle(const glm::vec2& center, float radius) {
+	Curve& curve = slots[currentSlot].curve;
+	curve.primitive = Primitive::CIRCLE;
+	curve.center = center;
+	curve.radius = radius;
+
+	AddFeature(center, SnapType::CENTER);
+}
+
+void SnapIndex::AddArc(const glm::vec2& center, float radius, float startAngle, float endAngle) {
+	Curve& curve = slots[currentSlot].curve;
+	curve.primitive = Primitive::ARC;
+	curve.center = center;
+	curve.radius = radius;
+	curve.startAngle = startAngle;
+	curve.endAngle = endAngle;
+
+	float span = WrapAngle(endAngle - startAngle);
+	AddFeature(center, SnapType::CENTER);
+	AddFeature(GetPointOnCircle(center, radius, startAngle), SnapType::ENDPOINT);
+	AddFeature(GetPointOnCircle(center, radius, endAngle), SnapType::ENDPOINT);
+	AddFeature(GetPointOnCircle(center, radius, startAngle + span / 2.f), SnapType::MIDPOINT);
+}
+
+void SnapIndex::Rebuild() {
+	features.erase(std::remove_if(features.begin(), features.end(), [&](const Feature& feature) {
+		return !IsAlive(feature);
+	}), features.end());
+
+	deadFeatures = 0;
+	treeSize = features.size();
+	Build(0, treeSize, 0);
+}
+
+// The tree is implicit: the median of every range is the node, the halves before and after it
+// are its children. The axis alternates between x and y with every level.
+void SnapIndex::Build(size_t begin, size_t end, int axis) {
+	if (end - begin <= 1) {
+		return;
+	}
+
+	size_t mid = begin + (end - begin) / 2;
+	std::nth_element(features.begin() + begin, features.begin() + mid, features.begin() + end,
+		[axis](const Feature& a, const Feature& b) {
+			return a.position[axis] < b.position[axis];
+		});
+
+	Build(begin, mid, 1 - axis);
+	Build(mid + 1, end, 1 - axis);
+}
+
+void SnapIndex::FindNearest(size_t begin, size_t end, int axis, const glm::vec2& cursor, float& bestDistance2, size_t& best) const {
+	if (begin >= end) {
+		return;
+	}
+
+	size_t mid = begin + (end - begin) / 2;
+	const Feature& feature = features[mid];
+	glm::vec2 d = cursor - feature.position;
+	float distance2 = glm::dot(d, d);
+	if (distance2 < bestDistance2 && IsAlive(feature)) {
+		bestDistance2 = distance2;
+		best = mid;
+	}
+
+	// Removed points still split the space, only their position is of interest here
+	float offset = cursor[axis] - feature.position[axis];
+	if (offset < 0) {
+		FindNearest(begin, mid, 1 - axis, cursor, bestDistance2, best);
+		if (offset * offset < bestDistance2) {
+			FindNearest(mid + 1, end, 1 - axis, cursor, bestDistance2, best);
+		}
+	}
+	else {
+		FindNearest(mid + 1, end, 1 - axis, cursor, bestDistance2, best);
+		if (offset * offset < bestDistance2) {
+			FindNearest(begin, mid, 1 - axis, cursor, bestDistance2, best);
+		}
+	}
+}
+
+static bool IsOnArc(float startAngle, float endAngle, float angle) {
+	if (abs(endAngle - startAngle) >= 360.f) {
+		return true;
+	}
+
+	float span = WrapAngle(endAngle - startAngle);
+	float offset = WrapAngle(angle - startAngle);
+	return offset <= span + SNAP_ANGLE_TOLERANCE || offset >= 360.f - SNAP_ANGLE_TOLERANCE;
+}
+
+static bool IsOnCurve(const glm::vec2& point, const glm::vec2& center, float startAngle, float endAngle, bool arc) {
+	return !arc || IsOnArc(startAngle, endAngle, GetAngle(point - center));
+}
+
+static float GetDistanceToSegment(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b) {
+	glm::vec2 ab = b - a;
+	float length2 = glm::dot(ab, ab);
+	float t = length2 > 0 ? glm::clamp(glm::dot(p - a, ab) / length2, 0.f, 1.f) : 0.f;
+	return glm::distance(p, a + ab * t);
+}
+
+void SnapIndex::AddIntersections(const Curve& a, const Curve& b, std::vector<glm::vec2>& points) {
+	if (a.primitive != Primitive::LINE && b.primitive == Primitive::LINE) {
+		AddIntersections(b, a, points);
+		return;
+	}
+
+	if (a.primitive == Primitive::LINE && b.primitive == Primitive::LINE) {
+		glm::vec2 da = a.p2 - a.p1;
+		glm::vec2 db = b.p2 - b.p1;
+		float denominator = Cross(da, db);
+		if (abs(denominator) < 1e-9f) {		// Parallel
+			return;
+		}
+
+		float t = Cross(b.p1 - a.p1, db) / denominator;
+		float u = Cross(b.p1 - a.p1, da) / denominator;
+		if (t >= 0 && t <= 1 && u >= 0 && u <= 1) {
+			points.push_back(a.p1 + da * t);
+		}
+	}
+	else if (a.primitive == Primitive::LINE) {
+		// Solve |p1 + t * d - center| = radius for t
+		glm::vec2 d = a.p2 - a.p1;
+		glm::vec2 f = a.p1 - b.center;
+		float qa = glm::dot(d, d);
+		float qb = 2.f * glm::dot(f, d);
+		float qc = glm::dot(f, f) - b.radius * b.radius;
+		float discriminant = qb * qb - 4.f * qa * qc;
+		if (qa <= 0 || discriminant < 0) {
+			return;
+		}
+
+		float root = sqrt(discriminant);
+		for (float t : { (-qb - root) / (2.f * qa), (-qb + root) / (2.f * qa) }) {
+			glm::vec2 point = a.p1 + d * t;
+			if (t >= 0 && t <= 1 && IsOnCurve(point, b.center, b.startAngle, b.endAngle, b.primitive == Primitive::ARC)) {
+				points.push_back(point);
+			}
+		}
+	}
+	else {
+		glm::vec2 d = b.center - a.center;
+		float distance = glm::length(d);
+		if (distance <= 0 || distance > a.radius + b.radius || distance < abs(a.radius - b.radius)) {
+			return;
+		}
+
+		// Distance from the center of a to the chord through both intersections, and half its length
+		float along = (a.radius * a.radius - b.radius * b.radius + distance * distance) / (2.f * distance);
+		float across = sqrt(std::max(a.radius * a.radius - along * along, 0.f));
+		glm::vec2 direction = d / distance;
+		glm::vec2 normal = { -direction.y, direction.x };
+		for (float side : { -1.f, 1.f }) {
+			glm::vec2 point = a.center + direction * along + normal * (across * side);
+			if (IsOnCurve(point, a.center, a.startAngle, a.endAngle, a.primitive == Primitive::ARC) &&
+				IsOnCurve(point, b.center, b.startAngle, b.endAngle, b.primitive == Primitive::ARC)) {
+				points.push_back(point);
+			}
+		}
+	}
+}
+
+void SnapIndex::AddTangents(const Curve& curve, const glm::vec2& reference, std::vector<glm::vec2>& points) {
+	if (curve.primitive == Primitive::LINE) {
+		return;
+	}
+
+	glm::vec2 d = reference - curve.center;
+	float distance = glm::length(d);
+	if (distance <= curve.radius) {
+		return;
+	}
+
+	// The tangent points are where the radius is perpendicular to the line from the reference
+	float base = GetAngle(d);
+	float offset = glm::degrees(acos(curve.radius / distance));
+	for (float angle : { base - offset, base + offset }) {
+		if (curve.primitive == Primitive::CIRCLE || IsOnArc(curve.startAngle, curve.endAngle, angle)) {
+			points.push_back(GetPointOnCircle(curve.center, curve.radius, angle));
+		}
+	}
+}
+
+float SnapIndex::GetDistanceToCurve(const Curve& curve, const glm::vec2& p) {
+	switch (curve.primitive) {
+	case Primitive::LINE:
+		return GetDistanceToSegment(p, curve.p1, curve.p2);
+	case Primitive::CIRCLE:
+		return abs(glm::distance(p, curve.center) - curve.radius);
+	case Primitive::ARC:
+		if (IsOnArc(curve.startAngle, curve.endAngle, GetAngle(p - curve.center))) {
+			return abs(glm::distance(p, curve.center) - curve.radius);
+		}
+		return std::min(glm::distance(p, GetPointOnCircle(curve.center, curve.radius, curve.startAngle)),
+			glm::distance(p, GetPointOnCircle(curve.center, curve.radius, curve.endAngle)));
+	default:
+		return std::numeric_limits<float>::max();
+	}
+}
+
+std::optional<SnapPoint> SnapIndex::FindSnapPoint(const glm::vec2& cursor, float radius,
+	const std::optional<glm::vec2>& reference) const {
+
+	SnapPoint result;
+	float bestDistance2 = radius * radius;
+
+	// Fixed points: the tree and the points that were added since it was built
+	size_t best = features.size();
+	FindNearest(0, treeSize, 0, cursor, bestDistance2, best);
+	for (size_t i = treeSize; i < features.size(); i++) {
+		glm::vec2 d = cursor - features[i].position;
+		float distance2 = glm::dot(d, d);
+		if (distance2 < bestDistance2 && IsAlive(features[i])) {
+			bestDistance2 = distance2;
+			best = i;
+		}
+	}
+	if (best < features.size()) {
+		result = { features[best].position, features[best].type };
+	}
+
+	// Intersections and tangents can only be close to the cursor if their curves are
+	std::vector<std::pair<float, const Curve*>> nearCurves;
+	curves.Query(cursor - glm::vec2(radius), cursor + glm::vec2(radius), [&](ShapeID id) {
+		const Curve& curve = slots[slotIndices.at(id)].curve;
+		float distance = GetDistanceToCurve(curve, cursor);
+		if (distance <= radius) {
+			nearCurves.push_back({ distance, &curve });
+		}
+	});
+
+	if (nearCurves.size() > SNAP_MAX_CURVES) {
+		std::partial_sort(nearCurves.begin(), nearCurves.begin() + SNAP_MAX_CURVES, nearCurves.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
+		nearCurves.resize(SNAP_MAX_CURVES);
+	}
+
+	auto choose = [&](const std::vector<glm::vec2>& points, SnapType type) {
+		for (const auto& point : points) {
+			glm::vec2 d = cursor - point;
+			float distance2 = glm::dot(d, d);
+			if (distance2 < bestDistance2) {
+				bestDistance2 = distance2;
+				result = { point, type };
+			}
+		}
+	};
+
+	std::vector<glm::vec2> points;
+	for (size_t i = 0; i < nearCurves.size(); i++) {
+		for (size_t j = i + 1; j < nearCurves.size(); j++) {
+			AddIntersections(*nearCurves[i].second, *nearCurves[j].second, points);
+		}
+	}
+	choose(points, SnapType::INTERSECTION);
+
+	if (reference) {
+		points.clear();
+		for (const auto& curve : nearCurves) {
+			AddTangents(*curve.second, reference.value(), points);
+		}
+		choose(points, SnapType::TANGENT);
+	}
+
+	if (result.type == SnapType::NONE) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+void BenchmarkSnapIndex(size_t numberOfShapes) {
+	using Clock = std::chrono::high_resolution_clock;
+	const size_t numberOfQueries = 10000;
+	const size_t numberOfEdits = 100;
+	const float extent = 10000.f;
+	const float radius = 2.f;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(0.f, extent);
+	std::uniform_real_distribution<float> offset(-20.f, 20.f);
+	std::uniform_real_distribution<float> size(1.f, 20.f);
+	std::uniform_real_distribution<float> angle(0.f, 360.f);
+
+	auto makeShape = [&](size_t i) {
+		glm::vec2 p = { position(random), position(random) };
+		switch (i % 3) {
+		case 0:
+			return GenericShape::MakeShape(ShapeType::LINE, p, p + glm::vec2(offset(random), offset(random)),
+				DEFAULT_LINE_THICKNESS, DEFAULT_LINE_COLOR);
+		case 1:
+			return GenericShape::MakeShape(ShapeType::CIRCLE, p, size(random), DEFAULT_LINE_THICKNESS, DEFAULT_LINE_COLOR);
+		default:
+			return GenericShape::MakeShape(ShapeType::ARC, p, size(random), angle(random), angle(random),
+				DEFAULT_LINE_THICKNESS, DEFAULT_LINE_COLOR);
+		}
+	};
+
+	Layer layer("Benchmark");
+	std::vector<ShapePTR> shapes;
+	for (size_t i = 0; i < numberOfShapes; i++) {
+		shapes.push_back(makeShape(i));
+	}
+	layer.AddShapes(std::move(shapes));
+
+	SnapIndex index;
+	auto start = Clock::now();
+	index.Update(layer);
+	double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::vector<glm::vec2> cursors;
+	for (size_t i = 0; i < numberOfQueries; i++) {
+		cursors.push_back({ position(random), position(random) });
+	}
+	glm::vec2 reference = { extent / 2.f, extent / 2.f };
+
+	auto measureQueries = [&](size_t& hits) {
+		hits = 0;
+		auto start = Clock::now();
+		for (const auto& cursor : cursors) {
+			hits += index.FindSnapPoint(cursor, radius, reference).has_value();
+		}
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / numberOfQueries;
+	};
+
+	size_t hits = 0;
+	double queryUs = measureQueries(hits);
+
+	// Single edits only append the points of the new shape
+	double editMs = 0;
+	for (size_t i = 0; i < numberOfEdits; i++) {
+		layer.AddShapes({ makeShape(i) });
+		start = Clock::now();
+		index.Update(layer);
+		editMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+	size_t editedHits = 0;
+	double editedQueryUs = measureQueries(editedHits);
+
+	LOG_INFO("Snap index benchmark with {} shapes ({} points)", numberOfShapes, index.GetNumberOfFeatures());
+	LOG_INFO("Build {:.2f} ms, update after a single edit {:.3f} ms", buildMs, editMs / numberOfEdits);
+	LOG_INFO("Snap query {:.2f} us ({} / {} hits), after {} edits {:.2f} us",
+		queryUs, hits, numberOfQueries, numberOfEdits, editedQueryUs);
+}
@@ -13,6 +13,7 @@ void LineStripTool::OnSpaceClicked(const glm::vec2& position, const glm::vec2& s
 		previewLine.SetPoint1(snapped);
 		previewLine.SetPoint2(snapped);
 		Navigator::GetInstance()->previewPointShown = false;
+		Navigator::GetInstance()->snapReference = snapped;
 		lineStarted = true;
 	}
 	else if (left) {						// Continue the line
@@ -20,6 +21,7 @@ void LineStripTool::OnSpaceClicked(const glm::vec2& position, const glm::vec2& s
 		Navigator::GetInstance()->AddLine(previewLine);
 		previewLine.SetPoint1(snapped);
 		Navigator::GetInstance()->previewPointShown = false;
+		Navigator::GetInstance()->snapReference = snapped;
 	} 
 	else {
 		CancelShape();
@@ -51,6 +53,7 @@ void LineStripTool::OnLayerSelected(LayerID layer) {
 void LineStripTool::CancelShape() {
 	Navigator::GetInstance()->previewPointPosition = Navigator::GetInstance()->mouseSnapped;
 	Navigator::GetInstance()->previewPointShown = true;
+	Navigator::GetInstance()->snapReference.reset();
 	lineStarted = false;
 }
 
@@ -15,6 +15,7 @@ void LineTool::OnSpaceClicked(const glm::vec2& position, const glm::vec2& snappe
 			previewLine.SetPoint1(snapped);
 			previewLine.SetPoint2(snapped);
 			Navigator::GetInstance()->previewPointShown = false;
+			Navigator::GetInstance()->snapReference = snapped;
 			lineStarted = true;
 		}
 		else {						// Finish a line
@@ -56,6 +57,7 @@ void LineTool::OnLayerSelected(LayerID layer) {
 void LineTool::CancelShape() {
 	Navigator::GetInstance()->previewPointPosition = Navigator::GetInstance()->mouseSnapped;
 	Navigator::GetInstance()->previewPointShown = true;
+	Navigator::GetInstance()->snapReference.reset();
 	lineStarted = false;
 }
 
@@ -5,6 +5,7 @@
 #include "Navigator.h"
 #include "Application.h"
 #include "Shapes/GenericShape.h"
+#include "ShapeClipboard.h"
 
 void SelectionTool::OnToolChanged() {
 	Navigator::GetInstance()->previewPointShown = false;
@@ -71,10 +72,9 @@ void SelectionTool::OnMouseReleased(const glm::vec2& position, bool left, bool r
 			}
 
 			// Select all shapes inside the selection box
-			for (const auto& shape : Navigator::GetInstance()->file.GetActiveLayer().GetShapes()) {
-				if (shape->IsInSelectionBox(selectionBoxPointA, selectionBoxPointB)) {
-					selectionHandler.SelectShape(shape->GetID());
-				}
+			auto& layer = Navigator::GetInstance()->file.GetActiveLayer();
+			for (ShapeID id : layer.FindShapesInBox(selectionBoxPointA, selectionBoxPointB)) {
+				selectionHandler.SelectShape(id);
 			}
 		}
 	}
@@ -96,8 +96,8 @@ void SelectionTool::CopyClipboard() {
 
 	if (selectionHandler.GetSelectedShapes().size() != 0) {
 		LOG_INFO("Copying selected shapes to clipboard");
-		nlohmann::json j = Navigator::GetInstance()->file.GetJsonFromShapes(selectionHandler.GetSelectedShapes());
-		Battery::GetMainWindow().SetClipboardCustomFormatString(Navigator::GetInstance()->clipboardShapeFormat, j.dump(4));
+		std::string payload = Navigator::GetInstance()->file.GetClipboardPayloadFromShapes(selectionHandler.GetSelectedShapes());
+		Battery::GetMainWindow().SetClipboardCustomFormatString(Navigator::GetInstance()->clipboardShapeFormat, payload);
 	}
 	else {
 		LOG_WARN("Nothing copied to clipboard: No shapes selected");
@@ -108,8 +108,8 @@ void SelectionTool::CutClipboard() {
 
 	if (selectionHandler.GetSelectedShapes().size() != 0) {
 		LOG_INFO("Cutting selected shapes to clipboard");
-		nlohmann::json j = Navigator::GetInstance()->file.GetJsonFromShapes(selectionHandler.GetSelectedShapes());
-		Battery::GetMainWindow().SetClipboardCustomFormatString(Navigator::GetInstance()->clipboardShapeFormat, j.dump(4));
+		std::string payload = Navigator::GetInstance()->file.GetClipboardPayloadFromShapes(selectionHandler.GetSelectedShapes());
+		Battery::GetMainWindow().SetClipboardCustomFormatString(Navigator::GetInstance()->clipboardShapeFormat, payload);
 		Navigator::GetInstance()->file.RemoveShapes(selectionHandler.GetSelectedShapes());
 		selectionHandler.ClearSelection();
 	}
@@ -130,16 +130,15 @@ void SelectionTool::PasteClipboard() {
 	LOG_INFO("Pasting clipboard to active Layer");
 	
 	// First create all shapes
-	std::vector<ShapePTR> shapes;
-	try {
-		nlohmann::json j = nlohmann::json::parse(opt.value());
-	
-		for (nlohmann::json shapeData : j) {
-			shapes.push_back(GenericShape::MakeShape(shapeData));
-		}
+	auto pasted = ShapeClipboard::ReadPayload(opt.value());
+	if (!pasted.has_value()) {
+		LOG_ERROR("Can't paste clipboard shapes: Clipboard format is invalid!");
+		return;
 	}
-	catch (...) {
-		LOG_ERROR("Can't paste clipboard shapes: JSON format is invalid!");
+
+	std::vector<ShapePTR> shapes = std::move(pasted.value());
+	if (shapes.empty()) {
+		LOG_WARN("Nothing usable on the clipboard");
 		return;
 	}
 	
@@ -1,5 +1,6 @@
 
 #include "renderer.cpp"
+#include "pageexport.cpp"
 
 #include "shader.cpp"
 #include <SDL3/SDL_events.h>
@@ -7,6 +8,103 @@
 #include <SDL3/SDL_scancode.h>
 #include <SDL3/SDL_touch.h>
 
+const auto STREAM_VERTEX_BUFFER_SEGMENT_SIZE = 1024 * 1024;
+const auto STREAM_INDEX_BUFFER_SEGMENT_SIZE = 256 * 1024;
+
+void initAppConstants(App* app)
+{
+  app->pageGapPercentOfHeight = 2.f;
+  app->currentlyDrawingOnPage = -1;
+  app->perfectFreehandAccuracyScaling = 10;
+  app->penPressureScaling = 1;
+}
+
+// Bump these whenever the code that creates the resource group changes. Resources survive a hot-reload as long as
+// the new library reports the same version, shaders are tagged with a hash of their sources instead.
+const uint32_t GPU_BUFFERS_RESOURCE_VERSION = 1;
+const uint32_t SVG_OPTIONS_RESOURCE_VERSION = 1;
+
+static uint64_t hashShaderSources()
+{
+  const char* sources[] = {
+    mainVertexShaderSrc,
+    mainFragmentShaderSrc,
+    lineshapeVertexShader,
+    lineshapeFragmentShader,
+    paperVertexShaderSrc,
+    paperFragmentShaderSrc,
+  };
+  uint64_t hash = FNV_OFFSET_BASIS;
+  for (auto source : sources) {
+    hash = hashString(hash, source);
+  }
+  return hash;
+}
+
+static void loadShaders(App* app)
+{
+  app->mainShader = CreateShaderProgram(mainVertexShaderSrc, mainFragmentShaderSrc);
+  app->lineshapeShader = CreateShaderProgram(lineshapeVertexShader, lineshapeFragmentShader);
+  app->paperShader = CreateShaderProgram(paperVertexShaderSrc, paperFragmentShaderSrc);
+}
+
+static void unloadShaders(App* app)
+{
+  glDeleteProgram(app->mainShader);
+  app->mainShader = 0;
+  glDeleteProgram(app->lineshapeShader);
+  app->lineshapeShader = 0;
+  glDeleteProgram(app->paperShader);
+  app->paperShader = 0;
+}
+
+static void loadGpuBuffers(App* app)
+{
+  createGpuProfiler(app);
+  glGenVertexArrays(1, &app->mainViewportVAO);
+  glGenVertexArrays(1, &app->paperVAO);
+  glGenBuffers(1, &app->mainViewportVBO);
+  glGenBuffers(1, &app->mainViewportIBO);
+  app->mainViewportStreamVBO = gl::StreamBuffer::create(GL_ARRAY_BUFFER, STREAM_VERTEX_BUFFER_SEGMENT_SIZE);
+  app->mainViewportStreamIBO = gl::StreamBuffer::create(GL_ELEMENT_ARRAY_BUFFER, STREAM_INDEX_BUFFER_SEGMENT_SIZE);
+  glGenVertexArrays(1, &app->rendererData.uiVAO);
+  glGenBuffers(1, &app->rendererData.uiVBO);
+  glGenBuffers(1, &app->rendererData.uiIBO);
+}
+
+static void unloadGpuBuffers(App* app)
+{
+  glDeleteVertexArrays(1, &app->rendererData.uiVAO);
+  app->rendererData.uiVAO = 0;
+  glDeleteBuffers(1, &app->rendererData.uiVBO);
+  app->rendererData.uiVBO = 0;
+  glDeleteBuffers(1, &app->rendererData.uiIBO);
+  app->rendererData.uiIBO = 0;
+  glDeleteVertexArrays(1, &app->mainViewportVAO);
+  app->mainViewportVAO = 0;
+  glDeleteVertexArrays(1, &app->paperVAO);
+  app->paperVAO = 0;
+  glDeleteBuffers(1, &app->mainViewportVBO);
+  app->mainViewportVBO = 0;
+  glDeleteBuffers(1, &app->mainViewportIBO);
+  app->mainViewportIBO = 0;
+  app->mainViewportStreamVBO.free();
+  app->mainViewportStreamIBO.free();
+  glDeleteRenderbuffers(1, &app->mainViewportRBO);
+  app->mainViewportRBO = 0;
+  glDeleteTextures(1, &app->mainViewportTEX);
+  app->mainViewportTEX = 0;
+  destroyGpuProfiler(app);
+}
+
+static void unloadSvgOptions(App* app)
+{
+  if (app->svgOpts) {
+    resvg_options_destroy(app->svgOpts);
+    app->svgOpts = 0;
+  }
+}
+
 extern "C" __declspec(dllexport) void LoadApp(App* app, bool firstLoad)
 {
   app->clayArena.clearAndReinit();
@@ -22,6 +120,7 @@ extern "C" __declspec(dllexport) void LoadApp(App* app, bool firstLoad)
 
   Clay_Initialize(clayMemory, Clay_Dimensions { (float)width, (float)height }, Clay_ErrorHandler { HandleClayErrors });
   Clay_SetMeasureTextFunction(MeasureText, app);
+  RecordStartupPhase(app, "Clay init");
 
   if (firstLoad) {
     auto an = app->persistentApplicationArena;
@@ -46,82 +145,78 @@ extern "C" __declspec(dllexport) void LoadApp(App* app, bool firstLoad)
     SDL_Log("Couldn't load GLAD");
   }
 
-  app->rendererData.fontContext = glfonsCreate(512, 512, FONS_ZERO_TOPLEFT);
-  if (app->rendererData.fontContext == NULL) {
-    print("Could not create stash.\n");
+  // Only the resource groups whose version differs from the one that is currently loaded are recreated
+  auto& versions = app->loadedResourceVersions;
+  uint64_t shaderVersion = hashShaderSources();
+  if (versions.shaders != shaderVersion) {
+    if (versions.shaders) {
+      unloadShaders(app);
+    }
+    loadShaders(app);
+    versions.shaders = shaderVersion;
   }
-
-  app->rendererData.fonts = app->persistentApplicationArena.allocate<int>(1);
-  app->rendererData.numberOfFonts = 0;
-  // auto roboto = b::embed<"resources/Roboto-Regular.ttf">();
-  // auto font
-  // = fonsAddFontMem(app->rendererData.fontContext, "Roboto", (unsigned char*)roboto.data(), roboto.length(), 0);
-  auto font = fonsAddFont(app->rendererData.fontContext, "RobotoRegular", "resource/Roboto-Regular.ttf");
-  // auto font
-  //     = fonsAddFont(app->rendererData.fontContext, "JetBrainsMono",
-  //     "resources/JetBrainsMonoNerdFontMono-Medium.ttf");
-  if (font == FONS_INVALID) {
-    ts::panic("Could not add font normal.\n");
+  RecordStartupPhase(app, "Shaders");
+  if (versions.gpuBuffers != GPU_BUFFERS_RESOURCE_VERSION) {
+    if (versions.gpuBuffers) {
+      unloadGpuBuffers(app);
+    }
+    loadGpuBuffers(app);
+    versions.gpuBuffers = GPU_BUFFERS_RESOURCE_VERSION;
+  }
+  RecordStartupPhase(app, "GPU buffers");
+  // The SVG options are created on first use by getSvgOptions()
+  if (versions.svgOptions != SVG_OPTIONS_RESOURCE_VERSION) {
+    unloadSvgOptions(app);
+    versions.svgOptions = SVG_OPTIONS_RESOURCE_VERSION;
   }
-  app->rendererData.fonts[app->rendererData.numberOfFonts++] = font;
 
   glViewport(0, 0, width, height);
-  app->mainShader = CreateShaderProgram(mainVertexShaderSrc, mainFragmentShaderSrc);
-  app->lineshapeShader = CreateShaderProgram(lineshapeVertexShader, lineshapeFragmentShader);
   glUseProgram(app->mainShader);
   setPixelProjection(app, width, height);
   glEnable(GL_DEPTH_TEST);
   glDepthFunc(GL_LESS);
 
-  glGenVertexArrays(1, &app->mainViewportVAO);
-  glGenBuffers(1, &app->mainViewportVBO);
-  glGenBuffers(1, &app->mainViewportIBO);
-  glGenVertexArrays(1, &app->rendererData.uiVAO);
-  glGenBuffers(1, &app->rendererData.uiVBO);
-  glGenBuffers(1, &app->rendererData.uiIBO);
-
-  addDocument(app);
-  addEmptyPageToDocument(app, app->documents.back());
-  addEmptyPageToDocument(app, app->documents.back());
-  addEmptyPageToDocument(app, app->documents.back());
-
-  app->pageGapPercentOfHeight = 2.f;
-  app->currentlyDrawingOnPage = -1;
-  app->perfectFreehandAccuracyScaling = 10;
-  app->penPressureScaling = 1;
+  // Documents are kept across reloads, including the page framebuffers
+  if (app->documents.length == 0) {
+    addDocument(app);
+    addEmptyPageToDocument(app, app->documents.back());
+    addEmptyPageToDocument(app, app->documents.back());
+    addEmptyPageToDocument(app, app->documents.back());
+  }
 
-  resvg_init_log();
-  app->svgOpts = resvg_options_create();
-  resvg_options_load_system_fonts(app->svgOpts);
-  resvg_options_set_stylesheet(app->svgOpts, "svg { fill: white; }");
+  initAppConstants(app);
+  RecordStartupPhase(app, "Documents");
 }
 
-extern "C" __declspec(dllexport) void UnloadApp(App* app)
+// On a hot-reload only state that points into this library is dropped, everything else is reused by the next
+// LoadApp. The profiler scope names are string literals of this library, so pending results are discarded, and
+// running saves and exports are finished because their threads execute code of this library.
+extern "C" __declspec(dllexport) void UnloadApp(App* app, bool lastUnload)
 {
-  resvg_options_destroy(app->svgOpts);
+  if (!lastUnload) {
+    for (auto& document : app->documents) {
+      waitForDocumentSave(app, document);
+      waitForDocumentExport(app, document);
+    }
+    for (size_t i = 0; i < app->gpuProfiler.NUM_FRAMES; i++) {
+      app->gpuProfiler.numQueries[i] = 0;
+    }
+    app->lastFrameProfilingResults.numOfResults = 0;
+    app->lastFrameProfilingResults.numOfGpuResults = 0;
+    app->currentProfilingResults.numOfResults = 0;
+    app->currentProfilingResults.numOfGpuResults = 0;
+    return;
+  }
 
   for (auto& document : app->documents) {
     unloadDocument(app, document);
   }
+  app->documents.clear();
 
-  glDeleteVertexArrays(1, &app->rendererData.uiVAO);
-  app->rendererData.uiVAO = 0;
-  glDeleteBuffers(1, &app->rendererData.uiVBO);
-  app->rendererData.uiVBO = 0;
-  glDeleteBuffers(1, &app->rendererData.uiIBO);
-  app->rendererData.uiIBO = 0;
-  glDeleteVertexArrays(1, &app->mainViewportVAO);
-  app->mainViewportVAO = 0;
-  glDeleteBuffers(1, &app->mainViewportVBO);
-  app->mainViewportVBO = 0;
-  glDeleteBuffers(1, &app->mainViewportIBO);
-  app->mainViewportIBO = 0;
-  glDeleteRenderbuffers(1, &app->mainViewportRBO);
-  app->mainViewportRBO = 0;
-  glDeleteTextures(1, &app->mainViewportTEX);
-  app->mainViewportTEX = 0;
-  glDeleteProgram(app->mainShader);
-  app->mainShader = 0;
+  unloadSvgOptions(app);
+  unloadGpuBuffers(app);
+  unloadShaders(app);
+  app->loadedResourceVersions = {};
 }
 
 extern "C" __declspec(dllexport) SDL_AppResult EventHandler(App* app, SDL_Event* event)
@@ -207,11 +302,18 @@ extern "C" __declspec(dllexport) SDL_AppResult EventHandler(App* app, SDL_Event*
 
   case SDL_EVENT_KEY_DOWN:
     if (event->key.scancode == SDL_SCANCODE_S && (event->key.mod & SDL_KMOD_LCTRL)) {
-      saveDocumentToFile(app, app->documents[app->selectedDocument], "output.json");
+      requestDocumentSave(app, app->documents[app->selectedDocument], "output.json"_s);
     }
     if (event->key.scancode == SDL_SCANCODE_O && (event->key.mod & SDL_KMOD_LCTRL)) {
       openDocumentFromFile(app, "output.json");
     }
+    if (event->key.scancode == SDL_SCANCODE_E && (event->key.mod & SDL_KMOD_LCTRL)) {
+      startDocumentExport(app, app->documents[app->selectedDocument],
+          { .format = ExportFormat::Pdf, .outputPath = "output.pdf"_s, .dpi = 0, .numberOfThreads = 0 });
+    }
+    if (event->key.scancode == SDL_SCANCODE_F3) {
+      app->showRenderStats = !app->showRenderStats;
+    }
     if (event->key.scancode == SDL_SCANCODE_LCTRL || event->key.scancode == SDL_SCANCODE_RCTRL) {
       app->inputs.ctrl = true;
     }
@@ -260,7 +362,14 @@ void DoRenderWork(App* app)
 
   Clay_RenderCommandArray renderCommands = Clay_EndLayout();
 
-  SDL_Clay_RenderClayCommands(&app->rendererData, &renderCommands);
+  {
+    GPU_PROFILE_SCOPE("UI");
+    app->rendererData.drawCalls = 0;
+    app->rendererData.vertices = 0;
+    SDL_Clay_RenderClayCommands(&app->rendererData, &renderCommands);
+    app->currentProfilingResults.counters.drawCalls += app->rendererData.drawCalls;
+    app->currentProfilingResults.counters.vertices += app->rendererData.vertices;
+  }
 
   setPixelProjection(app, app->mainViewportBB.width, app->mainViewportBB.height);
 
@@ -278,7 +387,14 @@ void DoRenderWork(App* app)
 
 extern "C" __declspec(dllexport) void RenderApp(App* app)
 {
+  for (auto& document : app->documents) {
+    updateDocumentSave(app, document);
+    updateDocumentExport(app, document);
+    updateDocumentJournal(app, document);
+  }
+
   ProfilerInstance::profileFrametime(app);
+  beginGpuProfilerFrame(app);
   DoRenderWork(app);
 
   // Profiling done now
@@ -289,4 +405,5 @@ extern "C" __declspec(dllexport) void RenderApp(App* app)
 
   // And reinit
   app->currentProfilingResults.numOfResults = 0;
+  app->currentProfilingResults.counters = {};
 }
\ No newline at end of file
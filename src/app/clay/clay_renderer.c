@@ -19,9 +19,19 @@ typedef struct {
   TTF_Font** fonts;
 } Clay_SDL3RendererData;
 
-/* Global for convenience. Even in 4K this is enough for smooth curves (low radius or rect size coupled with
- * no AA or low resolution might make it appear as jagged curves) */
-static int NUM_CIRCLE_SEGMENTS = 16;
+// Curves are tessellated so that no segment deviates more than this from the exact curve, in pixels. A segment
+// spanning the angle a deviates by radius * (1 - cos(a / 2)), so small corners get a few segments and large arcs many.
+static const float CIRCLE_MAX_ERROR = 0.25f;
+static const int MAX_CIRCLE_SEGMENTS = 256;
+
+static int GetCircleSegments(float radius, float angle)
+{
+  if (radius <= CIRCLE_MAX_ERROR) {
+    return 1;
+  }
+  const float segmentAngle = 2 * SDL_acosf(1 - CIRCLE_MAX_ERROR / radius);
+  return SDL_clamp((int)SDL_ceilf(SDL_fabsf(angle) / segmentAngle), 1, MAX_CIRCLE_SEGMENTS);
+}
 
 // all rendering is performed by a single SDL call, avoiding multiple RenderRect + plumbing choice for circles.
 void SDL_Clay_RenderFillRoundedRect(
@@ -34,7 +44,7 @@ void SDL_Clay_RenderFillRoundedRect(
   const float minRadius = SDL_min(rect.w, rect.h) / 2.0f;
   const float clampedRadius = SDL_min(cornerRadius, minRadius);
 
-  const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int)clampedRadius * 0.5f);
+  const int numCircleSegments = GetCircleSegments(clampedRadius, SDL_PI_F / 2);
 
   int totalVertices = 4 + (4 * (numCircleSegments * 2)) + 2 * 4;
   int totalIndices = 6 + (4 * (numCircleSegments * 3)) + 6 * 4;
@@ -181,7 +191,7 @@ static void GL_FillRoundedRect(
   const float minRadius = SDL_min(rect.w, rect.h) / 2.0f;
   const float clampedRadius = SDL_min(radius, minRadius);
 
-  const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int)clampedRadius * 0.5f);
+  const int numCircleSegments = GetCircleSegments(clampedRadius, SDL_PI_F / 2);
 
   int totalVertices = 4 + (4 * (numCircleSegments * 2)) + 2 * 4;
   int totalIndices = 6 + (4 * (numCircleSegments * 3)) + 6 * 4;
@@ -349,6 +359,8 @@ static void GL_FillRoundedRect(
   glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(3 * sizeof(float)));
   glEnableVertexAttribArray(1);
   glDrawElements(GL_TRIANGLES, totalIndices, GL_UNSIGNED_INT, (void*)0);
+  rendererData->drawCalls++;
+  rendererData->vertices += totalVertices;
 
   if (color.a != 255.f) {
     glDepthMask(GL_TRUE);
@@ -369,8 +381,7 @@ void SDL_Clay_RenderArc(Clay_SDL3RendererData* rendererData, const SDL_FPoint ce
   const float radStart = startAngle * (SDL_PI_F / 180.0f);
   const float radEnd = endAngle * (SDL_PI_F / 180.0f);
 
-  const int numCircleSegments = SDL_max(
-      NUM_CIRCLE_SEGMENTS, (int)(radius * 1.5f)); // increase circle segments for larger circles, 1.5 is arbitrary.
+  const int numCircleSegments = GetCircleSegments(radius, radEnd - radStart);
 
   const float angleStep = (radEnd - radStart) / (float)numCircleSegments;
   const float thicknessStep = 0.4f; // arbitrary value to avoid overlapping lines. Changing THICKNESS_STEP or
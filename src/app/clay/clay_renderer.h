@@ -28,6 +28,10 @@ typedef struct {
   GLuint uiVAO;
   GLuint uiVBO;
   GLuint uiIBO;
+
+  // Statistics, reset by the caller
+  size_t drawCalls;
+  size_t vertices;
 } RendererData;
 
 void SDL_Clay_RenderClayCommands(RendererData* rendererData, Clay_RenderCommandArray* rcommands);
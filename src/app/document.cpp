@@ -7,30 +7,47 @@
 #include <SDL3/SDL_pen.h>
 #include <SDL3/SDL_video.h>
 
-#include "cJSON.h"
+#include "journal.cpp"
+#include "jsonreader.cpp"
+#include "snapshot.cpp"
 
 const auto RAMER_DOUGLAS_PEUCKER_SMOOTHING = 0.2;
 const auto DOCUMENT_START_POSITION = Vec2(300, 100);
 const auto DOCUMENT_DEFAULT_ZOOM_MM_PER_PX = 0.2;
+const auto DOCUMENT_DEFAULT_PAPER_STYLE = PaperStyle::Squared;
+const auto DOCUMENT_DEFAULT_GRID_SPACING_MM = 5.f;
 
-void addDocument(App* app)
+Document createEmptyDocument()
 {
-  Document document = Document {
+  return Document {
     .zoomMmPerPx = DOCUMENT_DEFAULT_ZOOM_MM_PER_PX,
     .pageScroll = 0,
     .position = DOCUMENT_START_POSITION,
     .pages = {},
     .paperColor = Color(255, 255, 255, 255),
+    .paperStyle = DOCUMENT_DEFAULT_PAPER_STYLE,
+    .gridSpacingMm = DOCUMENT_DEFAULT_GRID_SPACING_MM,
     .arena = Arena::create(),
   };
-  app->documents.push(app->persistentApplicationArena, document);
 }
 
+void addDocument(App* app)
+{
+  app->documents.push(app->persistentApplicationArena, createEmptyDocument());
+}
+
+void waitForDocumentExport(App* app, Document& document);
+
 void unloadDocument(App* app, Document& document)
 {
+  document.save.requested = false;
+  waitForDocumentSave(app, document);
+  waitForDocumentExport(app, document);
+  closeDocumentJournal(app, document);
   for (auto& page : document.pages) {
     page.tempRenderTexture.free();
     page.persistentFBO.free();
+    page.previewFBO.free();
   }
   document.arena.free();
 }
@@ -41,151 +58,208 @@ void addEmptyPageToDocument(App* app, Document& document)
     .document = &document,
     .pageNumId = document.pages.length,
     .shapes = {},
-    .persistentFBO = gl::Framebuffer::create(),
-    .previewFBO = gl::Framebuffer::create(),
   };
 
   document.pages.push(document.arena, page);
+  journalAddPage(app, document);
 }
 
-void saveDocumentToFile(App* app, Document& document, String filepath)
+struct DocumentReadState {
+  JsonReader& reader;
+  Document& document;
+  float accuracyScaling;
+  // Points of the shape being read. Grows to the largest stroke in the file, not to the size of the file.
+  SamplePoint* points;
+  size_t numberOfPoints;
+  size_t pointsCapacity;
+};
+
+static void readDocumentPoint(DocumentReadState& state)
 {
-  static Arena* arena;
-  Arena _arena = Arena::create();
-  arena = &_arena;
-  cJSON_Hooks hooks = {
-    .malloc_fn = [](size_t size) -> void* { return arena->allocate<char>(size); },
-    .free_fn = [](void* ptr) {},
-  };
-  cJSON_InitHooks(&hooks);
-
-  auto file = cJSON_CreateObject();
-  cJSON_AddStringToObject(file, "filetype", "technicalsketcher");
-  cJSON_AddNumberToObject(file, "fileversion", 1);
-  cJSON_AddStringToObject(file, "papercolor", document.paperColor.toHex(*arena).c_str(*arena));
+  auto& reader = state.reader;
+  char keyBuffer[JSON_READER_MAX_KEY_LENGTH];
+  String key;
+  double x = 0, y = 0, pressure = 0;
+  bool hasPosition = true;
+  reader.enterObject();
+  while (reader.nextKey(key, keyBuffer)) {
+    // NaN and Inf are written as null: A point without a position is dropped, a missing pressure is 0
+    if (reader.peek() == 'n') {
+      hasPosition = hasPosition && !(key == "x") && !(key == "y");
+      reader.skipValue();
+    } else if (key == "x") {
+      reader.readNumber(x);
+    } else if (key == "y") {
+      reader.readNumber(y);
+    } else if (key == "pressure") {
+      reader.readNumber(pressure);
+    } else {
+      reader.skipValue();
+    }
+  }
+  if (!hasPosition) {
+    return;
+  }
 
-  auto pages = cJSON_AddArrayToObject(file, "pages");
+  if (state.numberOfPoints == state.pointsCapacity) {
+    state.pointsCapacity = max(state.pointsCapacity * 2, (size_t)256);
+    state.points = (SamplePoint*)realloc(state.points, state.pointsCapacity * sizeof(SamplePoint));
+    if (!state.points) {
+      ts::panic("Out of memory while reading the document");
+    }
+  }
+  state.points[state.numberOfPoints++] = SamplePoint {
+    .pos_mm_scaled = Vec2(x * state.accuracyScaling, y * state.accuracyScaling),
+    .pressure = (float)pressure,
+  };
+}
 
-  for (auto& page : document.pages) {
-    auto pageJson = cJSON_CreateObject();
-    auto shapesArray = cJSON_AddArrayToObject(pageJson, "shapes");
-    for (auto& shape : page.shapes) {
-      auto shapeJson = cJSON_CreateObject();
-      cJSON_AddStringToObject(shapeJson, "color", shape.color.toHex(*arena).c_str(*arena));
-      auto pointsArray = cJSON_AddArrayToObject(shapeJson, "points");
-      for (auto& point : shape.points) {
-        auto pointJson = cJSON_CreateObject();
-        cJSON_AddNumberToObject(pointJson, "x", point.pos_mm_scaled.x / app->perfectFreehandAccuracyScaling);
-        cJSON_AddNumberToObject(pointJson, "y", point.pos_mm_scaled.y / app->perfectFreehandAccuracyScaling);
-        cJSON_AddNumberToObject(pointJson, "pressure", point.pressure);
-        cJSON_AddItemToArray(pointsArray, pointJson);
+static void readDocumentShape(DocumentReadState& state, Page& page)
+{
+  auto& reader = state.reader;
+  char keyBuffer[JSON_READER_MAX_KEY_LENGTH];
+  char color[16] = "";
+  String key;
+  size_t colorLength;
+  state.numberOfPoints = 0;
+  reader.enterObject();
+  while (reader.nextKey(key, keyBuffer)) {
+    if (key == "color") {
+      reader.readString(color, sizeof(color), colorLength);
+    } else if (key == "points") {
+      reader.enterArray();
+      while (reader.nextItem()) {
+        readDocumentPoint(state);
       }
-      cJSON_AddItemToArray(shapesArray, shapeJson);
+    } else {
+      reader.skipValue();
     }
-    cJSON_AddItemToArray(pages, pageJson);
   }
 
-  const char* jsonContent = cJSON_PrintUnformatted(file);
+  LineShape shape = LineShape {
+    .points = {},
+    .color = Color(color),
+    .prerendered = false,
+  };
+  shape.points.pushAll(state.document.arena, state.points, state.numberOfPoints);
+  page.shapes.push(state.document.arena, shape);
+}
 
-  FILE* f = fopen(filepath.c_str(*arena), "w");
-  if (!f) {
-    ts::panic("File failed to write");
+static void readDocumentPage(DocumentReadState& state)
+{
+  auto& reader = state.reader;
+  auto& document = state.document;
+  char keyBuffer[JSON_READER_MAX_KEY_LENGTH];
+  String key;
+  document.pages.push(document.arena,
+      Page {
+          .document = &document,
+          .pageNumId = document.pages.length,
+          .shapes = {},
+      });
+  Page& page = document.pages.back();
+
+  reader.enterObject();
+  while (reader.nextKey(key, keyBuffer)) {
+    if (key == "shapes") {
+      reader.enterArray();
+      while (reader.nextItem()) {
+        readDocumentShape(state, page);
+      }
+    } else {
+      reader.skipValue();
+    }
   }
-  fprintf(f, "%s", jsonContent);
-  fclose(f);
-
-  arena->free();
 }
 
-void openDocumentFromFile(App* app, String filepath)
+// Reads the file into an empty document. The file is streamed with a pull parser instead of being parsed into a DOM,
+// so loading large documents only needs memory for the document itself. Without `journaling` nothing is written next
+// to the file, for the headless tools.
+void loadDocumentFromFile(App* app, Document& document, String filepath, bool journaling)
 {
-  static Arena* arena;
-  Arena _arena = Arena::create();
-  arena = &_arena;
-  cJSON_Hooks hooks = {
-    .malloc_fn = [](size_t size) -> void* { return arena->allocate<char>(size); },
-    .free_fn = [](void* ptr) {},
-  };
-  cJSON_InitHooks(&hooks);
-
-  for (auto& doc : app->documents) {
-    unloadDocument(app, doc);
+  Arena arena = Arena::create();
+  auto openedReader = JsonReader::open(arena, filepath);
+  if (!openedReader) {
+    ts::panic("File failed to read");
   }
-  app->documents.clear();
+  auto reader = *openedReader;
 
-  auto file = ts::fs::read(*arena, filepath);
-  if (!file) {
-    ts::panic("File failed to read");
+  document.filepath = String::clone(document.arena, filepath);
+
+  DocumentReadState state = {
+    .reader = reader,
+    .document = document,
+    .accuracyScaling = app->perfectFreehandAccuracyScaling,
+    .points = 0,
+    .numberOfPoints = 0,
+    .pointsCapacity = 0,
+  };
+  char keyBuffer[JSON_READER_MAX_KEY_LENGTH];
+  char filetype[32] = "";
+  char paperColor[16] = "";
+  size_t stringLength;
+  String key;
+  double fileversion = 0;
+  double number;
+  uint64_t journalSequence = 0;
+
+  reader.enterObject();
+  while (reader.nextKey(key, keyBuffer)) {
+    if (key == "filetype") {
+      reader.readString(filetype, sizeof(filetype), stringLength);
+    } else if (key == "fileversion") {
+      reader.readNumber(fileversion);
+    } else if (key == "papercolor") {
+      reader.readString(paperColor, sizeof(paperColor), stringLength);
+      document.paperColor = Color(paperColor);
+    } else if (key == "paperstyle" && reader.peek() != 'n') {
+      reader.readNumber(number);
+      document.paperStyle = (PaperStyle)number;
+    } else if (key == "gridspacing" && reader.peek() != 'n') {
+      reader.readNumber(number);
+      document.gridSpacingMm = number;
+    } else if (key == "journalsequence" && reader.peek() != 'n') {
+      reader.readNumber(number);
+      journalSequence = number;
+    } else if (key == "pages") {
+      reader.enterArray();
+      while (reader.nextItem()) {
+        readDocumentPage(state);
+      }
+    } else {
+      reader.skipValue();
+    }
   }
 
-  auto json = cJSON_Parse(file->c_str(*arena));
+  free(state.points);
+  reader.close();
+  arena.free();
 
-  auto filetype = cJSON_GetStringValue(cJSON_GetObjectItem(json, "filetype"));
+  if (reader.failed) {
+    ts::panic("File is not valid JSON");
+  }
   if (String::view(filetype) != "technicalsketcher") {
     ts::panic("Unexpected file type");
   }
-  auto fileversion = cJSON_GetNumberValue(cJSON_GetObjectItem(json, "fileversion"));
   if (fileversion != 1.0) {
     ts::panic("Unexpected file version");
   }
 
-  Document _document = Document {
-    .zoomMmPerPx = DOCUMENT_DEFAULT_ZOOM_MM_PER_PX,
-    .pageScroll = 0,
-    .position = DOCUMENT_START_POSITION,
-    .pages = {},
-    .paperColor = Color(cJSON_GetStringValue(cJSON_GetObjectItem(json, "papercolor"))),
-    .arena = Arena::create(),
-  };
-  app->documents.push(app->persistentApplicationArena, _document);
-  auto& document = app->documents.back();
-
-  auto pagesArray = cJSON_GetObjectItem(json, "pages");
-  auto numPages = cJSON_GetArraySize(pagesArray);
-
-  for (int i = 0; i < numPages; i++) {
-    auto pageJson = cJSON_GetArrayItem(pagesArray, i);
-
-    document.pages.push(document.arena,
-        Page {
-            .document = &document,
-            .pageNumId = i,
-            .shapes = {},
-            .persistentFBO = gl::Framebuffer::create(),
-            .previewFBO = gl::Framebuffer::create(),
-        });
-    Page& page = document.pages.back();
-
-    auto shapesArray = cJSON_GetObjectItem(pageJson, "shapes");
-    auto numShapes = cJSON_GetArraySize(shapesArray);
-
-    for (int i = 0; i < numShapes; i++) {
-      auto shapeJson = cJSON_GetArrayItem(shapesArray, i);
-      LineShape shape = LineShape {
-        .points = {},
-        .color = cJSON_GetStringValue(cJSON_GetObjectItem(shapeJson, "color")),
-        .prerendered = false,
-      };
-
-      auto pointsArray = cJSON_GetObjectItem(shapeJson, "points");
-      auto numPoints = cJSON_GetArraySize(pointsArray);
-
-      for (int i = 0; i < numPoints; i++) {
-        auto pointJson = cJSON_GetArrayItem(pointsArray, i);
-        shape.points.push(document.arena,
-            {
-                .pos_mm_scaled
-                = Vec2(cJSON_GetNumberValue(cJSON_GetObjectItem(pointJson, "x")) * app->perfectFreehandAccuracyScaling,
-                    cJSON_GetNumberValue(cJSON_GetObjectItem(pointJson, "y")) * app->perfectFreehandAccuracyScaling),
-                .pressure = cJSON_GetNumberValue(cJSON_GetObjectItem(pointJson, "pressure")),
-            });
-      }
+  if (size_t numRecords = replayDocumentJournal(app, document, journalSequence, journaling)) {
+    print("Recovered {} changes from the journal of '{}'", numRecords, filepath);
+  }
+}
 
-      page.shapes.push(document.arena, shape);
-    }
+// Replaces all open documents with the one from the file
+void openDocumentFromFile(App* app, String filepath, bool journaling = true)
+{
+  for (auto& doc : app->documents) {
+    unloadDocument(app, doc);
   }
+  app->documents.clear();
 
-  arena->free();
+  app->documents.push(app->persistentApplicationArena, createEmptyDocument());
+  loadDocumentFromFile(app, app->documents.back(), filepath, journaling);
 }
 
 void zoomInAtPoint(App* app, double amount, Vec2 point)
@@ -341,6 +415,7 @@ void processPenUpEvent(App* app, SDL_PenTouchEvent event)
 
   auto& page = document.pages[app->currentlyDrawingOnPage];
   page.shapes.push(document.arena, document.currentLine);
+  journalAddStroke(app, document, app->currentlyDrawingOnPage, document.currentLine);
   document.currentLine = {};
   app->currentlyDrawingOnPage = -1;
 
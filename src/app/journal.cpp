@@ -0,0 +1,369 @@
+#include "../shared/app.h"
+#include <stdio.h>
+
+// Every document that has a file on disk gets a journal next to it ("<file>.journal"). Committed changes are
+// appended to the journal as they happen, so a crash only loses the changes since the last fsync. Writing a
+// snapshot of the whole document compacts the journal.
+//
+// Every record carries a sequence number and the snapshot stores the sequence number of the first record it does
+// not contain. Replay skips older records, so the journal can be compacted at any time after the snapshot is on
+// disk, and a crash in between never applies a change twice.
+//
+// File layout: "TSKJRNL\0", u32 version, followed by records of
+// [u64 sequence, u16 kind, u16 reserved, u32 payload size, u32 payload checksum, u32 reserved, payload]. Replay stops
+// at the first record that is truncated or fails the checksum, which is where the app crashed while writing.
+
+const char DOCUMENT_JOURNAL_MAGIC[8] = { 'T', 'S', 'K', 'J', 'R', 'N', 'L', '\0' };
+const uint32_t DOCUMENT_JOURNAL_VERSION = 1;
+const size_t DOCUMENT_JOURNAL_HEADER_SIZE = sizeof(DOCUMENT_JOURNAL_MAGIC) + sizeof(uint32_t);
+const size_t DOCUMENT_JOURNAL_SYNC_BATCH_RECORDS = 16;
+const uint64_t DOCUMENT_JOURNAL_SYNC_INTERVAL_MS = 500;
+const size_t DOCUMENT_JOURNAL_COMPACTION_RECORDS = 512;
+const uint64_t DOCUMENT_JOURNAL_SNAPSHOT_INTERVAL_MS = 60 * 1000;
+
+enum class JournalRecordKind : uint16_t {
+  AddStroke = 0,
+  RemoveStroke = 1,
+  AddPage = 2,
+};
+
+struct JournalRecordHeader {
+  uint64_t sequence;
+  uint16_t kind;
+  uint16_t reserved;
+  uint32_t size;
+  uint32_t checksum;
+  uint32_t reserved2;
+};
+
+void addEmptyPageToDocument(App* app, Document& document);
+
+static uint32_t getJournalChecksum(const char* data, size_t length)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static String getJournalPath(Arena& arena, String documentPath)
+{
+  return format(arena, "{}.journal", documentPath);
+}
+
+template <typename T> static void appendJournalValue(App* app, ts::StringBuffer& buffer, const T& value)
+{
+  buffer.append(app->frameArena, String::view((const char*)&value, sizeof(T)));
+}
+
+template <typename T> static bool readJournalValue(String payload, size_t& cursor, T& value)
+{
+  if (cursor + sizeof(T) > payload.length) {
+    return false;
+  }
+  memcpy(&value, payload.data + cursor, sizeof(T));
+  cursor += sizeof(T);
+  return true;
+}
+
+// Opens the journal for appending when the first change is made, so that opening a document doesn't write anything.
+// Only called when the journal on disk is missing or holds no records, otherwise it was rewritten on load.
+static bool openDocumentJournal(App* app, Document& document)
+{
+  auto& journal = document.journal;
+  if (journal.disabled || document.filepath.length == 0) {
+    return false;
+  }
+
+  auto path = getJournalPath(app->frameArena, document.filepath);
+  journal.file = fopen(path.c_str(app->frameArena), "ab");
+  if (!journal.file) {
+    print("Failed to open journal '{}', changes are only saved on the next snapshot", path);
+    journal.disabled = true;
+    return false;
+  }
+  if (ftell(journal.file) == 0) {
+    fwrite(DOCUMENT_JOURNAL_MAGIC, sizeof(DOCUMENT_JOURNAL_MAGIC), 1, journal.file);
+    fwrite(&DOCUMENT_JOURNAL_VERSION, sizeof(DOCUMENT_JOURNAL_VERSION), 1, journal.file);
+  }
+  journal.unsyncedRecords = 0;
+  journal.lastSyncNs = SDL_GetTicksNS();
+  return true;
+}
+
+static void writeJournalRecord(App* app, Document& document, JournalRecordKind kind, ts::StringBuffer& payload)
+{
+  auto& journal = document.journal;
+  if (!journal.file && !openDocumentJournal(app, document)) {
+    return;
+  }
+  JournalRecordHeader header = {
+    .sequence = journal.nextSequence++,
+    .kind = (uint16_t)kind,
+    .reserved = 0,
+    .size = (uint32_t)payload.length,
+    .checksum = getJournalChecksum(payload.data, payload.length),
+    .reserved2 = 0,
+  };
+  fwrite(&header, sizeof(header), 1, journal.file);
+  if (payload.length > 0) {
+    fwrite(payload.data, payload.length, 1, journal.file);
+  }
+  journal.unsyncedRecords++;
+  journal.recordsSinceSnapshot++;
+}
+
+void journalAddStroke(App* app, Document& document, size_t pageIndex, LineShape& shape)
+{
+  ts::StringBuffer payload;
+  appendJournalValue(app, payload, (uint32_t)pageIndex);
+  appendJournalValue(app, payload, shape.color);
+  appendJournalValue(app, payload, (uint32_t)shape.points.length);
+  for (auto& point : shape.points) {
+    appendJournalValue(app, payload, point.pos_mm_scaled.x / app->perfectFreehandAccuracyScaling);
+    appendJournalValue(app, payload, point.pos_mm_scaled.y / app->perfectFreehandAccuracyScaling);
+    appendJournalValue(app, payload, point.pressure);
+  }
+  writeJournalRecord(app, document, JournalRecordKind::AddStroke, payload);
+}
+
+void journalRemoveStroke(App* app, Document& document, size_t pageIndex, size_t shapeIndex)
+{
+  ts::StringBuffer payload;
+  appendJournalValue(app, payload, (uint32_t)pageIndex);
+  appendJournalValue(app, payload, (uint32_t)shapeIndex);
+  writeJournalRecord(app, document, JournalRecordKind::RemoveStroke, payload);
+}
+
+void journalAddPage(App* app, Document& document)
+{
+  ts::StringBuffer payload;
+  writeJournalRecord(app, document, JournalRecordKind::AddPage, payload);
+}
+
+static bool applyJournalRecord(App* app, Document& document, JournalRecordKind kind, String payload)
+{
+  size_t cursor = 0;
+  switch (kind) {
+  case JournalRecordKind::AddStroke: {
+    uint32_t pageIndex, numPoints;
+    LineShape shape = {};
+    if (!readJournalValue(payload, cursor, pageIndex) || !readJournalValue(payload, cursor, shape.color)
+        || !readJournalValue(payload, cursor, numPoints) || pageIndex >= document.pages.length) {
+      return false;
+    }
+    for (uint32_t i = 0; i < numPoints; i++) {
+      double x, y;
+      SamplePoint point;
+      if (!readJournalValue(payload, cursor, x) || !readJournalValue(payload, cursor, y)
+          || !readJournalValue(payload, cursor, point.pressure)) {
+        return false;
+      }
+      point.pos_mm_scaled = Vec2(x, y) * app->perfectFreehandAccuracyScaling;
+      shape.points.push(document.arena, point);
+    }
+    document.pages[pageIndex].shapes.push(document.arena, shape);
+    return true;
+  }
+
+  case JournalRecordKind::RemoveStroke: {
+    uint32_t pageIndex, shapeIndex;
+    if (!readJournalValue(payload, cursor, pageIndex) || !readJournalValue(payload, cursor, shapeIndex)
+        || pageIndex >= document.pages.length || shapeIndex >= document.pages[pageIndex].shapes.length) {
+      return false;
+    }
+    size_t index = 0;
+    document.pages[pageIndex].shapes.remove_if([&](auto&) { return index++ == shapeIndex; });
+    return true;
+  }
+
+  case JournalRecordKind::AddPage:
+    addEmptyPageToDocument(app, document);
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+void closeDocumentJournal(App* app, Document& document)
+{
+  auto& journal = document.journal;
+  if (journal.file) {
+    if (!SyncFileToDisk(journal.file)) {
+      print("Failed to sync the journal of '{}'", document.filepath);
+    }
+    fclose(journal.file);
+    journal.file = 0;
+  }
+}
+
+// Calls `callback(header, payload)` for every intact record of the journal file, until the callback returns false.
+// Returns the number of bytes that were read, which is less than the file size if anything was ignored.
+template <typename TFunc> static size_t readJournalRecords(String file, String path, TFunc&& callback)
+{
+  if (file.length < DOCUMENT_JOURNAL_HEADER_SIZE
+      || memcmp(file.data, DOCUMENT_JOURNAL_MAGIC, sizeof(DOCUMENT_JOURNAL_MAGIC)) != 0) {
+    return 0;
+  }
+  uint32_t version;
+  memcpy(&version, file.data + sizeof(DOCUMENT_JOURNAL_MAGIC), sizeof(version));
+  if (version != DOCUMENT_JOURNAL_VERSION) {
+    print("Journal '{}' has an unsupported version, ignoring it", path);
+    return 0;
+  }
+
+  size_t cursor = DOCUMENT_JOURNAL_HEADER_SIZE;
+  while (cursor + sizeof(JournalRecordHeader) <= file.length) {
+    JournalRecordHeader header;
+    memcpy(&header, file.data + cursor, sizeof(header));
+    size_t payloadStart = cursor + sizeof(header);
+    if (payloadStart + header.size > file.length
+        || getJournalChecksum(file.data + payloadStart, header.size) != header.checksum) {
+      print("Journal '{}' ends with an incomplete record, ignoring the rest", path);
+      break;
+    }
+    if (!callback(header, String::view(file.data + payloadStart, header.size))) {
+      print("Journal '{}' contains an invalid record, ignoring the rest", path);
+      break;
+    }
+    cursor = payloadStart + header.size;
+  }
+  return cursor;
+}
+
+// Replaces the journal with one that only contains `records`, through a temporary file so that a crash leaves
+// either the old or the new journal behind. The journal is kept open for appending afterwards.
+static void rewriteDocumentJournal(App* app, Document& document, String records)
+{
+  closeDocumentJournal(app, document);
+  auto& journal = document.journal;
+  if (journal.disabled) {
+    return;
+  }
+  auto path = getJournalPath(app->frameArena, document.filepath);
+  auto tempPath = format(app->frameArena, "{}.tmp", path);
+
+  FILE* file = fopen(tempPath.c_str(app->frameArena), "wb");
+  if (!file) {
+    print("Failed to open journal '{}', changes are only saved on the next snapshot", tempPath);
+    return;
+  }
+  bool written = fwrite(DOCUMENT_JOURNAL_MAGIC, sizeof(DOCUMENT_JOURNAL_MAGIC), 1, file) == 1
+      && fwrite(&DOCUMENT_JOURNAL_VERSION, sizeof(DOCUMENT_JOURNAL_VERSION), 1, file) == 1
+      && (records.length == 0 || fwrite(records.data, records.length, 1, file) == 1) && SyncFileToDisk(file);
+  fclose(file);
+  if (!written || !RenameFileReplacing(app->frameArena, tempPath, path)) {
+    print("Failed to write journal '{}', changes are only saved on the next snapshot", path);
+    return;
+  }
+
+  journal.file = fopen(path.c_str(app->frameArena), "ab");
+  journal.unsyncedRecords = 0;
+  journal.lastSyncNs = SDL_GetTicksNS();
+}
+
+// Applies the journal on top of the snapshot that was just loaded into the document. The journal is only rewritten
+// if records were replayed or dropped, otherwise it is opened on the first change. With `journaling` off the records
+// are still applied, but nothing is written. Returns the number of records that were replayed.
+size_t replayDocumentJournal(App* app, Document& document, uint64_t snapshotSequence, bool journaling)
+{
+  Arena arena = Arena::create();
+  auto path = getJournalPath(arena, document.filepath);
+  auto file = ts::fs::read(arena, path).value_or({});
+
+  auto& journal = document.journal;
+  journal = {};
+  journal.disabled = true; // Pages added by the records must not be journaled again
+  journal.nextSequence = snapshotSequence;
+  journal.lastSnapshotNs = SDL_GetTicksNS();
+
+  ts::StringBuffer records;
+  size_t numRecords = 0;
+  bool dropped = false;
+  size_t bytesRead = readJournalRecords(file, path, [&](JournalRecordHeader& header, String payload) {
+    if (header.sequence < snapshotSequence) {
+      dropped = true;
+      return true;
+    }
+    if (!applyJournalRecord(app, document, (JournalRecordKind)header.kind, payload)) {
+      return false;
+    }
+    records.append(arena, String::view((const char*)&header, sizeof(header)));
+    records.append(arena, payload);
+    journal.nextSequence = header.sequence + 1;
+    numRecords++;
+    return true;
+  });
+
+  journal.disabled = !journaling;
+  if (numRecords > 0 || dropped || bytesRead != file.length) {
+    rewriteDocumentJournal(app, document, records.str());
+  }
+  journal.recordsSinceSnapshot = numRecords;
+  arena.free();
+  return numRecords;
+}
+
+// Drops the records that are contained in a snapshot which is now safely on disk. The remaining records are read
+// from `sourceJournalPath`, which differs from the document's journal when it was saved under a new name.
+void compactDocumentJournal(App* app, Document& document, uint64_t snapshotSequence, String sourceJournalPath)
+{
+  auto& journal = document.journal;
+  if (journal.file && !SyncFileToDisk(journal.file)) {
+    print("Failed to sync the journal of '{}'", document.filepath);
+  }
+
+  Arena arena = Arena::create();
+  auto path = sourceJournalPath;
+  String file = {};
+  if (path.length > 0) {
+    file = ts::fs::read(arena, path).value_or({});
+  }
+
+  ts::StringBuffer records;
+  size_t numRecords = 0;
+  readJournalRecords(file, path, [&](JournalRecordHeader& header, String payload) {
+    if (header.sequence >= snapshotSequence) {
+      records.append(arena, String::view((const char*)&header, sizeof(header)));
+      records.append(arena, payload);
+      numRecords++;
+    }
+    return true;
+  });
+
+  rewriteDocumentJournal(app, document, records.str());
+  journal.recordsSinceSnapshot = numRecords;
+  journal.lastSnapshotNs = SDL_GetTicksNS();
+  arena.free();
+}
+
+bool startDocumentSave(App* app, Document& document, String filepath);
+
+// Called once per frame: Syncs the journal in batches and compacts it with a background snapshot from time to time
+void updateDocumentJournal(App* app, Document& document)
+{
+  auto& journal = document.journal;
+  if (!journal.file) {
+    return;
+  }
+
+  uint64_t now = SDL_GetTicksNS();
+  if (journal.unsyncedRecords >= DOCUMENT_JOURNAL_SYNC_BATCH_RECORDS
+      || (journal.unsyncedRecords > 0 && now - journal.lastSyncNs >= DOCUMENT_JOURNAL_SYNC_INTERVAL_MS * 1000000)) {
+    if (!SyncFileToDisk(journal.file)) {
+      print("Failed to sync the journal of '{}'", document.filepath);
+    }
+    journal.unsyncedRecords = 0;
+    journal.lastSyncNs = now;
+  }
+
+  if (journal.recordsSinceSnapshot >= DOCUMENT_JOURNAL_COMPACTION_RECORDS
+      || (journal.recordsSinceSnapshot > 0
+          && now - journal.lastSnapshotNs >= DOCUMENT_JOURNAL_SNAPSHOT_INTERVAL_MS * 1000000)) {
+    if (startDocumentSave(app, document, document.filepath)) {
+      journal.lastSnapshotNs = now;
+    }
+  }
+}
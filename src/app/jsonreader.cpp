@@ -0,0 +1,307 @@
+#include "../shared/app.h"
+#include <stdio.h>
+
+// Pull parser for JSON files that reads the file in fixed size blocks, so the memory usage does not depend on the
+// file size. The caller walks the structure it expects and skips everything else:
+//
+//   reader.enterObject();
+//   while (reader.nextKey(key, keyBuffer)) {
+//     if (key == "x") reader.readNumber(x); else reader.skipValue();
+//   }
+//
+// Any syntax error sets `failed`, after which all functions return false.
+
+const size_t JSON_READER_BUFFER_SIZE = 64 * 1024;
+// Numbers are parsed from contiguous memory, so this many bytes are kept in the buffer before parsing one. Longer
+// numbers are rejected.
+const size_t JSON_READER_MAX_NUMBER_LENGTH = 64;
+const size_t JSON_READER_MAX_KEY_LENGTH = 64;
+
+// Exactly representable powers of ten, used for the fast path of number parsing
+const double JSON_POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+  1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// Parses a JSON number. Numbers with up to 19 significant digits and a small exponent are computed exactly from
+// the integer mantissa (the mantissa and the power of ten are both exact doubles, so the single rounding of the
+// multiplication or division gives the correctly rounded result). Everything else falls back to strtod.
+static const char* parseJsonNumber(const char* str, const char* end, double& value)
+{
+  const char* start = str;
+  bool negative = false;
+  if (str < end && *str == '-') {
+    negative = true;
+    str++;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  const char* digitsStart = str;
+  while (str < end && *str >= '0' && *str <= '9') {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*str - '0');
+      digits += mantissa > 0;
+    } else {
+      exponent++;
+      truncated = true;
+    }
+    str++;
+  }
+  if (str < end && *str == '.') {
+    str++;
+    while (str < end && *str >= '0' && *str <= '9') {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*str - '0');
+        digits += mantissa > 0;
+        exponent--;
+      } else {
+        truncated = true;
+      }
+      str++;
+    }
+  }
+  if (str == digitsStart) {
+    return 0;
+  }
+  if (str < end && (*str == 'e' || *str == 'E')) {
+    str++;
+    bool negativeExponent = false;
+    if (str < end && (*str == '+' || *str == '-')) {
+      negativeExponent = *str == '-';
+      str++;
+    }
+    int explicitExponent = 0;
+    while (str < end && *str >= '0' && *str <= '9') {
+      if (explicitExponent < 100000) {
+        explicitExponent = explicitExponent * 10 + (*str - '0');
+      }
+      str++;
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  if (!truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+    value = exponent < 0 ? mantissa / JSON_POWERS_OF_TEN[-exponent] : mantissa * JSON_POWERS_OF_TEN[exponent];
+  } else {
+    char number[JSON_READER_MAX_NUMBER_LENGTH + 1];
+    size_t length = min((size_t)(str - start), JSON_READER_MAX_NUMBER_LENGTH);
+    memcpy(number, start, length);
+    number[length] = 0;
+    value = strtod(number, 0);
+    negative = false;
+  }
+  if (negative) {
+    value = -value;
+  }
+  return str;
+}
+
+struct JsonReader {
+  FILE* file;
+  char* buffer;
+  size_t cursor;
+  size_t length;
+  bool failed;
+
+  static Optional<JsonReader> open(Arena& arena, String path)
+  {
+    JsonReader reader = {};
+    reader.file = fopen(path.c_str(arena), "rb");
+    if (!reader.file) {
+      return {};
+    }
+    reader.buffer = arena.allocate<char>(JSON_READER_BUFFER_SIZE);
+    return reader;
+  }
+
+  void close()
+  {
+    if (file) {
+      fclose(file);
+      file = 0;
+    }
+  }
+
+  // Makes sure that at least `needed` bytes are buffered, unless the file ends before
+  bool fill(size_t needed)
+  {
+    if (length - cursor >= needed) {
+      return true;
+    }
+    memmove(buffer, buffer + cursor, length - cursor);
+    length -= cursor;
+    cursor = 0;
+    length += fread(buffer + length, 1, JSON_READER_BUFFER_SIZE - length, file);
+    return length - cursor >= needed;
+  }
+
+  bool fail()
+  {
+    failed = true;
+    return false;
+  }
+
+  // Returns the next character that is not whitespace without consuming it, 0 at the end of the file
+  char peek()
+  {
+    while (!failed && fill(1)) {
+      char c = buffer[cursor];
+      if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+        return c;
+      }
+      cursor++;
+    }
+    return 0;
+  }
+
+  bool consume(char c)
+  {
+    if (peek() != c) {
+      return false;
+    }
+    cursor++;
+    return true;
+  }
+
+  // Reads a string into `out`, which is truncated to `outSize - 1` bytes and null terminated. `out` may be null to
+  // skip the string. Escapes are resolved, except for \u escapes which are replaced by '?'.
+  bool readString(char* out, size_t outSize, size_t& outLength)
+  {
+    outLength = 0;
+    if (!consume('"')) {
+      return fail();
+    }
+    while (true) {
+      if (!fill(1)) {
+        return fail();
+      }
+      char c = buffer[cursor++];
+      if (c == '"') {
+        break;
+      }
+      if (c == '\\') {
+        if (!fill(1)) {
+          return fail();
+        }
+        c = buffer[cursor++];
+        switch (c) {
+        case 'b':
+          c = '\b';
+          break;
+        case 'f':
+          c = '\f';
+          break;
+        case 'n':
+          c = '\n';
+          break;
+        case 'r':
+          c = '\r';
+          break;
+        case 't':
+          c = '\t';
+          break;
+        case 'u':
+          if (!fill(4)) {
+            return fail();
+          }
+          cursor += 4;
+          c = '?';
+          break;
+        default:
+          break;
+        }
+      }
+      if (out && outLength + 1 < outSize) {
+        out[outLength++] = c;
+      }
+    }
+    if (out && outSize > 0) {
+      out[outLength] = 0;
+    }
+    return true;
+  }
+
+  bool readNumber(double& value)
+  {
+    if (failed || peek() == 0) {
+      return fail();
+    }
+    fill(JSON_READER_MAX_NUMBER_LENGTH);
+    const char* end = parseJsonNumber(buffer + cursor, buffer + length, value);
+    // Longer numbers may have been cut off at the end of the buffer, they are not valid instead of silently wrong
+    if (!end || (size_t)(end - (buffer + cursor)) >= JSON_READER_MAX_NUMBER_LENGTH) {
+      return fail();
+    }
+    cursor = end - buffer;
+    return true;
+  }
+
+  bool enterObject()
+  {
+    return consume('{') || fail();
+  }
+
+  // Reads the next key of the current object and the colon after it. Returns false at the end of the object.
+  bool nextKey(String& key, char (&keyBuffer)[JSON_READER_MAX_KEY_LENGTH])
+  {
+    if (consume('}')) {
+      return false;
+    }
+    consume(',');
+    size_t keyLength;
+    if (!readString(keyBuffer, sizeof(keyBuffer), keyLength) || !consume(':')) {
+      return fail();
+    }
+    key = String::view(keyBuffer, keyLength);
+    return true;
+  }
+
+  bool enterArray()
+  {
+    return consume('[') || fail();
+  }
+
+  // Returns false at the end of the array, otherwise the next item can be read
+  bool nextItem()
+  {
+    if (consume(']')) {
+      return false;
+    }
+    consume(',');
+    return !failed && peek() != 0;
+  }
+
+  bool skipValue()
+  {
+    size_t length;
+    char keyBuffer[JSON_READER_MAX_KEY_LENGTH];
+    String key;
+    switch (peek()) {
+    case '"':
+      return readString(0, 0, length);
+    case '{':
+      enterObject();
+      while (nextKey(key, keyBuffer)) {
+        skipValue();
+      }
+      return !failed;
+    case '[':
+      enterArray();
+      while (nextItem()) {
+        skipValue();
+      }
+      return !failed;
+    case 't':
+    case 'f':
+    case 'n':
+      while (fill(1) && buffer[cursor] >= 'a' && buffer[cursor] <= 'z') {
+        cursor++;
+      }
+      return true;
+    default:
+      double number;
+      return readNumber(number);
+    }
+  }
+};
@@ -0,0 +1,389 @@
+#include "../shared/app.h"
+#include <cairo/cairo-pdf.h>
+#include <cairo/cairo.h>
+
+// Exports the pages of a document as one PNG per page or as one multi-page PDF. Pages are independent, so the stroke
+// outlines of all pages are computed on a pool of worker threads. A PDF must be written in page order by a single
+// thread, so for PDFs the workers only prepare the outlines and the calling thread emits them as PDF paths. PNG pages
+// are rasterized and written by the workers themselves.
+//
+// Every page in flight owns one slot. A worker only starts page N once page N - EXPORT_MAX_PAGES_IN_FLIGHT is
+// written, so the memory stays bounded to a few pages however long the notebook is.
+//
+// The app runs the whole export on a background thread and shows its progress, like a background save. Only the
+// tsk_export tool waits for it with exportDocument.
+
+const auto EXPORT_MAX_PAGES_IN_FLIGHT = 4;
+const auto EXPORT_DEFAULT_DPI = 150;
+const auto EXPORT_MM_PER_INCH = 25.4;
+const auto EXPORT_PT_PER_MM = 72 / EXPORT_MM_PER_INCH;
+const auto EXPORT_GRID_LINE_WIDTH_MM = 0.1;
+const auto EXPORT_GRID_DOT_RADIUS_MM = 0.2;
+
+enum class ExportFormat {
+  Png,
+  Pdf,
+};
+
+struct ExportOptions {
+  ExportFormat format;
+  // The PDF file, or for PNG the prefix of "<prefix>-<page>.png"
+  String outputPath;
+  int dpi;
+  // 0 uses one thread per CPU core
+  int numberOfThreads;
+};
+
+struct ExportShape {
+  List<Vec2> outline;
+  Color color;
+};
+
+struct ExportSlot {
+  Arena arena;
+  ExportShape* shapes;
+  size_t numberOfShapes;
+  bool ready;
+  bool failed;
+};
+
+struct ExportPage {
+  LineShape* shapes;
+  size_t numberOfShapes;
+};
+
+struct DocumentExport {
+  Arena arena;
+  App* app;
+  ExportOptions options;
+  Color paperColor;
+  PaperStyle paperStyle;
+  float gridSpacingMm;
+  ExportPage* pages;
+  size_t numberOfPages;
+  ExportSlot slots[EXPORT_MAX_PAGES_IN_FLIGHT];
+  SDL_Mutex* mutex;
+  SDL_Condition* slotReady;
+  SDL_Condition* slotFree;
+  size_t nextPageToPrepare;
+  size_t nextPageToWrite;
+  BackgroundJobStatus status; // Shown in the status bar if the export runs in the background
+  bool succeeded;
+  double durationMs;
+};
+
+// Computes the outlines of all shapes of the page into the slot's arena
+static void prepareExportPage(DocumentExport* job, ExportSlot& slot, ExportPage& page)
+{
+  slot.arena.clearAndReinit();
+  slot.shapes = slot.arena.allocate<ExportShape>(page.numberOfShapes);
+  slot.numberOfShapes = 0;
+  for (size_t i = 0; i < page.numberOfShapes; i++) {
+    slot.shapes[slot.numberOfShapes++] = ExportShape {
+      .outline = getStrokeOutline(job->app, slot.arena, page.shapes[i].points),
+      .color = page.shapes[i].color,
+    };
+  }
+}
+
+// Draws the paper and the strokes of a page. The context must be scaled to mm.
+static void drawExportPage(DocumentExport* job, ExportSlot& slot, cairo_t* cr)
+{
+  auto paper = job->paperColor;
+  cairo_set_source_rgba(cr, paper.r / 255, paper.g / 255, paper.b / 255, paper.a / 255);
+  cairo_paint(cr);
+
+  // Same patterns as the paper shader, grid lines are at multiples of the grid spacing
+  auto grid = PAGE_GRID_COLOR;
+  double spacing = job->gridSpacingMm;
+  cairo_set_source_rgba(cr, grid.r / 255, grid.g / 255, grid.b / 255, grid.a / 255);
+  cairo_set_line_width(cr, EXPORT_GRID_LINE_WIDTH_MM);
+  if (spacing > 0) {
+    for (double y = spacing; y < PAGE_SIZE_MM.y; y += spacing) {
+      if (job->paperStyle == PaperStyle::Dotted) {
+        for (double x = spacing; x < PAGE_SIZE_MM.x; x += spacing) {
+          cairo_new_path(cr);
+          cairo_arc(cr, x, y, EXPORT_GRID_DOT_RADIUS_MM, 0, 2 * M_PI);
+          cairo_fill(cr);
+        }
+      } else {
+        cairo_move_to(cr, 0, y);
+        cairo_line_to(cr, PAGE_SIZE_MM.x, y);
+      }
+    }
+    if (job->paperStyle == PaperStyle::Squared) {
+      for (double x = spacing; x < PAGE_SIZE_MM.x; x += spacing) {
+        cairo_move_to(cr, x, 0);
+        cairo_line_to(cr, x, PAGE_SIZE_MM.y);
+      }
+    }
+    cairo_stroke(cr);
+  }
+
+  // Outlines are in scaled mm, filled with the nonzero rule like the SVG paths of the renderer
+  cairo_save(cr);
+  cairo_scale(cr, 1.0 / job->app->perfectFreehandAccuracyScaling, 1.0 / job->app->perfectFreehandAccuracyScaling);
+  cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+  for (size_t i = 0; i < slot.numberOfShapes; i++) {
+    auto& shape = slot.shapes[i];
+    bool first = true;
+    for (auto& p : shape.outline) {
+      if (first) {
+        cairo_move_to(cr, p.x, p.y);
+      } else {
+        cairo_line_to(cr, p.x, p.y);
+      }
+      first = false;
+    }
+    cairo_close_path(cr);
+    cairo_set_source_rgba(cr, shape.color.r / 255, shape.color.g / 255, shape.color.b / 255, shape.color.a / 255);
+    cairo_fill(cr);
+  }
+  cairo_restore(cr);
+}
+
+static bool writeExportPagePng(DocumentExport* job, ExportSlot& slot, size_t pageIndex)
+{
+  double pxPerMm = job->options.dpi / EXPORT_MM_PER_INCH;
+  int width = PAGE_SIZE_MM.x * pxPerMm + 0.5;
+  int height = PAGE_SIZE_MM.y * pxPerMm + 0.5;
+  cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  cairo_t* cr = cairo_create(surface);
+  cairo_scale(cr, pxPerMm, pxPerMm);
+  drawExportPage(job, slot, cr);
+  cairo_destroy(cr);
+
+  auto path = format(slot.arena, "{}-{}.png", job->options.outputPath, pageIndex + 1);
+  cairo_status_t status = cairo_surface_write_to_png(surface, path.c_str(slot.arena));
+  cairo_surface_destroy(surface);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    print("Failed to write '{}': {}", path, cairo_status_to_string(status));
+    return false;
+  }
+  return true;
+}
+
+static int SDLCALL ExportWorkerThread(void* userdata)
+{
+  auto job = (DocumentExport*)userdata;
+  while (true) {
+    SDL_LockMutex(job->mutex);
+    while (job->nextPageToPrepare < job->numberOfPages
+        && job->nextPageToPrepare >= job->nextPageToWrite + EXPORT_MAX_PAGES_IN_FLIGHT) {
+      SDL_WaitCondition(job->slotFree, job->mutex);
+    }
+    if (job->nextPageToPrepare >= job->numberOfPages) {
+      SDL_UnlockMutex(job->mutex);
+      return 0;
+    }
+    size_t pageIndex = job->nextPageToPrepare++;
+    SDL_UnlockMutex(job->mutex);
+
+    auto& slot = job->slots[pageIndex % EXPORT_MAX_PAGES_IN_FLIGHT];
+    prepareExportPage(job, slot, job->pages[pageIndex]);
+    if (job->options.format == ExportFormat::Png) {
+      slot.failed = !writeExportPagePng(job, slot, pageIndex);
+    }
+
+    SDL_LockMutex(job->mutex);
+    slot.ready = true;
+    SDL_BroadcastCondition(job->slotReady);
+    SDL_UnlockMutex(job->mutex);
+  }
+}
+
+// Copies what the export needs out of the document, so that the document can be edited during a background export.
+// Strokes are copied shallowly, their points are never changed and stay in the document's arena, as for a save.
+static DocumentExport* createDocumentExport(App* app, Document& document, ExportOptions options)
+{
+  if (options.dpi <= 0) {
+    options.dpi = EXPORT_DEFAULT_DPI;
+  }
+
+  Arena arena = Arena::create();
+  auto job = arena.allocate<DocumentExport>();
+  job->arena = arena;
+  job->app = app;
+  job->options = options;
+  job->options.outputPath = String::clone(arena, options.outputPath);
+  job->paperColor = document.paperColor;
+  job->paperStyle = document.paperStyle;
+  job->gridSpacingMm = document.gridSpacingMm;
+  job->numberOfPages = document.pages.length;
+  job->pages = arena.allocate<ExportPage>(document.pages.length);
+  size_t pageIndex = 0;
+  for (auto& page : document.pages) {
+    auto& exportPage = job->pages[pageIndex++];
+    exportPage.shapes = arena.allocate<LineShape>(page.shapes.length);
+    for (auto& shape : page.shapes) {
+      exportPage.shapes[exportPage.numberOfShapes++] = shape;
+    }
+  }
+  return job;
+}
+
+// Runs the worker pool and writes all pages from the calling thread. Returns false if any page failed.
+static bool runDocumentExport(DocumentExport* job)
+{
+  auto& options = job->options;
+  auto& arena = job->arena;
+  int numberOfThreads = options.numberOfThreads > 0 ? options.numberOfThreads : SDL_GetNumLogicalCPUCores();
+  numberOfThreads = clamp(numberOfThreads, 1, EXPORT_MAX_PAGES_IN_FLIGHT);
+  uint64_t startNs = SDL_GetTicksNS();
+
+  job->mutex = SDL_CreateMutex();
+  job->slotReady = SDL_CreateCondition();
+  job->slotFree = SDL_CreateCondition();
+
+  cairo_surface_t* pdf = 0;
+  cairo_t* cr = 0;
+  if (options.format == ExportFormat::Pdf) {
+    pdf = cairo_pdf_surface_create(
+        options.outputPath.c_str(arena), PAGE_SIZE_MM.x * EXPORT_PT_PER_MM, PAGE_SIZE_MM.y * EXPORT_PT_PER_MM);
+    cr = cairo_create(pdf);
+  }
+
+  SDL_Thread* threads[EXPORT_MAX_PAGES_IN_FLIGHT] = {};
+  int numberOfWorkers = 0;
+  for (int i = 0; i < numberOfThreads; i++) {
+    threads[numberOfWorkers] = SDL_CreateThread(ExportWorkerThread, "ExportWorker", job);
+    if (threads[numberOfWorkers]) {
+      numberOfWorkers++;
+    }
+  }
+  if (numberOfWorkers == 0) {
+    print("Failed to start the export threads: {}", SDL_GetError());
+  }
+
+  bool succeeded = numberOfWorkers > 0;
+  for (size_t i = 0; numberOfWorkers > 0 && i < job->numberOfPages; i++) {
+    auto& slot = job->slots[i % EXPORT_MAX_PAGES_IN_FLIGHT];
+    SDL_LockMutex(job->mutex);
+    while (!slot.ready) {
+      SDL_WaitCondition(job->slotReady, job->mutex);
+    }
+    SDL_UnlockMutex(job->mutex);
+
+    if (cr) {
+      cairo_save(cr);
+      cairo_scale(cr, EXPORT_PT_PER_MM, EXPORT_PT_PER_MM);
+      drawExportPage(job, slot, cr);
+      cairo_restore(cr);
+      cairo_show_page(cr);
+    }
+    succeeded = succeeded && !slot.failed;
+
+    SDL_LockMutex(job->mutex);
+    slot.ready = false;
+    slot.failed = false;
+    job->nextPageToWrite++;
+    SDL_BroadcastCondition(job->slotFree);
+    SDL_UnlockMutex(job->mutex);
+
+    SDL_SetAtomicInt(&job->status.progressPermille, (int)((i + 1) * 1000 / job->numberOfPages));
+  }
+
+  for (int i = 0; i < numberOfWorkers; i++) {
+    SDL_WaitThread(threads[i], 0);
+  }
+  if (pdf) {
+    cairo_destroy(cr);
+    cairo_surface_finish(pdf);
+    if (cairo_surface_status(pdf) != CAIRO_STATUS_SUCCESS) {
+      print("Failed to write '{}': {}", options.outputPath, cairo_status_to_string(cairo_surface_status(pdf)));
+      succeeded = false;
+    }
+    cairo_surface_destroy(pdf);
+  }
+
+  job->durationMs = (SDL_GetTicksNS() - startNs) / 1000000.0;
+  if (succeeded) {
+    print("Exported {} pages to '{}' in {:.1} ms", job->numberOfPages, options.outputPath, job->durationMs);
+  }
+  for (auto& slot : job->slots) {
+    if (slot.arena.firstChunk) {
+      slot.arena.free();
+    }
+  }
+  SDL_DestroyCondition(job->slotFree);
+  SDL_DestroyCondition(job->slotReady);
+  SDL_DestroyMutex(job->mutex);
+  return succeeded;
+}
+
+// Blocks until all pages are written. Returns false if any page failed.
+bool exportDocument(App* app, Document& document, ExportOptions options)
+{
+  auto job = createDocumentExport(app, document, options);
+  bool succeeded = runDocumentExport(job);
+  Arena arena = job->arena;
+  arena.free();
+  return succeeded;
+}
+
+static int SDLCALL DocumentExportThread(void* userdata)
+{
+  auto job = (DocumentExport*)userdata;
+  job->succeeded = runDocumentExport(job);
+  SDL_SetAtomicInt(&job->status.finished, 1);
+  return 0;
+}
+
+// Exports on a background thread, the progress is shown in the status bar. Returns false if an export of the
+// document is still running or the thread can't be started.
+bool startDocumentExport(App* app, Document& document, ExportOptions options)
+{
+  auto& background = document.backgroundExport;
+  if (background.thread) {
+    print("The previous export is still running");
+    return false;
+  }
+
+  auto job = createDocumentExport(app, document, options);
+  background.job = job;
+  background.status = &job->status;
+  background.thread = SDL_CreateThread(DocumentExportThread, "DocumentExport", job);
+  if (!background.thread) {
+    print("Failed to start the export thread: {}", SDL_GetError());
+    background.job = 0;
+    background.status = 0;
+    Arena arena = job->arena;
+    arena.free();
+    return false;
+  }
+  return true;
+}
+
+static void finishDocumentExport(App* app, Document& document)
+{
+  auto& background = document.backgroundExport;
+  SDL_WaitThread(background.thread, 0);
+  background.thread = 0;
+
+  auto job = background.job;
+  background.job = 0;
+  background.status = 0;
+  background.lastDurationMs = job->durationMs;
+  background.lastExportFailed = !job->succeeded;
+  if (!job->succeeded) {
+    print("Failed to export to '{}'", job->options.outputPath);
+  }
+
+  Arena arena = job->arena;
+  arena.free();
+}
+
+// Called once per frame, finishes a completed export
+void updateDocumentExport(App* app, Document& document)
+{
+  if (document.backgroundExport.thread && SDL_GetAtomicInt(&document.backgroundExport.status->finished)) {
+    finishDocumentExport(app, document);
+  }
+}
+
+void waitForDocumentExport(App* app, Document& document)
+{
+  if (document.backgroundExport.thread) {
+    finishDocumentExport(app, document);
+  }
+}
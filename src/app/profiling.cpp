@@ -46,4 +46,84 @@ struct ProfilerInstance {
   }
 };
 
-#define PROFILE_SCOPE(...) ProfilerInstance __prof(app, FUNC_NAME, ##__VA_ARGS__);
\ No newline at end of file
+#define PROFILE_SCOPE(...) ProfilerInstance __prof(app, FUNC_NAME, ##__VA_ARGS__);
+
+void createGpuProfiler(App* app)
+{
+  auto& gpu = app->gpuProfiler;
+  glGenQueries(gpu.NUM_FRAMES * gpu.MAX_QUERIES_PER_FRAME, &gpu.queries[0][0]);
+  for (size_t i = 0; i < gpu.NUM_FRAMES; i++) {
+    gpu.numQueries[i] = 0;
+  }
+  gpu.currentFrame = 0;
+  gpu.queryActive = false;
+}
+
+void destroyGpuProfiler(App* app)
+{
+  auto& gpu = app->gpuProfiler;
+  glDeleteQueries(gpu.NUM_FRAMES * gpu.MAX_QUERIES_PER_FRAME, &gpu.queries[0][0]);
+}
+
+// Advances to the next query set and sums up its results per scope into the current profiler results
+void beginGpuProfilerFrame(App* app)
+{
+  auto& gpu = app->gpuProfiler;
+  auto& results = app->currentProfilingResults;
+  gpu.currentFrame = (gpu.currentFrame + 1) % gpu.NUM_FRAMES;
+  results.numOfGpuResults = 0;
+
+  size_t frame = gpu.currentFrame;
+  for (size_t i = 0; i < gpu.numQueries[frame]; i++) {
+    // Reading a result that is not there yet would wait for the GPU, a late query is dropped instead
+    GLuint available = 0;
+    glGetQueryObjectuiv(gpu.queries[frame][i], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      continue;
+    }
+    GLuint64 elapsedNs = 0;
+    glGetQueryObjectui64v(gpu.queries[frame][i], GL_QUERY_RESULT, &elapsedNs);
+
+    size_t index = 0;
+    while (index < results.numOfGpuResults && strcmp(results.gpuResults[index].scopeName, gpu.scopeNames[frame][i])) {
+      index++;
+    }
+    if (index == results.numOfGpuResults) {
+      if (results.numOfGpuResults >= results.gpuResults.length()) {
+        continue;
+      }
+      results.gpuResults[results.numOfGpuResults++] = { .scopeName = gpu.scopeNames[frame][i], .msTaken = 0 };
+    }
+    results.gpuResults[index].msTaken += elapsedNs / 1000000.0;
+  }
+  gpu.numQueries[frame] = 0;
+}
+
+// GL_TIME_ELAPSED queries cannot be nested, so a scope inside another GPU scope is silently not measured
+struct GpuProfilerInstance {
+  App* app;
+  bool started;
+
+  GpuProfilerInstance(App* app, const char* name)
+  {
+    this->app = app;
+    auto& gpu = app->gpuProfiler;
+    size_t frame = gpu.currentFrame;
+    started = !gpu.queryActive && gpu.numQueries[frame] < gpu.MAX_QUERIES_PER_FRAME;
+    if (started) {
+      gpu.scopeNames[frame][gpu.numQueries[frame]] = name;
+      glBeginQuery(GL_TIME_ELAPSED, gpu.queries[frame][gpu.numQueries[frame]++]);
+      gpu.queryActive = true;
+    }
+  }
+
+  ~GpuProfilerInstance()
+  {
+    if (started) {
+      glEndQuery(GL_TIME_ELAPSED);
+      app->gpuProfiler.queryActive = false;
+    }
+  }
+};
+
+#define GPU_PROFILE_SCOPE(name) GpuProfilerInstance __gpuProf(app, name);
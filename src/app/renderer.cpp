@@ -22,6 +22,9 @@
 const auto PAGE_OUTLINE_COLOR = Color("#888");
 const auto APP_BACKGROUND_COLOR = Color("#DDD");
 const auto PAGE_GRID_COLOR = Color("#A8C9E3");
+const auto PAGE_SIZE_MM = Vec2f(210, 297);
+// Path coordinates are in scaled mm, so 3 decimals are far below a pixel at any zoom level
+const auto SVG_PATH_DECIMALS = 3;
 
 struct PrimitiveRectangle {
   Vec2 pos;
@@ -52,6 +55,12 @@ struct RenderLineShape {
   size_t zindex = 0;
 };
 
+struct PaperInstance {
+  Vec2f topLeftPx;
+  Vec2f sizePx;
+  Vec2f sizeMm;
+};
+
 struct Renderer {
   Arena& arena;
   App* app;
@@ -71,14 +80,29 @@ void setUniformMat4(GLuint shader, const char* name, Mat4 matrix)
   glUniformMatrix4fv(matrixLocation, 1, GL_TRUE, matrix.data.data());
 }
 
-void setPixelProjection(App* app, float w, float h)
+void setUniformColor(GLuint shader, const char* name, Color color)
+{
+  GLuint colorLocation = glGetUniformLocation(shader, name);
+  if (colorLocation == -1) {
+    print("{}Uniform not found: {}{}", RED, name, RESET);
+    return;
+  }
+  glUniform4f(colorLocation, color.r / 255.f, color.g / 255.f, color.b / 255.f, color.a / 255.f);
+}
+
+Mat4 getPixelProjection(float w, float h)
 {
   Mat4 pixelProjection = Mat4::Identity();
   pixelProjection.applyScaling(1, -1, 1);
   pixelProjection.applyTranslation(-1, -1, 0);
   pixelProjection.applyScaling(2, 2, 1);
   pixelProjection.applyScaling(1 / w, 1 / h, 1);
-  setUniformMat4(app->mainShader, "pixelProjection", pixelProjection);
+  return pixelProjection;
+}
+
+void setPixelProjection(App* app, float w, float h)
+{
+  setUniformMat4(app->mainShader, "pixelProjection", getPixelProjection(w, h));
 }
 
 void RenderPolygon(Renderer& renderer, List<Vec2> vertices, List<size_t> indices, Color color)
@@ -146,10 +170,10 @@ void RenderRectOutline(Renderer& renderer, Vec2 pos, Vec2 size, Color color)
       });
 }
 
-String getPath(App* app, Arena& arena, List<SamplePoint> points)
+List<Vec2> getStrokeOutline(App* app, Arena& arena, List<SamplePoint> points)
 {
   float penSize_mm = 0.5;
-  auto outline = getStroke(arena, points,
+  return getStroke(arena, points,
       {
           .size = penSize_mm * app->perfectFreehandAccuracyScaling,
           .thinning = 1,
@@ -174,6 +198,10 @@ String getPath(App* app, Arena& arena, List<SamplePoint> points)
                          return t * t * t + 1;
                        } },
       });
+}
+
+String getSvgPath(Arena& arena, List<Vec2> outline)
+{
   ts::StringBuffer result;
   result.append(arena, "M");
   bool first = true;
@@ -181,22 +209,39 @@ String getPath(App* app, Arena& arena, List<SamplePoint> points)
     if (!first) {
       result.append(arena, "L");
     }
-    result.append(arena, format(arena, "{} {}", p.x, p.y));
+    result.appendFixed(arena, p.x, SVG_PATH_DECIMALS);
+    result.append(arena, ' ');
+    result.appendFixed(arena, p.y, SVG_PATH_DECIMALS);
     first = false;
   }
   return result.str();
+}
+
+String getPath(App* app, Arena& arena, List<SamplePoint> points)
+{
+  return getSvgPath(arena, getStrokeOutline(app, arena, points));
 };
 
-void RenderShapeToPageFBO(
-    App* app, Renderer& renderer, Document& document, Page& page, LineShape& shape, gl::Framebuffer& fbo)
+// Created on first use. Shapes are rendered as plain paths, so the system fonts are never loaded.
+resvg_options* getSvgOptions(App* app)
 {
-  PROFILE_SCOPE();
+  if (!app->svgOpts) {
+    resvg_init_log();
+    app->svgOpts = resvg_options_create();
+    resvg_options_set_stylesheet(app->svgOpts, "svg { fill: white; }");
+  }
+  return app->svgOpts;
+}
 
-  String svgPath = getPath(renderer.app, renderer.app->frameArena, shape.points);
+// Rasterizes the visible part of the shape into a new BGRA cairo surface of size page.visibleSizePx.
+// Returns NULL if the generated SVG could not be parsed. The caller owns the surface.
+cairo_surface_t* RasterizeShape(App* app, Arena& arena, Document& document, Page& page, LineShape& shape)
+{
+  String svgPath = getPath(app, arena, shape.points);
 
   ts::StringBuffer svg;
-  svg.append(renderer.app->frameArena,
-      format(renderer.app->frameArena,
+  svg.append(arena,
+      format(arena,
           "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"{}\" height=\"{}\" viewBox=\"{} {} {} {}\">",
           page.visibleSizePx.x, page.visibleSizePx.y,
           page.visibleOffsetPx.x * document.zoomMmPerPx * app->perfectFreehandAccuracyScaling,
@@ -204,15 +249,15 @@ void RenderShapeToPageFBO(
           page.visibleSizePx.x * document.zoomMmPerPx * app->perfectFreehandAccuracyScaling,
           page.visibleSizePx.y * document.zoomMmPerPx * app->perfectFreehandAccuracyScaling));
   // print("Svg: {}", svg.str());
-  svg.append(renderer.app->frameArena, "<path d=\"");
-  svg.append(renderer.app->frameArena, svgPath);
-  svg.append(renderer.app->frameArena, "\" fill=\"black\" /></svg>");
+  svg.append(arena, "<path d=\"");
+  svg.append(arena, svgPath);
+  svg.append(arena, "\" fill=\"black\" /></svg>");
 
   resvg_render_tree* tree;
-  int err = resvg_parse_tree_from_data(svg.data, svg.length, renderer.app->svgOpts, &tree);
+  int err = resvg_parse_tree_from_data(svg.data, svg.length, getSvgOptions(app), &tree);
   if (err != RESVG_OK) {
     ts::print_stderr("Error while parsing SVG: {}", err);
-    return;
+    return NULL;
   }
 
   cairo_surface_t* surface
@@ -227,11 +272,31 @@ void RenderShapeToPageFBO(
   cairo_destroy(cr);
 
   resvg_render(tree, resvg_transform_identity(), page.visibleSizePx.x, page.visibleSizePx.y, (char*)surface_data);
+  resvg_tree_destroy(tree);
+  return surface;
+}
+
+void RenderShapeToPageFBO(
+    App* app, Renderer& renderer, Document& document, Page& page, LineShape& shape, gl::Framebuffer& fbo)
+{
+  PROFILE_SCOPE();
+  GPU_PROFILE_SCOPE("Shape rasterization");
+
+  cairo_surface_t* surface = RasterizeShape(app, renderer.app->frameArena, document, page, shape);
+  if (!surface) {
+    return;
+  }
+  unsigned char* surface_data = cairo_image_surface_get_data(surface);
 
   gl::setUniform(renderer.app->mainShader, "uUseTexture", 1.f);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  if (!page.tempRenderTexture.textureId) {
+    page.tempRenderTexture = gl::Texture::create();
+  }
   page.tempRenderTexture.uploadData({ page.visibleSizePx.x, page.visibleSizePx.y }, gl::Format::BGRA, surface_data);
+  app->currentProfilingResults.counters.textureUploadBytes += (size_t)page.visibleSizePx.x * page.visibleSizePx.y * 4;
+  app->currentProfilingResults.counters.shapesRasterized++;
 
   gl::Vertex quadVertices[4] = {
     {
@@ -269,6 +334,8 @@ void RenderShapeToPageFBO(
   auto& bb = app->mainViewportBB;
   glViewport(0, 0, page.visibleSizePx.x, page.visibleSizePx.y);
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
+  app->currentProfilingResults.counters.drawCalls++;
+  app->currentProfilingResults.counters.vertices += 4;
 
   fbo.unbind();
   gl::setUniform(renderer.app->mainShader, "uUseTexture", 0.f);
@@ -282,12 +349,12 @@ void RenderShapeToPageFBO(
   setPixelProjection(app, app->mainViewportBB.width, app->mainViewportBB.height);
 
   cairo_surface_destroy(surface);
-  resvg_tree_destroy(tree);
 }
 
 void RenderFBOToPage(App* app, Renderer& renderer, Document& document, Page& page, gl::Framebuffer& fbo)
 {
   PROFILE_SCOPE();
+  GPU_PROFILE_SCOPE("Page compositing");
 
   // glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer.app->mainViewportFBO.fbo);
   // glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
@@ -333,6 +400,8 @@ void RenderFBOToPage(App* app, Renderer& renderer, Document& document, Page& pag
 
   glBindTexture(GL_TEXTURE_2D, fbo.tex);
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
+  app->currentProfilingResults.counters.drawCalls++;
+  app->currentProfilingResults.counters.vertices += 4;
   glBindTexture(GL_TEXTURE_2D, 0);
 
   gl::setUniform(renderer.app->mainShader, "uUseTexture", 0.f);
@@ -349,28 +418,66 @@ void RenderDocumentBackground(App* app, Renderer& renderer)
     return;
   }
   auto& document = renderer.app->documents[renderer.app->selectedDocument];
-  int gridSpacing = 5;
 
+  size_t numVisiblePages = 0;
   for (auto& page : document.pages) {
-    if (!page.overlapsWithViewport(renderer.app)) {
-      continue;
+    if (page.overlapsWithViewport(renderer.app)) {
+      numVisiblePages++;
     }
+  }
+  if (numVisiblePages == 0) {
+    return;
+  }
 
-    Vec2i pageSizeI = page.getRenderSizePx(renderer.app);
-    Vec2 pageSize = { pageSizeI.x, pageSizeI.y };
-    Vec2i topLeftI = page.getTopLeftPx(renderer.app);
-    Vec2 topLeft = { topLeftI.x, topLeftI.y };
-    RenderRect(renderer, topLeft, pageSize, "#FFF"_s);
-    RenderRectOutline(renderer, topLeft, pageSize, PAGE_OUTLINE_COLOR);
-    for (int x_mm = 0; x_mm < 210; x_mm += gridSpacing) {
-      float x_px = x_mm / 210.0 * pageSize.x;
-      RenderLine(renderer, topLeft + Vec2(x_px, 0), topLeft + Vec2(x_px, pageSize.y), PAGE_GRID_COLOR);
-    }
-    for (int y_mm = 0; y_mm < 297; y_mm += gridSpacing) {
-      float y_px = y_mm / 297.0 * pageSize.y;
-      RenderLine(renderer, topLeft + Vec2(0, y_px), topLeft + Vec2(pageSize.x, y_px), PAGE_GRID_COLOR);
+  glBindVertexArray(app->paperVAO);
+  size_t firstInstance;
+  PaperInstance* instances = app->mainViewportStreamVBO.allocate<PaperInstance>(numVisiblePages, firstInstance);
+  size_t instanceIndex = 0;
+  for (auto& page : document.pages) {
+    if (!page.overlapsWithViewport(renderer.app)) {
+      continue;
     }
+    Vec2i size = page.getRenderSizePx(renderer.app);
+    Vec2i topLeft = page.getTopLeftPx(renderer.app);
+    instances[instanceIndex++] = {
+      .topLeftPx = Vec2f(topLeft.x, topLeft.y),
+      .sizePx = Vec2f(size.x, size.y),
+      .sizeMm = PAGE_SIZE_MM,
+    };
   }
+  app->mainViewportStreamVBO.flush();
+
+  // The instance attributes point at this frame's range of the stream buffer, the quad corners come from
+  // gl_VertexID
+  size_t instanceOffset = firstInstance * sizeof(PaperInstance);
+  glBindBuffer(GL_ARRAY_BUFFER, app->mainViewportStreamVBO.buffer);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(PaperInstance), (void*)instanceOffset);
+  glEnableVertexAttribArray(0);
+  glVertexAttribDivisor(0, 1);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(PaperInstance), (void*)(instanceOffset + 2 * sizeof(Vec2f)));
+  glEnableVertexAttribArray(1);
+  glVertexAttribDivisor(1, 1);
+
+  glUseProgram(app->paperShader);
+  setUniformMat4(app->paperShader, "pixelProjection",
+      getPixelProjection(app->mainViewportBB.width, app->mainViewportBB.height));
+  gl::setUniform(app->paperShader, "uPaperStyle", (int)document.paperStyle);
+  gl::setUniform(app->paperShader, "uGridSpacingMm", document.gridSpacingMm);
+  setUniformColor(app->paperShader, "uGridColor", PAGE_GRID_COLOR);
+  setUniformColor(app->paperShader, "uPaperColor", document.paperColor);
+  setUniformColor(app->paperShader, "uOutlineColor", PAGE_OUTLINE_COLOR);
+
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numVisiblePages);
+  app->currentProfilingResults.counters.drawCalls++;
+  app->currentProfilingResults.counters.vertices += 4 * numVisiblePages;
+  glEnable(GL_DEPTH_TEST);
+
+  glUseProgram(app->mainShader);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
 }
 
 void RenderDocumentForeground(App* app, Renderer& renderer)
@@ -412,10 +519,19 @@ void RenderDocumentForeground(App* app, Renderer& renderer)
     // print("Offset: {} {} with size {} {}", page.visibleOffsetPx.x, page.visibleOffsetPx.y, page.visibleSizePx.x,
     //     page.visibleSizePx.y);
 
+    // Framebuffers are created lazily, so pages that never become visible do not hold GPU memory
+    if (!page.persistentFBO.fbo) {
+      page.persistentFBO = gl::Framebuffer::create();
+    }
+    if (!page.previewFBO.fbo) {
+      page.previewFBO = gl::Framebuffer::create();
+    }
+
     auto fboSize = page.persistentFBO.getSize();
     if (fboSize.x != (int)page.visibleSizePx.x || fboSize.y != (int)page.visibleSizePx.y
         || page.visibleOffsetPx != oldOffset) {
       page.persistentFBO.clear({ (int)page.visibleSizePx.x, (int)page.visibleSizePx.y });
+      app->currentProfilingResults.counters.fboReallocations++;
       for (auto& shape : page.shapes) {
         shape.prerendered = false;
         print("Invalidating all prerendered shapes");
@@ -432,6 +548,7 @@ void RenderDocumentForeground(App* app, Renderer& renderer)
     RenderFBOToPage(app, renderer, document, page, page.persistentFBO);
 
     page.previewFBO.clear({ (int)page.visibleSizePx.x, (int)page.visibleSizePx.y });
+    app->currentProfilingResults.counters.fboReallocations++;
     if (renderer.app->currentlyDrawingOnPage == page.pageNumId) {
       RenderShapeToPageFBO(app, renderer, document, page, document.currentLine, page.previewFBO);
       RenderFBOToPage(app, renderer, document, page, page.previewFBO);
@@ -443,139 +560,86 @@ void RenderDocumentForeground(App* app, Renderer& renderer)
 
 void RenderBatch(App* app, Renderer& renderer)
 {
-  // Lines
-  gl::Vertex* lineVertices = app->frameArena.allocate<gl::Vertex>(renderer.lines.length * 2);
-  GLuint* lineIndices = app->frameArena.allocate<GLuint>(renderer.lines.length * 2);
-  size_t vertexIndex = 0;
-  size_t indexIndex = 0;
-  size_t i = 0;
-  for (auto& line : renderer.lines) {
-    lineVertices[vertexIndex++] = {
-      .pos = Vec3f(line.from.x, line.from.y, 1 - (float)line.zindex / renderer.nextZIndex),
-      .color = line.lineColor / 255,
-    };
-    lineVertices[vertexIndex++] = {
-      .pos = Vec3f(line.to.x, line.to.y, 1 - (float)line.zindex / renderer.nextZIndex),
-      .color = line.lineColor / 255,
-    };
-
-    lineIndices[indexIndex++] = i * 2;
-    lineIndices[indexIndex++] = i * 2 + 1;
-    i++;
-  }
-
-  glBindVertexArray(app->mainViewportVAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, app->mainViewportVBO);
-  glBufferData(GL_ARRAY_BUFFER, renderer.lines.length * 2 * sizeof(gl::Vertex), lineVertices, GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->mainViewportIBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, renderer.lines.length * 2 * sizeof(GLuint), lineIndices, GL_STATIC_DRAW);
-
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(gl::Vertex), (void*)0);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(gl::Vertex), (void*)(sizeof(Vec3f)));
-  glEnableVertexAttribArray(1);
-  glLineWidth(1.f);
-  glDrawElements(GL_LINES, renderer.lines.length * 2, GL_UNSIGNED_INT, (void*)0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
-
-  // Rectangles
-  gl::Vertex* rectVertices = app->frameArena.allocate<gl::Vertex>(renderer.rectangles.length * 4);
-  GLuint* rectIndices = app->frameArena.allocate<GLuint>(renderer.rectangles.length * 6);
-  vertexIndex = 0;
-  indexIndex = 0;
-  i = 0;
-  for (auto& rect : renderer.rectangles) {
-    rectVertices[vertexIndex++] = {
-      .pos = Vec3f(rect.pos.x, rect.pos.y, 1 - (float)rect.zindex / renderer.nextZIndex),
-      .color = rect.fillColor / 255,
-    };
-    rectVertices[vertexIndex++] = {
-      .pos = Vec3f(rect.pos.x + rect.size.x, rect.pos.y, 1 - (float)rect.zindex / renderer.nextZIndex),
-      .color = rect.fillColor / 255,
-    };
-    rectVertices[vertexIndex++] = {
-      .pos = Vec3f(rect.pos.x + rect.size.x, rect.pos.y + rect.size.y, 1 - (float)rect.zindex / renderer.nextZIndex),
-      .color = rect.fillColor / 255,
-    };
-    rectVertices[vertexIndex++] = {
-      .pos = Vec3f(rect.pos.x, rect.pos.y + rect.size.y, 1 - (float)rect.zindex / renderer.nextZIndex),
-      .color = rect.fillColor / 255,
-    };
-
-    rectIndices[indexIndex++] = i * 4 + 0;
-    rectIndices[indexIndex++] = i * 4 + 1;
-    rectIndices[indexIndex++] = i * 4 + 2;
-    rectIndices[indexIndex++] = i * 4 + 2;
-    rectIndices[indexIndex++] = i * 4 + 3;
-    rectIndices[indexIndex++] = i * 4 + 0;
-    i++;
+  size_t numLineIndices = renderer.lines.length * 2;
+  size_t numVertices = renderer.lines.length * 2 + renderer.rectangles.length * 4;
+  size_t numIndices = numLineIndices + renderer.rectangles.length * 6;
+  for (auto& polygon : renderer.polygons) {
+    numVertices += polygon.vertices.length;
+    numIndices += polygon.indices.length;
   }
 
-  glBindVertexArray(app->mainViewportVAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, app->mainViewportVBO);
-  glBufferData(GL_ARRAY_BUFFER, renderer.rectangles.length * 4 * sizeof(gl::Vertex), rectVertices, GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->mainViewportIBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, renderer.rectangles.length * 6 * sizeof(GLuint), rectIndices, GL_STATIC_DRAW);
-
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(gl::Vertex), (void*)0);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(gl::Vertex), (void*)(sizeof(Vec3f)));
-  glEnableVertexAttribArray(1);
-
-  glDrawElements(GL_TRIANGLES, renderer.rectangles.length * 6, GL_UNSIGNED_INT, (void*)0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  if (numVertices > 0 && numIndices > 0) {
+    glBindVertexArray(app->mainViewportVAO);
 
-  // Polygons
-  if (renderer.polygons.length > 0) {
+    // All primitives of the batch are written straight into the mapped stream buffers, indices are relative to the
+    // first vertex of the batch and offset using the base vertex.
+    size_t baseVertex;
+    size_t baseIndex;
+    gl::Vertex* vertices = app->mainViewportStreamVBO.allocate<gl::Vertex>(numVertices, baseVertex);
+    GLuint* indices = app->mainViewportStreamIBO.allocate<GLuint>(numIndices, baseIndex);
+    size_t vertexIndex = 0;
+    size_t indexIndex = 0;
+
+    // Lines
+    for (auto& line : renderer.lines) {
+      float z = 1 - (float)line.zindex / renderer.nextZIndex;
+      indices[indexIndex++] = vertexIndex;
+      vertices[vertexIndex++] = { .pos = Vec3f(line.from.x, line.from.y, z), .color = line.lineColor / 255 };
+      indices[indexIndex++] = vertexIndex;
+      vertices[vertexIndex++] = { .pos = Vec3f(line.to.x, line.to.y, z), .color = line.lineColor / 255 };
+    }
 
-    size_t totalPolygonVertices = 0;
-    size_t totalPolygonIndices = 0;
-    for (auto polygon : renderer.polygons) {
-      totalPolygonVertices += polygon.vertices.length;
-      totalPolygonIndices += polygon.indices.length;
+    // Rectangles
+    for (auto& rect : renderer.rectangles) {
+      float z = 1 - (float)rect.zindex / renderer.nextZIndex;
+      indices[indexIndex++] = vertexIndex + 0;
+      indices[indexIndex++] = vertexIndex + 1;
+      indices[indexIndex++] = vertexIndex + 2;
+      indices[indexIndex++] = vertexIndex + 2;
+      indices[indexIndex++] = vertexIndex + 3;
+      indices[indexIndex++] = vertexIndex + 0;
+      vertices[vertexIndex++] = { .pos = Vec3f(rect.pos.x, rect.pos.y, z), .color = rect.fillColor / 255 };
+      vertices[vertexIndex++]
+          = { .pos = Vec3f(rect.pos.x + rect.size.x, rect.pos.y, z), .color = rect.fillColor / 255 };
+      vertices[vertexIndex++]
+          = { .pos = Vec3f(rect.pos.x + rect.size.x, rect.pos.y + rect.size.y, z), .color = rect.fillColor / 255 };
+      vertices[vertexIndex++]
+          = { .pos = Vec3f(rect.pos.x, rect.pos.y + rect.size.y, z), .color = rect.fillColor / 255 };
     }
 
-    gl::Vertex* polygonVertices = app->frameArena.allocate<gl::Vertex>(totalPolygonVertices);
-    GLuint* polygonIndices = app->frameArena.allocate<GLuint>(totalPolygonIndices);
-    size_t numPolygonVertices = 0;
-    size_t numPolygonIndices = 0;
-    for (size_t i = 0; i < renderer.polygons.length; i++) {
-      auto& polygon = renderer.polygons[i];
-      for (size_t vertexNum = 0; vertexNum < polygon.vertices.length; vertexNum++) {
-        auto& vertex = polygon.vertices[vertexNum];
-        polygonVertices[numPolygonVertices + vertexNum] = (gl::Vertex) {
-          .pos = { vertex.x, vertex.y, 1 - (float)polygon.zIndex / renderer.nextZIndex },
-          .color = polygon.color / 255,
-        };
+    // Polygons
+    for (auto& polygon : renderer.polygons) {
+      float z = 1 - (float)polygon.zIndex / renderer.nextZIndex;
+      for (auto& index : polygon.indices) {
+        indices[indexIndex++] = index + vertexIndex;
       }
-      for (size_t indexNum = 0; indexNum < polygon.indices.length; indexNum++) {
-        polygonIndices[numPolygonIndices + indexNum] = polygon.indices[indexNum] + numPolygonVertices;
+      for (auto& vertex : polygon.vertices) {
+        vertices[vertexIndex++] = { .pos = { vertex.x, vertex.y, z }, .color = polygon.color / 255 };
       }
-      numPolygonVertices += polygon.vertices.length;
-      numPolygonIndices += polygon.indices.length;
     }
 
-    glBindVertexArray(app->mainViewportVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, app->mainViewportVBO);
-    glBufferData(GL_ARRAY_BUFFER, totalPolygonVertices * sizeof(gl::Vertex), polygonVertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->mainViewportIBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalPolygonIndices * sizeof(GLuint), polygonIndices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(gl::Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(gl::Vertex), (void*)(sizeof(Vec3f)));
-    glEnableVertexAttribArray(1);
+    app->mainViewportStreamVBO.flush();
+    app->mainViewportStreamIBO.flush();
+    glBindBuffer(GL_ARRAY_BUFFER, app->mainViewportStreamVBO.buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->mainViewportStreamIBO.buffer);
+    gl::setupBuffers();
+
+    if (numLineIndices > 0) {
+      glLineWidth(1.f);
+      glDrawElementsBaseVertex(
+          GL_LINES, numLineIndices, GL_UNSIGNED_INT, (void*)(baseIndex * sizeof(GLuint)), baseVertex);
+      app->currentProfilingResults.counters.drawCalls++;
+    }
+    if (numIndices > numLineIndices) {
+      glDrawElementsBaseVertex(GL_TRIANGLES, numIndices - numLineIndices, GL_UNSIGNED_INT,
+          (void*)((baseIndex + numLineIndices) * sizeof(GLuint)), baseVertex);
+      app->currentProfilingResults.counters.drawCalls++;
+    }
+    app->currentProfilingResults.counters.vertices += numVertices;
 
-    glDrawElements(GL_TRIANGLES, totalPolygonIndices, GL_UNSIGNED_INT, (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
   }
 
   renderer.lines.clear();
@@ -588,12 +652,20 @@ void RenderMainViewport(App* app)
 {
   PROFILE_SCOPE();
   Renderer renderer = { .arena = app->frameArena, .app = app, .nextZIndex = 1 };
+  app->mainViewportStreamVBO.beginFrame();
+  app->mainViewportStreamIBO.beginFrame();
 
-  RenderDocumentBackground(app, renderer);
-  RenderBatch(app, renderer);
+  {
+    GPU_PROFILE_SCOPE("Background");
+    RenderDocumentBackground(app, renderer);
+    RenderBatch(app, renderer);
+  }
 
   RenderDocumentForeground(app, renderer);
   RenderBatch(app, renderer);
+
+  app->mainViewportStreamVBO.endFrame();
+  app->mainViewportStreamIBO.endFrame();
 }
 
 void HandleClayErrors(Clay_ErrorData errorData)
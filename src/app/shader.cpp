@@ -64,6 +64,70 @@ void main() {
     FragColor = vertexColor;
 })";
 
+// Draws one instanced quad per visible page. The corners are derived from gl_VertexID, so the only vertex data is
+// the page rectangle in pixels and the page size in millimeters.
+const char* paperVertexShaderSrc = R"(
+#version 330 core
+layout (location = 0) in vec4 aRectPx;
+layout (location = 1) in vec2 aSizeMm;
+
+uniform mat4 pixelProjection;
+
+out vec2 pageMm;
+flat out vec2 pageSizeMm;
+flat out vec2 pxPerMm;
+
+void main() {
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+  gl_Position = pixelProjection * vec4(aRectPx.xy + corner * aRectPx.zw, 0.0, 1.0);
+  pageMm = corner * aSizeMm;
+  pageSizeMm = aSizeMm;
+  pxPerMm = aRectPx.zw / aSizeMm;
+})";
+
+const char* paperFragmentShaderSrc = R"(
+#version 330 core
+
+out vec4 FragColor;
+in vec2 pageMm;
+flat in vec2 pageSizeMm;
+flat in vec2 pxPerMm;
+
+uniform int uPaperStyle;
+uniform float uGridSpacingMm;
+uniform vec4 uGridColor;
+uniform vec4 uPaperColor;
+uniform vec4 uOutlineColor;
+
+const int STYLE_SQUARED = 0;
+const int STYLE_LINED = 1;
+const int STYLE_DOTTED = 2;
+const float DOT_RADIUS_PX = 1.0;
+
+void main() {
+  // Distance in pixels to the nearest grid line in each direction, lines are 1px wide and antialiased
+  vec2 spacingPx = uGridSpacingMm * pxPerMm;
+  vec2 distPx = abs(fract(pageMm / uGridSpacingMm + 0.5) - 0.5) * spacingPx;
+
+  float grid = 0.0;
+  if (uPaperStyle == STYLE_SQUARED) {
+    grid = clamp(1.0 - min(distPx.x, distPx.y), 0.0, 1.0);
+  } else if (uPaperStyle == STYLE_LINED) {
+    grid = clamp(1.0 - distPx.y, 0.0, 1.0);
+  } else if (uPaperStyle == STYLE_DOTTED) {
+    grid = clamp(DOT_RADIUS_PX + 0.5 - length(distPx), 0.0, 1.0);
+  }
+
+  // Fade the grid out when zooming out so it does not turn into a solid color
+  grid *= smoothstep(3.0, 8.0, min(spacingPx.x, spacingPx.y));
+
+  vec2 edgePx = min(pageMm, pageSizeMm - pageMm) * pxPerMm;
+  float outline = clamp(1.0 - min(edgePx.x, edgePx.y), 0.0, 1.0);
+
+  vec4 color = mix(uPaperColor, vec4(uGridColor.rgb, 1.0), grid * uGridColor.a);
+  FragColor = mix(color, uOutlineColor, outline * uOutlineColor.a);
+})";
+
 GLuint CompileShader(GLenum type, const char* src)
 {
   GLuint shader = glCreateShader(type);
@@ -85,7 +149,18 @@ GLuint CompileShader(GLenum type, const char* src)
   return shader;
 }
 
-GLuint CreateShaderProgram(const char* vs, const char* fs)
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t hashString(uint64_t hash, const char* str)
+{
+  for (const char* c = str; *c; c++) {
+    hash = (hash ^ (uint8_t)*c) * FNV_PRIME;
+  }
+  return hash;
+}
+
+static GLuint CompileShaderProgram(const char* vs, const char* fs, bool retrievable)
 {
   GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vs);
   if (!vertexShader) {
@@ -97,6 +172,9 @@ GLuint CreateShaderProgram(const char* vs, const char* fs)
     return 0;
   }
   GLuint program = glCreateProgram();
+  if (retrievable) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
   glAttachShader(program, vertexShader);
   glAttachShader(program, fragmentShader);
   glLinkProgram(program);
@@ -119,3 +197,86 @@ GLuint CreateShaderProgram(const char* vs, const char* fs)
   glDeleteShader(fragmentShader);
   return program;
 }
+
+// Linked program binaries are cached in the build directory, keyed by the driver and the shader sources. A driver
+// update changes the key, and a binary the driver rejects anyway is simply recompiled.
+static bool isShaderBinaryCacheSupported()
+{
+  if (!GLAD_GL_VERSION_4_1) {
+    return false;
+  }
+  GLint numberOfFormats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numberOfFormats);
+  return numberOfFormats > 0;
+}
+
+static String getShaderBinaryCachePath(Arena& arena, const char* vs, const char* fs)
+{
+  uint64_t hash = FNV_OFFSET_BASIS;
+  hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+  hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+  hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+  hash = hashString(hash, vs);
+  hash = hashString(hash, fs);
+  return format(arena, "build/shadercache-{}.bin", (unsigned long long)hash);
+}
+
+static GLuint LoadShaderProgramBinary(String path)
+{
+  Arena arena = Arena::create();
+  GLuint program = 0;
+  auto file = ts::fs::read(arena, path);
+  if (file && file->length > sizeof(GLenum)) {
+    GLenum binaryFormat;
+    memcpy(&binaryFormat, file->data, sizeof(binaryFormat));
+    program = glCreateProgram();
+    glProgramBinary(program, binaryFormat, file->data + sizeof(binaryFormat), file->length - sizeof(binaryFormat));
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE) {
+      glDeleteProgram(program);
+      program = 0;
+    }
+  }
+  arena.free();
+  return program;
+}
+
+static void StoreShaderProgramBinary(GLuint program, String path)
+{
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  Arena arena = Arena::create();
+  char* data = arena.allocate<char>(length);
+  GLenum binaryFormat;
+  glGetProgramBinary(program, length, &length, &binaryFormat, data);
+  FILE* file = fopen(path.c_str(arena), "wb");
+  if (file) {
+    fwrite(&binaryFormat, sizeof(binaryFormat), 1, file);
+    fwrite(data, length, 1, file);
+    fclose(file);
+  }
+  arena.free();
+}
+
+GLuint CreateShaderProgram(const char* vs, const char* fs)
+{
+  if (!isShaderBinaryCacheSupported()) {
+    return CompileShaderProgram(vs, fs, false);
+  }
+
+  StackArena<512> arena;
+  auto path = getShaderBinaryCachePath(arena, vs, fs);
+  if (GLuint program = LoadShaderProgramBinary(path)) {
+    return program;
+  }
+  GLuint program = CompileShaderProgram(vs, fs, true);
+  if (program) {
+    StoreShaderProgramBinary(program, path);
+  }
+  return program;
+}
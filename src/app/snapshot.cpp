@@ -0,0 +1,251 @@
+#include "../shared/app.h"
+#include <stdio.h>
+
+// Documents are saved on a worker thread, so that inking continues while a large document is written. Starting a
+// save copies the page and shape headers of the document into a snapshot. The points of a committed shape are never
+// modified again and the document arena never moves memory, so the snapshot shares them with the document instead of
+// copying them. The document must not be unloaded while the save is running, see waitForDocumentSave.
+//
+// The file is written to "<file>.tmp" and renamed over the old one once it is complete and synced, so a crash while
+// saving leaves the previous version intact.
+
+const size_t DOCUMENT_SAVE_FLUSH_SIZE = 64 * 1024;
+
+struct DocumentSnapshotPage {
+  LineShape* shapes;
+  size_t numberOfShapes;
+};
+
+struct DocumentSnapshot {
+  Arena arena;
+  BackgroundJobStatus status;
+  String filepath;
+  Color paperColor;
+  PaperStyle paperStyle;
+  float gridSpacingMm;
+  float accuracyScaling;
+  uint64_t journalSequence;
+  DocumentSnapshotPage* pages;
+  size_t numberOfPages;
+  size_t numberOfPoints;
+  uint64_t startNs;
+  bool succeeded;
+  double durationMs;
+};
+
+struct DocumentSnapshotWriter {
+  Arena& arena;
+  FILE* file;
+  ts::StringBuffer buffer;
+  bool failed;
+
+  void write(String str)
+  {
+    buffer.append(arena, str);
+    if (buffer.length >= DOCUMENT_SAVE_FLUSH_SIZE) {
+      flush();
+    }
+  }
+
+  // Round-trip representation that reads back as the same value, written directly into the buffer
+  template <typename T> void writeNumber(T value)
+  {
+    if (isnan(value) || isinf(value)) {
+      write("null"_s);
+      return;
+    }
+    buffer.appendNumber(arena, value);
+    if (buffer.length >= DOCUMENT_SAVE_FLUSH_SIZE) {
+      flush();
+    }
+  }
+
+  void flush()
+  {
+    if (buffer.length > 0 && fwrite(buffer.data, buffer.length, 1, file) != 1) {
+      failed = true;
+    }
+    buffer.length = 0;
+  }
+};
+
+static bool writeDocumentSnapshot(DocumentSnapshot* snapshot, FILE* file)
+{
+  auto& arena = snapshot->arena;
+  DocumentSnapshotWriter writer = { .arena = arena, .file = file, .buffer = {}, .failed = false };
+  size_t pointsWritten = 0;
+
+  writer.write("{\"filetype\":\"technicalsketcher\",\"fileversion\":1,\"papercolor\":\""_s);
+  writer.write(snapshot->paperColor.toHex(arena));
+  writer.write("\",\"paperstyle\":"_s);
+  writer.writeNumber((double)snapshot->paperStyle);
+  writer.write(",\"gridspacing\":"_s);
+  writer.writeNumber(snapshot->gridSpacingMm);
+  writer.write(",\"journalsequence\":"_s);
+  writer.writeNumber((double)snapshot->journalSequence);
+  writer.write(",\"pages\":["_s);
+
+  for (size_t i = 0; i < snapshot->numberOfPages; i++) {
+    auto& page = snapshot->pages[i];
+    writer.write(i == 0 ? "{\"shapes\":["_s : ",{\"shapes\":["_s);
+    for (size_t j = 0; j < page.numberOfShapes; j++) {
+      auto& shape = page.shapes[j];
+      writer.write(j == 0 ? "{\"color\":\""_s : ",{\"color\":\""_s);
+      writer.write(shape.color.toHex(arena));
+      writer.write("\",\"points\":["_s);
+      bool first = true;
+      for (auto& point : shape.points) {
+        writer.write(first ? "{\"x\":"_s : ",{\"x\":"_s);
+        writer.writeNumber(point.pos_mm_scaled.x / snapshot->accuracyScaling);
+        writer.write(",\"y\":"_s);
+        writer.writeNumber(point.pos_mm_scaled.y / snapshot->accuracyScaling);
+        writer.write(",\"pressure\":"_s);
+        writer.writeNumber(point.pressure);
+        writer.write("}"_s);
+        first = false;
+      }
+      writer.write("]}"_s);
+      pointsWritten += shape.points.length;
+      if (snapshot->numberOfPoints > 0) {
+        SDL_SetAtomicInt(&snapshot->status.progressPermille, pointsWritten * 1000 / snapshot->numberOfPoints);
+      }
+    }
+    writer.write("]}"_s);
+  }
+  writer.write("]}"_s);
+  writer.flush();
+  return !writer.failed;
+}
+
+static int SDLCALL DocumentSaveThread(void* userdata)
+{
+  auto snapshot = (DocumentSnapshot*)userdata;
+  auto& arena = snapshot->arena;
+  auto tempPath = format(arena, "{}.tmp", snapshot->filepath);
+
+  FILE* file = fopen(tempPath.c_str(arena), "wb");
+  if (file) {
+    bool written = writeDocumentSnapshot(snapshot, file) && SyncFileToDisk(file);
+    fclose(file);
+    snapshot->succeeded = written && RenameFileReplacing(arena, tempPath, snapshot->filepath);
+  }
+
+  snapshot->durationMs = (SDL_GetTicksNS() - snapshot->startNs) / 1000000.0;
+  SDL_SetAtomicInt(&snapshot->status.progressPermille, 1000);
+  SDL_SetAtomicInt(&snapshot->status.finished, 1);
+  return 0;
+}
+
+// Returns false if a save of this document is already running
+bool startDocumentSave(App* app, Document& document, String filepath)
+{
+  auto& save = document.save;
+  if (save.thread) {
+    return false;
+  }
+
+  Arena arena = Arena::create();
+  auto snapshot = arena.allocate<DocumentSnapshot>();
+  snapshot->arena = arena;
+  snapshot->filepath = String::clone(arena, filepath);
+  snapshot->paperColor = document.paperColor;
+  snapshot->paperStyle = document.paperStyle;
+  snapshot->gridSpacingMm = document.gridSpacingMm;
+  snapshot->accuracyScaling = app->perfectFreehandAccuracyScaling;
+  snapshot->journalSequence = document.journal.nextSequence;
+  snapshot->startNs = SDL_GetTicksNS();
+
+  snapshot->numberOfPages = document.pages.length;
+  snapshot->pages = arena.allocate<DocumentSnapshotPage>(document.pages.length);
+  size_t pageIndex = 0;
+  for (auto& page : document.pages) {
+    auto& snapshotPage = snapshot->pages[pageIndex++];
+    snapshotPage.shapes = arena.allocate<LineShape>(page.shapes.length);
+    for (auto& shape : page.shapes) {
+      snapshotPage.shapes[snapshotPage.numberOfShapes++] = shape;
+      snapshot->numberOfPoints += shape.points.length;
+    }
+  }
+
+  SDL_SetAtomicInt(&snapshot->status.progressPermille, 0);
+  SDL_SetAtomicInt(&snapshot->status.finished, 0);
+  save.snapshot = snapshot;
+  save.status = &snapshot->status;
+  save.thread = SDL_CreateThread(DocumentSaveThread, "DocumentSave", snapshot);
+  if (!save.thread) {
+    print("Failed to start the save thread: {}", SDL_GetError());
+    save.snapshot = 0;
+    save.status = 0;
+    arena.free();
+    return false;
+  }
+  return true;
+}
+
+static void finishDocumentSave(App* app, Document& document)
+{
+  auto& save = document.save;
+  SDL_WaitThread(save.thread, 0);
+  save.thread = 0;
+
+  auto snapshot = save.snapshot;
+  save.snapshot = 0;
+  save.status = 0;
+  save.lastDurationMs = snapshot->durationMs;
+  save.lastSaveFailed = !snapshot->succeeded;
+  if (snapshot->succeeded) {
+    // Changes made while saving are still in the journal of the previous file, they are moved into the new one
+    String previousJournalPath = {};
+    if (document.filepath.length > 0) {
+      previousJournalPath = getJournalPath(app->frameArena, document.filepath);
+    }
+    if (!(document.filepath == snapshot->filepath)) {
+      document.filepath = String::clone(document.arena, snapshot->filepath);
+    }
+    compactDocumentJournal(app, document, snapshot->journalSequence, previousJournalPath);
+    print("Saved '{}' in {} ms", document.filepath, save.lastDurationMs);
+  } else {
+    print("Failed to save '{}', the previous version was kept", snapshot->filepath);
+  }
+
+  Arena arena = snapshot->arena;
+  arena.free();
+}
+
+// Called once per frame, finishes a completed save and starts a requested one
+void updateDocumentSave(App* app, Document& document)
+{
+  auto& save = document.save;
+  if (save.thread && SDL_GetAtomicInt(&save.status->finished)) {
+    finishDocumentSave(app, document);
+  }
+  if (save.requested && !save.thread) {
+    save.requested = false;
+    startDocumentSave(app, document, save.requestedFilepath);
+  }
+}
+
+// Saves in the background, or after the currently running save if there is one
+void requestDocumentSave(App* app, Document& document, String filepath)
+{
+  if (!startDocumentSave(app, document, filepath)) {
+    document.save.requested = true;
+    document.save.requestedFilepath = String::clone(document.arena, filepath);
+  }
+}
+
+void waitForDocumentSave(App* app, Document& document)
+{
+  if (document.save.thread) {
+    finishDocumentSave(app, document);
+  }
+}
+
+// Blocking save, for callers that need the file on disk when this returns
+void saveDocumentToFile(App* app, Document& document, String filepath)
+{
+  waitForDocumentSave(app, document);
+  if (startDocumentSave(app, document, filepath)) {
+    waitForDocumentSave(app, document);
+  }
+}
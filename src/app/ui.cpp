@@ -3,6 +3,8 @@
 #include "components.cpp"
 #include <SDL3/SDL_timer.h>
 
+const size_t BUILD_LOG_VISIBLE_LINES = 20;
+
 static inline Clay_Dimensions MeasureTextImpl(App* app, int fontId, float fontSize, float letterSpacing, String text)
 {
   auto& fs = app->rendererData.fontContext;
@@ -45,7 +47,7 @@ void ui(App* app)
   static double fps = 0;
   double newFPS = 1000000000.0 / delta;
   fps = fps * (1 - alpha) + newFPS * alpha;
-  // print("FPS: {}", fps);
+  // print("FPS: {:.1}", fps);
 
   div(app,
       {
@@ -81,7 +83,7 @@ void ui(App* app)
                       .layoutDirection = "down"_s,
                   },
                   [&](App* app) {
-                    text(app, {}, format(app->frameArena, "FPS: {}", fps));
+                    text(app, {}, format(app->frameArena, "FPS: {:.1}", fps));
 
                     div(app,
                         {
@@ -92,14 +94,100 @@ void ui(App* app)
                           auto& p = app->lastFrameProfilingResults;
                           text(app, {}, "Profiling Results:");
 
-                          text(app, {}, format(app->frameArena, "Frame time: {} ms", p.frametimeMs));
+                          text(app, {}, format(app->frameArena, "Frame time: {:.2} ms", p.frametimeMs));
 
                           for (size_t i = 0; i < p.numOfResults; i++) {
                             auto& r = p.results[i];
                             double ratio = r.msTaken / p.frametimeMs;
-                            text(app, {}, format(app->frameArena, "{}: {}%", r.scopeName, ratio * 100));
+                            text(app, {}, format(app->frameArena, "{}: {:.1}%", r.scopeName, ratio * 100));
                           }
                         });
+
+                    if (app->showRenderStats) {
+                      div(app,
+                          {
+                              .id = "render-stats"_s,
+                              .layoutDirection = "col"_s,
+                          },
+                          [&](App* app) {
+                            auto& p = app->lastFrameProfilingResults;
+                            auto& c = p.counters;
+                            text(app, {}, "Render Stats (F3):");
+                            for (size_t i = 0; i < p.numOfGpuResults; i++) {
+                              auto& r = p.gpuResults[i];
+                              text(app, {}, format(app->frameArena, "GPU {}: {:.2} ms", r.scopeName, r.msTaken));
+                            }
+                            text(app, {}, format(app->frameArena, "Draw calls: {}", c.drawCalls));
+                            text(app, {}, format(app->frameArena, "Vertices: {}", c.vertices));
+                            text(app, {},
+                                format(app->frameArena, "Texture uploads: {} KiB", c.textureUploadBytes / 1024));
+                            text(app, {}, format(app->frameArena, "FBO reallocations: {}", c.fboReallocations));
+                            text(app, {}, format(app->frameArena, "Shapes rasterized: {}", c.shapesRasterized));
+                          });
+                    }
+
+                    if (app->buildRunning || app->compileError) {
+                      div(app,
+                          {
+                              .id = "build-log"_s,
+                              .layoutDirection = "col"_s,
+                          },
+                          [&](App* app) {
+                            if (app->buildRunning) {
+                              text(app, {}, "Rebuilding..."_s);
+                            } else {
+                              text(app, {},
+                                  format(app->frameArena, "Build failed after {:.0} ms, running previous version:",
+                                      app->lastCompileMs));
+                            }
+                            // Only the last lines of the output, the start of a build log is rarely interesting
+                            String log = String::view(app->buildLog.data, app->buildLog.length);
+                            size_t start = log.length;
+                            for (size_t lines = 0; start > 0 && lines <= BUILD_LOG_VISIBLE_LINES; start--) {
+                              if (log[start - 1] == '\n') {
+                                lines++;
+                              }
+                            }
+                            size_t lineStart = start;
+                            for (size_t i = start; i <= log.length; i++) {
+                              if (i == log.length || log[i] == '\n') {
+                                if (i > lineStart) {
+                                  text(app, {}, log.substr(lineStart, i - lineStart));
+                                }
+                                lineStart = i + 1;
+                              }
+                            }
+                          });
+                    } else if (app->lastReloadSwapMs > 0) {
+                      text(app, {},
+                          format(app->frameArena, "Reloaded: compile {:.0} ms, swap {:.1} ms", app->lastCompileMs,
+                              app->lastReloadSwapMs));
+                    }
+
+                    if (app->documents.length > 0) {
+                      auto& save = app->documents[app->selectedDocument].save;
+                      if (save.thread) {
+                        text(app, {},
+                            format(app->frameArena, "Saving... {}%",
+                                SDL_GetAtomicInt(&save.status->progressPermille) / 10));
+                      } else if (save.lastSaveFailed) {
+                        text(app, {}, "Saving failed"_s);
+                      } else if (save.lastDurationMs > 0) {
+                        text(app, {}, format(app->frameArena, "Saved in {:.1} ms", save.lastDurationMs));
+                      }
+
+                      auto& backgroundExport = app->documents[app->selectedDocument].backgroundExport;
+                      if (backgroundExport.thread) {
+                        text(app, {},
+                            format(app->frameArena, "Exporting... {}%",
+                                SDL_GetAtomicInt(&backgroundExport.status->progressPermille) / 10));
+                      } else if (backgroundExport.lastExportFailed) {
+                        text(app, {}, "Export failed"_s);
+                      } else if (backgroundExport.lastDurationMs > 0) {
+                        text(app, {},
+                            format(app->frameArena, "Exported in {:.1} ms", backgroundExport.lastDurationMs));
+                      }
+                    }
                   });
               div(app,
                   {
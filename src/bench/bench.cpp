@@ -0,0 +1,287 @@
+// Headless benchmark for the CPU side of the stroke and document pipeline.
+// It reuses the app unity build, but never creates a window or GL context.
+//
+// Usage: tsk_bench [--iterations N] [--synthetic PAGES SHAPES POINTS] [file.json ...]
+//
+// Every measurement is printed as one JSON object per line, so the output can be appended to a log and compared
+// across commits.
+
+#include "../app/app.cpp"
+#include "../app/cJSON.h"
+
+const auto BENCH_DEFAULT_ITERATIONS = 10;
+const auto BENCH_SYNTHETIC_FILE = "tsk_bench_synthetic.json"_s;
+const auto BENCH_SAVE_FILE = "tsk_bench_save.json"_s;
+
+struct BenchResult {
+  const char* name;
+  size_t iterations;
+  size_t items;
+  double minMs;
+  double meanMs;
+  double maxMs;
+  Optional<size_t> arenaBytes;
+};
+
+// Runs `fn` `iterations` times with a freshly cleared arena. `fn` returns the number of processed items
+// (points, shapes, ...) and the arena usage of the last iteration is reported as allocation size.
+template <typename Fn> BenchResult runBenchmark(const char* name, size_t iterations, Fn fn)
+{
+  BenchResult result = { .name = name, .iterations = iterations, .minMs = 1e300 };
+  Arena arena = Arena::create();
+  double totalMs = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    arena.clearAndReinit();
+    uint64_t start = SDL_GetTicksNS();
+    result.items = fn(arena);
+    double ms = (SDL_GetTicksNS() - start) / 1000000.0;
+    result.minMs = min(result.minMs, ms);
+    result.maxMs = max(result.maxMs, ms);
+    totalMs += ms;
+  }
+  result.meanMs = totalMs / max(iterations, 1);
+  result.arenaBytes = arena.bytesUsed();
+  arena.free();
+  return result;
+}
+
+// Escapes quotes, backslashes (e.g. in Windows paths) and control characters for a JSON string
+String escapeJsonString(Arena& arena, String str)
+{
+  size_t length = 0;
+  for (size_t i = 0; i < str.length; i++) {
+    unsigned char c = str.data[i];
+    length += c == '"' || c == '\\' ? 2 : c < 0x20 ? 6 : 1;
+  }
+  char* escaped = arena.allocate<char>(length);
+  size_t j = 0;
+  for (size_t i = 0; i < str.length; i++) {
+    unsigned char c = str.data[i];
+    if (c == '"' || c == '\\') {
+      escaped[j++] = '\\';
+      escaped[j++] = c;
+    } else if (c < 0x20) {
+      const char* hex = "0123456789abcdef";
+      memcpy(escaped + j, "\\u00", 4);
+      escaped[j + 4] = hex[c >> 4];
+      escaped[j + 5] = hex[c & 15];
+      j += 6;
+    } else {
+      escaped[j++] = c;
+    }
+  }
+  return String::view(escaped, length);
+}
+
+void printResult(String input, BenchResult result)
+{
+  Arena arena = Arena::create(input.length * 6 + 128);
+  String bytes = result.arenaBytes ? format(arena, "{}", result.arenaBytes.value()) : "null"_s;
+  print("{{\"benchmark\":\"{}\",\"input\":\"{}\",\"iterations\":{},\"items\":{},\"min_ms\":{},\"mean_ms\":{},"
+        "\"max_ms\":{},\"arena_bytes\":{}}}",
+      result.name, escapeJsonString(arena, input), result.iterations, result.items, result.minMs, result.meanMs,
+      result.maxMs, bytes);
+  arena.free();
+}
+
+size_t countPoints(Document& document)
+{
+  size_t points = 0;
+  for (auto& page : document.pages) {
+    for (auto& shape : page.shapes) {
+      points += shape.points.length;
+    }
+  }
+  return points;
+}
+
+// Fills every page with wavy strokes, similar to handwriting, so the benchmark does not depend on a file on disk
+void generateSyntheticDocument(App* app, size_t numPages, size_t numShapes, size_t numPoints)
+{
+  addDocument(app);
+  auto& document = app->documents.back();
+  for (size_t p = 0; p < numPages; p++) {
+    addEmptyPageToDocument(app, document);
+    auto& page = document.pages.back();
+    for (size_t s = 0; s < numShapes; s++) {
+      LineShape shape = { .color = Color("#000"), .prerendered = false };
+      double originX = 15 + (s % 6) * 30;
+      double originY = 15 + (s / 6 % 26) * 10;
+      for (size_t i = 0; i < numPoints; i++) {
+        double t = (double)i / max(numPoints - 1, 1);
+        Vec2 pos_mm = Vec2(originX + t * 25, originY + sin(t * 20 + s) * 3);
+        shape.points.push(document.arena,
+            {
+                .pos_mm_scaled = pos_mm * app->perfectFreehandAccuracyScaling,
+                .pressure = 0.5f + 0.3f * sin(t * 3.1415),
+            });
+      }
+      page.shapes.push(document.arena, shape);
+    }
+  }
+  app->selectedDocument = app->documents.length - 1;
+}
+
+// The DOM based loader that openDocumentFromFile used before the pull parser, kept as a reference for the "parse"
+// benchmark. It reads the whole file, builds the cJSON tree and decodes every point, but does not build a document.
+// Keeps the compiler from dropping the parsed values, see parseDocumentWithCJSON
+volatile double benchmarkChecksum = 0;
+
+size_t parseDocumentWithCJSON(Arena& arena, String filepath)
+{
+  auto file = ts::fs::read(arena, filepath);
+  if (!file) {
+    return 0;
+  }
+  auto json = cJSON_Parse(file->c_str(arena));
+  size_t points = 0;
+  double checksum = 0;
+  auto pagesArray = cJSON_GetObjectItem(json, "pages");
+  for (int i = 0; i < cJSON_GetArraySize(pagesArray); i++) {
+    auto shapesArray = cJSON_GetObjectItem(cJSON_GetArrayItem(pagesArray, i), "shapes");
+    for (int j = 0; j < cJSON_GetArraySize(shapesArray); j++) {
+      auto shapeJson = cJSON_GetArrayItem(shapesArray, j);
+      Color color = Color(cJSON_GetStringValue(cJSON_GetObjectItem(shapeJson, "color")));
+      auto pointsArray = cJSON_GetObjectItem(shapeJson, "points");
+      for (int k = 0; k < cJSON_GetArraySize(pointsArray); k++) {
+        auto pointJson = cJSON_GetArrayItem(pointsArray, k);
+        SamplePoint point = {
+          .pos_mm_scaled = Vec2(cJSON_GetNumberValue(cJSON_GetObjectItem(pointJson, "x")),
+              cJSON_GetNumberValue(cJSON_GetObjectItem(pointJson, "y"))),
+          .pressure = (float)cJSON_GetNumberValue(cJSON_GetObjectItem(pointJson, "pressure")),
+        };
+        checksum += point.pos_mm_scaled.x + point.pos_mm_scaled.y + point.pressure + color.a;
+        points++;
+      }
+    }
+  }
+  cJSON_Delete(json);
+  benchmarkChecksum = benchmarkChecksum + checksum;
+  return points;
+}
+
+void benchmarkFile(App* app, String filepath, size_t iterations)
+{
+  // The cJSON tree is allocated with malloc, so the arena size only covers the file contents
+  printResult(filepath, runBenchmark("parse_cjson", iterations, [&](Arena& arena) {
+    return parseDocumentWithCJSON(arena, filepath);
+  }));
+  // Every iteration loads into a scratch document that is unloaded again, its arena is the allocation size
+  size_t documentBytes = 0;
+  auto parse = runBenchmark("parse", iterations, [&](Arena& arena) {
+    Document scratch = createEmptyDocument();
+    loadDocumentFromFile(app, scratch, filepath, false);
+    size_t points = countPoints(scratch);
+    documentBytes = scratch.arena.bytesUsed();
+    unloadDocument(app, scratch);
+    return points;
+  });
+  parse.arenaBytes = documentBytes;
+  printResult(filepath, parse);
+
+  openDocumentFromFile(app, filepath, false);
+  auto& document = app->documents.back();
+  app->selectedDocument = app->documents.length - 1;
+
+  printResult(filepath, runBenchmark("get_stroke", iterations, [&](Arena& arena) {
+    size_t outlinePoints = 0;
+    for (auto& page : document.pages) {
+      for (auto& shape : page.shapes) {
+        outlinePoints += getStrokeOutline(app, arena, shape.points).length;
+      }
+    }
+    return outlinePoints;
+  }));
+
+  printResult(filepath, runBenchmark("path", iterations, [&](Arena& arena) {
+    size_t pathBytes = 0;
+    for (auto& page : document.pages) {
+      for (auto& shape : page.shapes) {
+        pathBytes += getPath(app, arena, shape.points).length;
+      }
+    }
+    return pathBytes;
+  }));
+
+  printResult(filepath, runBenchmark("rasterize", iterations, [&](Arena& arena) {
+    size_t shapes = 0;
+    for (auto& page : document.pages) {
+      Vec2i size = page.getRenderSizePx(app);
+      page.visibleSizePx = Vec2(size.x, size.y);
+      page.visibleOffsetPx = Vec2(0, 0);
+      for (auto& shape : page.shapes) {
+        cairo_surface_t* surface = RasterizeShape(app, arena, document, page, shape);
+        if (surface) {
+          cairo_surface_destroy(surface);
+          shapes++;
+        }
+      }
+    }
+    return shapes;
+  }));
+
+  // Saving allocates from its own arena, which is freed before returning, so no arena size is reported
+  auto save = runBenchmark("save", iterations, [&](Arena& arena) {
+    saveDocumentToFile(app, document, BENCH_SAVE_FILE);
+    return countPoints(document);
+  });
+  save.arenaBytes = {};
+  printResult(filepath, save);
+  remove(BENCH_SAVE_FILE.c_str(app->frameArena));
+  remove(getJournalPath(app->frameArena, BENCH_SAVE_FILE).c_str(app->frameArena));
+}
+
+int main(int argc, char* argv[])
+{
+  Arena mainArena = Arena::create();
+  App* app = mainArena.allocate<App>();
+  app->persistentApplicationArena = mainArena;
+  app->frameArena.clearAndReinit();
+  initAppConstants(app);
+  app->svgOpts = resvg_options_create();
+
+  size_t iterations = BENCH_DEFAULT_ITERATIONS;
+  List<String> files;
+  for (int i = 1; i < argc; i++) {
+    auto arg = String::view(argv[i]);
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = ts::strToInt(String::view(argv[++i])).value_or(BENCH_DEFAULT_ITERATIONS);
+    } else if (arg == "--synthetic" && i + 3 < argc) {
+      size_t pages = ts::strToInt(String::view(argv[++i])).value_or(1);
+      size_t shapes = ts::strToInt(String::view(argv[++i])).value_or(1);
+      size_t points = ts::strToInt(String::view(argv[++i])).value_or(1);
+      generateSyntheticDocument(app, pages, shapes, points);
+      saveDocumentToFile(app, app->documents.back(), BENCH_SYNTHETIC_FILE);
+      files.push(app->persistentApplicationArena, BENCH_SYNTHETIC_FILE);
+    } else if (arg.startsWith("--")) {
+      ts::print_stderr("Unknown argument '{}'", arg);
+      ts::print_stderr("Usage: tsk_bench [--iterations N] [--synthetic PAGES SHAPES POINTS] [file.json ...]");
+      return 1;
+    } else {
+      files.push(app->persistentApplicationArena, arg);
+    }
+  }
+
+  if (files.length == 0) {
+    files.push(app->persistentApplicationArena, "output.json"_s);
+  }
+
+  for (auto& file : files) {
+    if (!ts::fs::exists(file)) {
+      ts::print_stderr("File '{}' does not exist", file);
+      continue;
+    }
+    benchmarkFile(app, file, iterations);
+  }
+
+  remove(BENCH_SYNTHETIC_FILE.c_str(app->frameArena));
+  remove(getJournalPath(app->frameArena, BENCH_SYNTHETIC_FILE).c_str(app->frameArena));
+  resvg_options_destroy(app->svgOpts);
+  for (auto& document : app->documents) {
+    unloadDocument(app, document);
+  }
+  app->frameArena.free();
+  Arena arena = app->persistentApplicationArena;
+  arena.free();
+  return 0;
+}
@@ -3,19 +3,68 @@
 
 using ts::print;
 
-const uint64_t HOTRELOAD_UPDATE_RATE = 100;
+const uint64_t HOTRELOAD_DEBOUNCE_MS = 100;
 
+#ifdef TSK_WINDOWS
+const auto APP_LIBRARY_PATH = "build/Debug/app.dll"_s;
+#else
+const auto APP_LIBRARY_PATH = "build/libapp.so"_s;
+#endif
+
+// Everything the app library is built from, relative to the working directory
+const char* APP_SOURCE_DIRECTORIES[] = {
+  "src/app",
+  "src/app/clay",
+  "src/app/font",
+  "src/shared",
+  "src/shared/platform",
+  "src/GL",
+};
+const char* APP_BUILD_FILES[] = { "CMakeLists.txt" };
+
+// Used to skip the startup build: The library is up to date when it is newer than every file it is built from.
+// Like make, this relies on modification dates only.
+bool isAppLibUpToDate(App* app)
+{
+  auto libraryDate = GetFileModificationDate(APP_LIBRARY_PATH);
+  if (!libraryDate) {
+    return false;
+  }
+  for (auto file : APP_BUILD_FILES) {
+    auto date = GetFileModificationDate(String::view(file));
+    if (!date || *date >= *libraryDate) {
+      return false;
+    }
+  }
+  for (auto directory : APP_SOURCE_DIRECTORIES) {
+    auto files = ListDirectory(app->frameArena, String::view(directory));
+    if (!files) {
+      return false;
+    }
+    for (auto& file : *files) {
+      auto date = GetFileModificationDate(file);
+      if (!date || *date >= *libraryDate) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Synchronous build, only used at startup when there is no app library to keep rendering with
 bool compileApp(App* app)
 {
-  print("Application code changed, recompiling...\n");
+  print("Compiling application...\n");
+  uint64_t start = SDL_GetTicksNS();
   auto result = system("cmake --build build --target app");
+  app->lastCompileMs = (SDL_GetTicksNS() - start) / 1000000.0;
   if (result != 0) {
     print("Failed to build app!\n");
     app->compileError = true;
     return false;
   }
 
-  print("Done, reloaded app!\n");
+  print("Done, compiled app in {} ms\n", app->lastCompileMs);
   app->compileError = false;
   return true;
 }
@@ -44,13 +93,7 @@ bool loadAppLib(App* app)
 {
   closeAppLib(app);
 
-#ifdef TSK_WINDOWS
-  String libraryPath = "build/Debug/app.dll"_s;
-#else
-  String libraryPath = "build/libapp.so"_s;
-#endif
-
-  if (auto result = LoadLibrary(app->frameArena, libraryPath)) {
+  if (auto result = LoadLibrary(app->frameArena, APP_LIBRARY_PATH)) {
     app->appLibraryHandle = *result;
   } else {
     print("Error loading library: {}", result.error());
@@ -65,125 +108,143 @@ bool loadAppLib(App* app)
   return true;
 }
 
-static SDL_AppResult UpdateHotreload(App* app)
+// Launches the build as a child process, the output is collected into app->buildLog by updateAppBuild. If a build
+// is already running, another one is started once it finished.
+void startAppBuild(App* app)
 {
-  auto now = SDL_GetTicks();
-  auto elapsed = now - app->lastHotreloadUpdate;
-  if (elapsed > HOTRELOAD_UPDATE_RATE) {
-    app->lastHotreloadUpdate = now;
-
-    bool reloadApp = false;
-    if (auto cwd = GetCurrentWorkingDirectory(app->frameArena)) {
-      auto result = ListDirectory(app->frameArena, format(app->frameArena, "{}/src/app", cwd.value_or(""_s)));
-      for (auto file : result.value_or({})) {
-        if (IsRegularFile(app->frameArena, file).value_or(false)) {
-          auto moddate = GetFileModificationDate(file).value_or(0);
-
-          bool found = false;
-          for (auto& [filename, timestamp] : app->fileModificationDates) {
-            if (filename == file) {
-              found = true;
-              if (timestamp != moddate) {
-                timestamp = moddate;
-                reloadApp = true;
-              }
-              break;
-            }
-          }
-          if (!found) {
-            app->fileModificationDates.push(
-                app->persistentApplicationArena, { String::clone(app->persistentApplicationArena, file), moddate });
-          }
-        }
-      }
-    }
+  if (app->buildRunning) {
+    app->buildRestartPending = true;
+    return;
+  }
 
-    bool reloadCore = false;
-    if (auto cwd = GetCurrentWorkingDirectory(app->frameArena)) {
-      auto result = ListDirectory(app->frameArena, format(app->frameArena, "{}/src/core", cwd.value_or(""_s)));
-      for (auto file : result.value_or({})) {
-        if (IsRegularFile(app->frameArena, file).value_or(false)) {
-          auto moddate = GetFileModificationDate(file).value_or(0);
-
-          bool found = false;
-          for (auto& [filename, timestamp] : app->fileModificationDates) {
-            if (filename == file) {
-              found = true;
-              if (timestamp != moddate) {
-                timestamp = moddate;
-                reloadCore = true;
-              }
-              break;
-            }
-          }
-          if (!found) {
-            app->fileModificationDates.push(
-                app->persistentApplicationArena, { String::clone(app->persistentApplicationArena, file), moddate });
-          }
-        }
-      }
-      result = ListDirectory(app->frameArena, format(app->frameArena, "{}/src/shared", cwd.value_or(""_s)));
-      for (auto file : result.value_or({})) {
-        if (IsRegularFile(app->frameArena, file).value_or(false)) {
-          auto moddate = GetFileModificationDate(file).value_or(0);
-
-          bool found = false;
-          for (auto& [filename, timestamp] : app->fileModificationDates) {
-            if (filename == file) {
-              found = true;
-              if (timestamp != moddate) {
-                timestamp = moddate;
-                reloadCore = true;
-              }
-              break;
-            }
-          }
-          if (!found) {
-            app->fileModificationDates.push(
-                app->persistentApplicationArena, { String::clone(app->persistentApplicationArena, file), moddate });
-          }
-        }
-      }
-      result = ListDirectory(app->frameArena, format(app->frameArena, "{}/src/shared/platform", cwd.value_or(""_s)));
-      for (auto file : result.value_or({})) {
-        if (IsRegularFile(app->frameArena, file).value_or(false)) {
-          auto moddate = GetFileModificationDate(file).value_or(0);
-
-          bool found = false;
-          for (auto& [filename, timestamp] : app->fileModificationDates) {
-            if (filename == file) {
-              found = true;
-              if (timestamp != moddate) {
-                timestamp = moddate;
-                reloadCore = true;
-              }
-              break;
-            }
-          }
-          if (!found) {
-            app->fileModificationDates.push(
-                app->persistentApplicationArena, { String::clone(app->persistentApplicationArena, file), moddate });
-          }
-        }
+  print("Application code changed, recompiling in the background...\n");
+  app->buildLogArena.clearAndReinit();
+  app->buildLog = {};
+
+  List<String> args;
+  args.push(app->frameArena, "cmake"_s);
+  args.push(app->frameArena, "--build"_s);
+  args.push(app->frameArena, "build"_s);
+  args.push(app->frameArena, "--target"_s);
+  args.push(app->frameArena, "app"_s);
+  int options = subprocess_option_inherit_environment | subprocess_option_combined_stdout_stderr
+      | subprocess_option_search_user_path;
+  auto process = ts::Subprocess::create(args, options);
+  if (!process) {
+    print("Failed to start build: {}", process.error());
+    app->compileError = true;
+    return;
+  }
+  app->buildProcess = *process;
+  app->buildRunning = true;
+  app->buildStartNs = SDL_GetTicksNS();
+}
+
+void reloadAppLib(App* app)
+{
+  uint64_t start = SDL_GetTicksNS();
+  if (app->UnloadApp) {
+    app->UnloadApp(app, false);
+  }
+  loadAppLib(app);
+  if (app->LoadApp) {
+    app->LoadApp(app, false);
+  }
+  app->lastReloadSwapMs = (SDL_GetTicksNS() - start) / 1000000.0;
+}
+
+// Streams the build output and swaps the library once the build succeeded. The old library keeps running while
+// the build is in progress or when it failed.
+void updateAppBuild(App* app)
+{
+  if (!app->buildRunning) {
+    return;
+  }
+
+  app->buildProcess.readStdoutToBuffer(app->buildLogArena, app->buildLog);
+  if (app->buildProcess.alive()) {
+    return;
+  }
+  app->buildProcess.readStdoutToBuffer(app->buildLogArena, app->buildLog);
+
+  auto result = app->buildProcess.join(app->buildLogArena);
+  app->buildRunning = false;
+  app->lastCompileMs = (SDL_GetTicksNS() - app->buildStartNs) / 1000000.0;
+
+  if (!result || result.value().exitCode != 0) {
+    print("Failed to build app after {} ms, keeping the previous version\n", app->lastCompileMs);
+    app->compileError = true;
+  } else {
+    app->compileError = false;
+    reloadAppLib(app);
+    print("Done, compiled in {} ms and reloaded app in {} ms\n", app->lastCompileMs, app->lastReloadSwapMs);
+  }
+
+  if (app->buildRestartPending) {
+    app->buildRestartPending = false;
+    startAppBuild(app);
+  }
+}
+
+bool startHotreloadWatcher(App* app)
+{
+  auto watcher = CreateFileWatcher(app->persistentApplicationArena, HOTRELOAD_DEBOUNCE_MS);
+  if (!watcher) {
+    print("Failed to create file watcher, hotreloading is disabled: {}",
+        PlatformFSErrorToString(app->frameArena, watcher.error()));
+    return false;
+  }
+  app->hotreloadWatcher = *watcher;
+
+  auto cwd = GetCurrentWorkingDirectory(app->frameArena).value_or(""_s);
+  const char* directories[] = { "src/app", "src/core", "src/shared", "src/shared/platform" };
+  app->appSourceWatchId = -1;
+  for (auto directory : directories) {
+    auto path = format(app->frameArena, "{}/{}", cwd, directory);
+    if (auto id = AddFileWatch(app->frameArena, app->hotreloadWatcher, path)) {
+      if (String::view(directory) == "src/app") {
+        app->appSourceWatchId = *id;
       }
+    } else {
+      print("Failed to watch '{}': {}", path, PlatformFSErrorToString(app->frameArena, id.error()));
     }
+  }
+  return true;
+}
 
-    if (reloadCore) {
-      print("Core code changed, application must be restarted. Closing...\n");
-      return SDL_APP_SUCCESS;
-    }
+void stopHotreloadWatcher(App* app)
+{
+  if (app->hotreloadWatcher) {
+    DestroyFileWatcher(app->hotreloadWatcher);
+    app->hotreloadWatcher = 0;
+  }
+}
 
-    if (reloadApp) {
-      if (compileApp(app)) {
-        if (app->UnloadApp) {
-          app->UnloadApp(app);
-        }
-        loadAppLib(app);
-        if (app->LoadApp) {
-          app->LoadApp(app, false);
-        }
-      }
+static SDL_AppResult UpdateHotreload(App* app)
+{
+  if (!app->hotreloadWatcher) {
+    updateAppBuild(app);
+    return SDL_APP_CONTINUE;
+  }
+
+  bool reloadApp = false;
+  bool reloadCore = false;
+  for (auto& event : PollFileWatcher(app->frameArena, app->hotreloadWatcher)) {
+    if (event.watchId == app->appSourceWatchId) {
+      reloadApp = true;
+    } else {
+      reloadCore = true;
     }
   }
+
+  if (reloadCore) {
+    print("Core code changed, application must be restarted. Closing...\n");
+    return SDL_APP_SUCCESS;
+  }
+
+  if (reloadApp) {
+    startAppBuild(app);
+  }
+  updateAppBuild(app);
   return SDL_APP_CONTINUE;
-}
\ No newline at end of file
+}
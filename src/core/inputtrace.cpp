@@ -0,0 +1,275 @@
+
+#include "../shared/app.h"
+#include <stdio.h>
+
+// Input traces record the SDL events that reach the app's EventHandler, so that a session (e.g. heavy handwriting)
+// can be replayed as a repeatable benchmark. Traces are raw dumps of the SDL event structs and are only meant to be
+// replayed by a build with the same SDL version.
+//
+// File layout: "TSKTRACE", u32 version, u32 sizeof(SDL_Event), followed by records of
+// [u64 timestamp ns since start, u16 kind, u16 payload size, payload].
+//
+// For headless runs against llvmpipe, start with LIBGL_ALWAYS_SOFTWARE=1 SDL_VIDEODRIVER=offscreen and --hidden.
+
+const char INPUT_TRACE_MAGIC[8] = { 'T', 'S', 'K', 'T', 'R', 'A', 'C', 'E' };
+const uint32_t INPUT_TRACE_VERSION = 1;
+const size_t INPUT_TRACE_HISTOGRAM_BUCKETS = 1000;
+const double INPUT_TRACE_HISTOGRAM_BUCKET_MS = 0.1;
+
+enum class InputTraceMode {
+  None,
+  Record,
+  Replay,
+};
+
+enum class InputTraceReplaySpeed {
+  Original,
+  Maximum,
+};
+
+enum class InputTraceRecordKind : uint16_t {
+  Event = 0,
+  FrameEnd = 1,
+};
+
+struct InputTraceRecordHeader {
+  uint64_t timestampNs;
+  uint16_t kind;
+  uint16_t size;
+};
+
+struct InputTrace {
+  InputTraceMode mode;
+  InputTraceReplaySpeed speed;
+  uint64_t startNs;
+
+  // Recording
+  FILE* file;
+
+  // Replay
+  String data;
+  size_t cursor;
+  size_t frameNumber;
+  size_t eventsThisFrame;
+  double totalFrameMs;
+  double minFrameMs;
+  double maxFrameMs;
+  uint32_t histogram[INPUT_TRACE_HISTOGRAM_BUCKETS];
+};
+
+// Returns the size of the event struct if the event type is recorded, otherwise 0
+static size_t GetInputTraceEventSize(Uint32 type)
+{
+  switch (type) {
+  case SDL_EVENT_WINDOW_RESIZED:
+    return sizeof(SDL_WindowEvent);
+  case SDL_EVENT_KEY_DOWN:
+  case SDL_EVENT_KEY_UP:
+    return sizeof(SDL_KeyboardEvent);
+  case SDL_EVENT_MOUSE_MOTION:
+    return sizeof(SDL_MouseMotionEvent);
+  case SDL_EVENT_MOUSE_BUTTON_DOWN:
+  case SDL_EVENT_MOUSE_BUTTON_UP:
+    return sizeof(SDL_MouseButtonEvent);
+  case SDL_EVENT_MOUSE_WHEEL:
+    return sizeof(SDL_MouseWheelEvent);
+  case SDL_EVENT_FINGER_DOWN:
+  case SDL_EVENT_FINGER_UP:
+  case SDL_EVENT_FINGER_MOTION:
+  case SDL_EVENT_FINGER_CANCELED:
+    return sizeof(SDL_TouchFingerEvent);
+  case SDL_EVENT_PEN_DOWN:
+  case SDL_EVENT_PEN_UP:
+    return sizeof(SDL_PenTouchEvent);
+  case SDL_EVENT_PEN_MOTION:
+    return sizeof(SDL_PenMotionEvent);
+  case SDL_EVENT_PEN_BUTTON_DOWN:
+  case SDL_EVENT_PEN_BUTTON_UP:
+    return sizeof(SDL_PenButtonEvent);
+  case SDL_EVENT_PEN_AXIS:
+    return sizeof(SDL_PenAxisEvent);
+  default:
+    return 0;
+  }
+}
+
+static void WriteInputTraceRecord(InputTrace* trace, InputTraceRecordKind kind, void* payload, size_t size)
+{
+  InputTraceRecordHeader header = {
+    .timestampNs = SDL_GetTicksNS() - trace->startNs,
+    .kind = (uint16_t)kind,
+    .size = (uint16_t)size,
+  };
+  fwrite(&header, sizeof(header), 1, trace->file);
+  if (size > 0) {
+    fwrite(payload, size, 1, trace->file);
+  }
+}
+
+bool StartInputTraceRecording(App* app, String filepath)
+{
+  auto trace = app->persistentApplicationArena.allocate<InputTrace>();
+  trace->file = fopen(filepath.c_str(app->frameArena), "wb");
+  if (!trace->file) {
+    print("Failed to open input trace '{}' for writing", filepath);
+    return false;
+  }
+  uint32_t eventSize = sizeof(SDL_Event);
+  fwrite(INPUT_TRACE_MAGIC, sizeof(INPUT_TRACE_MAGIC), 1, trace->file);
+  fwrite(&INPUT_TRACE_VERSION, sizeof(INPUT_TRACE_VERSION), 1, trace->file);
+  fwrite(&eventSize, sizeof(eventSize), 1, trace->file);
+
+  trace->mode = InputTraceMode::Record;
+  trace->startNs = SDL_GetTicksNS();
+  app->inputTrace = trace;
+  print("Recording input trace to '{}'", filepath);
+  return true;
+}
+
+bool StartInputTraceReplay(App* app, String filepath, InputTraceReplaySpeed speed)
+{
+  auto trace = app->persistentApplicationArena.allocate<InputTrace>();
+  auto file = ts::fs::read(app->persistentApplicationArena, filepath);
+  if (!file) {
+    print("Failed to read input trace '{}'", filepath);
+    return false;
+  }
+
+  size_t headerSize = sizeof(INPUT_TRACE_MAGIC) + 2 * sizeof(uint32_t);
+  uint32_t version;
+  uint32_t eventSize;
+  if (file->length < headerSize || memcmp(file->data, INPUT_TRACE_MAGIC, sizeof(INPUT_TRACE_MAGIC)) != 0) {
+    print("'{}' is not an input trace", filepath);
+    return false;
+  }
+  memcpy(&version, file->data + sizeof(INPUT_TRACE_MAGIC), sizeof(version));
+  memcpy(&eventSize, file->data + sizeof(INPUT_TRACE_MAGIC) + sizeof(version), sizeof(eventSize));
+  if (version != INPUT_TRACE_VERSION || eventSize != sizeof(SDL_Event)) {
+    print("Input trace '{}' was recorded with an incompatible build", filepath);
+    return false;
+  }
+
+  trace->mode = InputTraceMode::Replay;
+  trace->speed = speed;
+  trace->data = *file;
+  trace->cursor = headerSize;
+  trace->minFrameMs = 1e300;
+  trace->startNs = SDL_GetTicksNS();
+  app->inputTrace = trace;
+  print("Replaying input trace '{}'", filepath);
+  return true;
+}
+
+bool IsReplayingInputTrace(App* app)
+{
+  return app->inputTrace && app->inputTrace->mode == InputTraceMode::Replay;
+}
+
+void RecordInputTraceEvent(App* app, SDL_Event* event)
+{
+  if (!app->inputTrace || app->inputTrace->mode != InputTraceMode::Record) {
+    return;
+  }
+  size_t size = GetInputTraceEventSize(event->type);
+  if (size > 0) {
+    WriteInputTraceRecord(app->inputTrace, InputTraceRecordKind::Event, event, size);
+  }
+}
+
+// Feeds the events of the next frame into the EventHandler. At maximum speed a frame consists of exactly the events
+// that were recorded for it, at original speed all events up to the current time are fed. Returns false once the
+// end of the trace is reached.
+bool ReplayInputTraceFrame(App* app)
+{
+  auto trace = app->inputTrace;
+  trace->eventsThisFrame = 0;
+  uint64_t elapsedNs = SDL_GetTicksNS() - trace->startNs;
+
+  while (trace->cursor + sizeof(InputTraceRecordHeader) <= trace->data.length) {
+    InputTraceRecordHeader header;
+    memcpy(&header, trace->data.data + trace->cursor, sizeof(header));
+    if (trace->speed == InputTraceReplaySpeed::Original && header.timestampNs > elapsedNs) {
+      return true;
+    }
+    trace->cursor += sizeof(header) + header.size;
+    if (trace->cursor > trace->data.length) {
+      print("Input trace is truncated");
+      return false;
+    }
+
+    if (header.kind == (uint16_t)InputTraceRecordKind::FrameEnd) {
+      if (trace->speed == InputTraceReplaySpeed::Maximum) {
+        return true;
+      }
+    } else if (header.kind == (uint16_t)InputTraceRecordKind::Event && app->EventHandler) {
+      SDL_Event event = {};
+      memcpy(&event, trace->data.data + trace->cursor - header.size, min(header.size, sizeof(SDL_Event)));
+      app->EventHandler(app, &event);
+      trace->eventsThisFrame++;
+    }
+  }
+  return trace->eventsThisFrame > 0;
+}
+
+void EndInputTraceFrame(App* app, double frameMs)
+{
+  auto trace = app->inputTrace;
+  if (!trace) {
+    return;
+  }
+  if (trace->mode == InputTraceMode::Record) {
+    WriteInputTraceRecord(trace, InputTraceRecordKind::FrameEnd, 0, 0);
+  } else if (trace->mode == InputTraceMode::Replay) {
+    // The GPU timings are read back NUM_FRAMES later, so they belong to an earlier frame than the counters
+    auto& p = app->lastFrameProfilingResults;
+    auto& c = p.counters;
+    String gpu = format(app->frameArena, "");
+    for (size_t i = 0; i < p.numOfGpuResults; i++) {
+      gpu = format(app->frameArena, "{}{}\"{}\":{}", gpu, i > 0 ? "," : "", p.gpuResults[i].scopeName,
+          p.gpuResults[i].msTaken);
+    }
+    print("{{\"frame\":{},\"events\":{},\"frame_ms\":{},\"draw_calls\":{},\"vertices\":{},\"upload_bytes\":{},"
+          "\"fbo_reallocations\":{},\"shapes_rasterized\":{},\"gpu_ms\":{{{}}}}}",
+        trace->frameNumber, trace->eventsThisFrame, frameMs, c.drawCalls, c.vertices, c.textureUploadBytes,
+        c.fboReallocations, c.shapesRasterized, gpu);
+    trace->frameNumber++;
+    trace->totalFrameMs += frameMs;
+    trace->minFrameMs = min(trace->minFrameMs, frameMs);
+    trace->maxFrameMs = max(trace->maxFrameMs, frameMs);
+    size_t bucket = min((size_t)(frameMs / INPUT_TRACE_HISTOGRAM_BUCKET_MS), INPUT_TRACE_HISTOGRAM_BUCKETS - 1);
+    trace->histogram[bucket]++;
+  }
+}
+
+static double GetInputTraceFramePercentile(InputTrace* trace, double percentile)
+{
+  size_t target = trace->frameNumber * percentile;
+  size_t count = 0;
+  for (size_t i = 0; i < INPUT_TRACE_HISTOGRAM_BUCKETS; i++) {
+    count += trace->histogram[i];
+    if (count > target) {
+      return (i + 1) * INPUT_TRACE_HISTOGRAM_BUCKET_MS;
+    }
+  }
+  return trace->maxFrameMs;
+}
+
+void StopInputTrace(App* app)
+{
+  auto trace = app->inputTrace;
+  if (!trace) {
+    return;
+  }
+  if (trace->mode == InputTraceMode::Record) {
+    fclose(trace->file);
+    trace->file = 0;
+  } else if (trace->mode == InputTraceMode::Replay && trace->frameNumber > 0) {
+    print("{{\"summary\":true,\"frames\":{},\"total_ms\":{},\"mean_ms\":{},\"min_ms\":{},\"p50_ms\":{},\"p95_ms\":{},"
+          "\"p99_ms\":{},\"max_ms\":{}}}",
+        trace->frameNumber, trace->totalFrameMs, trace->totalFrameMs / trace->frameNumber, trace->minFrameMs,
+        GetInputTraceFramePercentile(trace, 0.5), GetInputTraceFramePercentile(trace, 0.95),
+        GetInputTraceFramePercentile(trace, 0.99), trace->maxFrameMs);
+  }
+  trace->mode = InputTraceMode::None;
+  app->inputTrace = 0;
+}
@@ -13,9 +13,31 @@
 #include <signal.h>
 
 #include "hotreload.cpp"
+#include "inputtrace.cpp"
 
 const Vec2 DEFAULT_WINDOW_SIZE = Vec2(1920, 1080);
 
+// The font atlas is owned by the core, so that its glyph cache and texture survive app hot-reloads. The fontstash
+// render callbacks are compiled into the core and stay valid while the app library is swapped.
+static bool LoadFonts(App* app)
+{
+  app->rendererData.fontContext = glfonsCreate(512, 512, FONS_ZERO_TOPLEFT);
+  if (app->rendererData.fontContext == NULL) {
+    print("Could not create stash.\n");
+    return false;
+  }
+
+  app->rendererData.fonts = app->persistentApplicationArena.allocate<int>(1);
+  app->rendererData.numberOfFonts = 0;
+  auto font = fonsAddFont(app->rendererData.fontContext, "RobotoRegular", "resource/Roboto-Regular.ttf");
+  if (font == FONS_INVALID) {
+    print("Could not add font normal.\n");
+    return false;
+  }
+  app->rendererData.fonts[app->rendererData.numberOfFonts++] = font;
+  return true;
+}
+
 static SDL_AppResult AppLoop(App* app)
 {
   app->frameArena.clearAndReinit();
@@ -23,10 +45,23 @@ static SDL_AppResult AppLoop(App* app)
     return result;
   }
 
+  // Replayed events are handled inside the frame, so their handling is part of the measured frame time
+  uint64_t frameStart = SDL_GetTicksNS();
+  if (IsReplayingInputTrace(app) && !ReplayInputTraceFrame(app)) {
+    StopInputTrace(app);
+    return SDL_APP_SUCCESS;
+  }
+
   glClearColor(0, 0, 0, 255);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  if (!app->compileError && app->RenderApp) {
+  // The font atlas is only needed for the UI layout, so loading it is deferred to the first frame
+  if (!app->rendererData.fontContext && !LoadFonts(app)) {
+    return SDL_APP_FAILURE;
+  }
+
+  // A failed rebuild keeps the previous library running, the error is shown in the build log panel
+  if (app->RenderApp) {
     app->RenderApp(app);
   } else {
     glClearColor(255, 0, 0, 255);
@@ -34,6 +69,7 @@ static SDL_AppResult AppLoop(App* app)
   }
 
   SDL_GL_SwapWindow(app->window);
+  EndInputTraceFrame(app, (SDL_GetTicksNS() - frameStart) / 1000000.0);
 
   return SDL_APP_CONTINUE;
 }
@@ -45,9 +81,22 @@ void handleSigint(int)
   terminate = true;
 }
 
-static SDL_AppResult InitApp(App* app)
+static void PrintStartupReport(App* app)
+{
+  auto& report = app->startupReport;
+  print("Startup took {} ms:", (SDL_GetTicksNS() - report.startNs) / 1000000.0);
+  for (size_t i = 0; i < report.numOfPhases; i++) {
+    print("  {}: {} ms", report.phases[i].scopeName, report.phases[i].msTaken);
+  }
+  report.finished = true;
+}
+
+static SDL_AppResult InitApp(App* app, bool hiddenWindow)
 {
-  app->lastHotreloadUpdate = SDL_GetTicks();
+  app->startupReport.startNs = SDL_GetTicksNS();
+  app->startupReport.phaseStartNs = app->startupReport.startNs;
+  startHotreloadWatcher(app);
+  RecordStartupPhase(app, "File watcher");
   SDL_SetAppMetadata("Code Editor", "1.0", "com.example.code-editor");
 
   signal(SIGINT, handleSigint);
@@ -56,13 +105,18 @@ static SDL_AppResult InitApp(App* app)
     SDL_Log("Couldn't initialize SDL: %s", SDL_GetError());
     return SDL_APP_FAILURE;
   }
+  RecordStartupPhase(app, "SDL init");
 
-  app->window = SDL_CreateWindow(
-      "Code Editor", (int)DEFAULT_WINDOW_SIZE.x, (int)DEFAULT_WINDOW_SIZE.y, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+  SDL_WindowFlags windowFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
+  if (hiddenWindow) {
+    windowFlags |= SDL_WINDOW_HIDDEN;
+  }
+  app->window = SDL_CreateWindow("Code Editor", (int)DEFAULT_WINDOW_SIZE.x, (int)DEFAULT_WINDOW_SIZE.y, windowFlags);
   if (!app->window) {
     SDL_Log("Couldn't create window: %s", SDL_GetError());
     return SDL_APP_FAILURE;
   }
+  RecordStartupPhase(app, "Window");
 
   app->rendererData.glContext = SDL_GL_CreateContext(app->window);
   if (!app->rendererData.glContext) {
@@ -79,15 +133,22 @@ static SDL_AppResult InitApp(App* app)
   }
 
   SDL_GL_SetSwapInterval(0);
+  RecordStartupPhase(app, "GL context");
 
-  compileApp(app);
-  if (app->compileError) {
-    return SDL_APP_FAILURE;
+  if (isAppLibUpToDate(app)) {
+    RecordStartupPhase(app, "App build (up to date)");
+  } else {
+    compileApp(app);
+    if (app->compileError) {
+      return SDL_APP_FAILURE;
+    }
+    RecordStartupPhase(app, "App build");
   }
 
   if (!loadAppLib(app)) {
     return SDL_APP_FAILURE;
   }
+  RecordStartupPhase(app, "Load app library");
 
   if (app->LoadApp) {
     app->LoadApp(app, true);
@@ -95,13 +156,22 @@ static SDL_AppResult InitApp(App* app)
     return SDL_APP_FAILURE;
   }
 
+  PrintStartupReport(app);
   return SDL_APP_CONTINUE;
 }
 
 static void DestroyApp(App* app)
 {
+  StopInputTrace(app);
+  stopHotreloadWatcher(app);
+
   if (app->UnloadApp) {
-    app->UnloadApp(app);
+    app->UnloadApp(app, true);
+  }
+
+  if (app->rendererData.fontContext) {
+    glfonsDelete(app->rendererData.fontContext);
+    app->rendererData.fontContext = 0;
   }
 
   SDL_GL_DestroyContext(app->rendererData.glContext);
@@ -112,6 +182,7 @@ static void DestroyApp(App* app)
 
   app->clayArena.free();
   app->frameArena.free();
+  app->buildLogArena.free();
 
   // Shallow copy the arena, because otherwise the method
   // would free its own this pointer
@@ -125,7 +196,40 @@ SDL_AppResult SDL_AppInit(void** _app, int argc, char* argv[])
   *_app = mainArena.allocate<App>();
   ((App*)(*_app))->persistentApplicationArena = mainArena;
   ((App*)(*_app))->frameArena.clearAndReinit();
-  return InitApp((App*)(*_app));
+  App* app = (App*)(*_app);
+
+  Optional<String> recordTracePath;
+  Optional<String> replayTracePath;
+  auto replaySpeed = InputTraceReplaySpeed::Original;
+  bool hiddenWindow = false;
+  for (int i = 1; i < argc; i++) {
+    auto arg = String::view(argv[i]);
+    if (arg == "--record-trace" && i + 1 < argc) {
+      recordTracePath = String::view(argv[++i]);
+    } else if (arg == "--replay-trace" && i + 1 < argc) {
+      replayTracePath = String::view(argv[++i]);
+    } else if (arg == "--replay-max-speed") {
+      replaySpeed = InputTraceReplaySpeed::Maximum;
+    } else if (arg == "--hidden") {
+      hiddenWindow = true;
+    } else {
+      print("Unknown argument '{}'", arg);
+      print("Usage: TechnicalSketcher [--record-trace FILE] [--replay-trace FILE [--replay-max-speed]] [--hidden]");
+      return SDL_APP_FAILURE;
+    }
+  }
+
+  if (auto result = InitApp(app, hiddenWindow); result != SDL_APP_CONTINUE) {
+    return result;
+  }
+
+  if (recordTracePath && !StartInputTraceRecording(app, *recordTracePath)) {
+    return SDL_APP_FAILURE;
+  }
+  if (replayTracePath && !StartInputTraceReplay(app, *replayTracePath, replaySpeed)) {
+    return SDL_APP_FAILURE;
+  }
+  return SDL_APP_CONTINUE;
 }
 
 SDL_AppResult SDL_AppEvent(void* _app, SDL_Event* event)
@@ -134,6 +238,11 @@ SDL_AppResult SDL_AppEvent(void* _app, SDL_Event* event)
   if (event->type == SDL_EVENT_QUIT) {
     return SDL_APP_SUCCESS;
   }
+  if (IsReplayingInputTrace(app)) {
+    // Live input would make the replay non-deterministic
+    return SDL_APP_CONTINUE;
+  }
+  RecordInputTraceEvent(app, event);
   if (app->EventHandler) {
     return app->EventHandler(app, event);
   } else {
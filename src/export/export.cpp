@@ -0,0 +1,66 @@
+// Headless export of a notebook to PDF or PNG, without a window or GL context.
+// It reuses the app unity build like tsk_bench.
+//
+// Usage: tsk_export [--dpi N] [--threads N] file.json output.pdf|output-prefix
+//
+// Output paths ending in ".pdf" produce one multi-page PDF, anything else is used as prefix for "<prefix>-<page>.png".
+
+#include "../app/app.cpp"
+
+const auto EXPORT_USAGE = "Usage: tsk_export [--dpi N] [--threads N] file.json output.pdf|output-prefix";
+
+int main(int argc, char* argv[])
+{
+  Arena mainArena = Arena::create();
+  App* app = mainArena.allocate<App>();
+  app->persistentApplicationArena = mainArena;
+  app->frameArena.clearAndReinit();
+  initAppConstants(app);
+
+  ExportOptions options = { .format = ExportFormat::Png, .outputPath = {}, .dpi = 0, .numberOfThreads = 0 };
+  Optional<String> inputPath;
+  Optional<String> outputPath;
+  for (int i = 1; i < argc; i++) {
+    auto arg = String::view(argv[i]);
+    if (arg == "--dpi" && i + 1 < argc) {
+      options.dpi = ts::strToInt(String::view(argv[++i])).value_or(EXPORT_DEFAULT_DPI);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      options.numberOfThreads = ts::strToInt(String::view(argv[++i])).value_or(0);
+    } else if (arg.startsWith("--")) {
+      ts::print_stderr("Unknown argument '{}'", arg);
+      ts::print_stderr(EXPORT_USAGE);
+      return 1;
+    } else if (!inputPath) {
+      inputPath = arg;
+    } else if (!outputPath) {
+      outputPath = arg;
+    } else {
+      ts::print_stderr(EXPORT_USAGE);
+      return 1;
+    }
+  }
+
+  if (!inputPath || !outputPath) {
+    ts::print_stderr(EXPORT_USAGE);
+    return 1;
+  }
+  if (!ts::fs::exists(*inputPath)) {
+    ts::print_stderr("File '{}' does not exist", *inputPath);
+    return 1;
+  }
+  options.outputPath = *outputPath;
+  if (outputPath->endsWith(".pdf")) {
+    options.format = ExportFormat::Pdf;
+  }
+
+  openDocumentFromFile(app, *inputPath, false);
+  bool succeeded = exportDocument(app, app->documents.back(), options);
+
+  for (auto& document : app->documents) {
+    unloadDocument(app, document);
+  }
+  app->frameArena.free();
+  Arena arena = app->persistentApplicationArena;
+  arena.free();
+  return succeeded ? 0 : 1;
+}
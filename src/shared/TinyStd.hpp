@@ -1168,6 +1168,17 @@ size_t __format_strlen(const char* str);
 void __format_output_stdout(String string);
 void __format_output_stderr(String string);
 
+const auto FLOAT_FORMAT_MAX_LENGTH = 32;
+
+// Writes a round-trip decimal representation, which reads back as exactly the same value (Grisu2). It is almost
+// always the shortest one, but not always: 1e23 is written as 9.999999999999999e+22. The buffer must hold
+// FLOAT_FORMAT_MAX_LENGTH bytes, no null terminator is written. Returns the length.
+size_t formatShortest(double value, char* buffer);
+size_t formatShortest(float value, char* buffer);
+// Like snprintf(buffer, bufferSize, "%.*f", decimals, value), but the null terminator is not guaranteed. Returns the
+// length of the whole result, which was truncated if it is not less than bufferSize.
+size_t formatFixed(double value, int decimals, char* buffer, size_t bufferSize);
+
 const auto DEFAULT_ARENA_SIZE = 16 * 1024 * 1024;
 const auto MAX_PRINT_LINE_LENGTH = 4096;
 
@@ -1216,6 +1227,9 @@ struct Arena {
 
   void free();
   void clearAndReinit();
+
+  // Sum of the bytes handed out by all chunks, useful for measuring allocations
+  [[nodiscard]] size_t bytesUsed() const;
 };
 
 template <size_t Size>
@@ -1324,6 +1338,13 @@ struct StringBuffer {
 
   StringBuffer& append(Arena& arena, String str);
 
+  // Numbers are written directly into the buffer, see formatShortest and formatFixed
+  StringBuffer& appendNumber(Arena& arena, double value);
+
+  StringBuffer& appendNumber(Arena& arena, float value);
+
+  StringBuffer& appendFixed(Arena& arena, double value, int decimals);
+
   [[nodiscard]] String findUntil(String criteria, size_t skip = 0);
 
   void enlarge(Arena& arena, size_t neededSize);
@@ -1523,6 +1544,29 @@ template <typename T> struct List {
     this->length++;
   }
 
+  // Appends `count` elements with a single allocation and a single walk to the end of the list
+  void pushAll(Arena& arena, const T* elements, size_t count)
+  {
+    if (count == 0) {
+      return;
+    }
+    ListElem<T>* nodes = arena.allocate<ListElem<T>>(count);
+    for (size_t i = 0; i < count; i++) {
+      nodes[i].data = elements[i];
+      nodes[i].nextElement = i + 1 < count ? &nodes[i + 1] : 0;
+    }
+    if (!this->firstElement) {
+      this->firstElement = nodes;
+    } else {
+      ListElem<T>* lastElement = this->firstElement;
+      while (lastElement->nextElement) {
+        lastElement = lastElement->nextElement;
+      }
+      lastElement->nextElement = nodes;
+    }
+    this->length += count;
+  }
+
   void clear()
   {
     this->length = 0;
@@ -1809,19 +1853,46 @@ template <> struct formatter<unsigned int> {
   }
 };
 
+// "{}" writes a round-trip representation that reads back as the same value, "{:.2}" or "{:.2f}" writes 2 decimals
+static size_t formatFloatingPoint(
+    double value, bool singlePrecision, String formatArg, char* buffer, size_t remainingBufferSize)
+{
+  if (remainingBufferSize == 0) {
+    return 0;
+  }
+
+  // Fixed output can be arbitrarily long, so it is written directly into the buffer
+  if (formatArg.length >= 3 && formatArg.data[1] == '.') {
+    int decimals = 0;
+    for (size_t i = 2; i < formatArg.length && formatArg.data[i] >= '0' && formatArg.data[i] <= '9'; i++) {
+      decimals = decimals * 10 + (formatArg.data[i] - '0');
+    }
+    size_t length = min(formatFixed(value, decimals, buffer, remainingBufferSize), remainingBufferSize - 1);
+    buffer[length] = '\0';
+    return length;
+  }
+
+  char number[FLOAT_FORMAT_MAX_LENGTH];
+  size_t length = singlePrecision ? formatShortest((float)value, number) : formatShortest(value, number);
+  length = min(length, remainingBufferSize - 1);
+  for (size_t i = 0; i < length; i++) {
+    buffer[i] = number[i];
+  }
+  buffer[length] = '\0';
+  return length;
+}
+
 template <> struct formatter<float> {
   static size_t format(const float& value, String formatArg, char* buffer, size_t remainingBufferSize)
   {
-    __format_vsnprintf(buffer, remainingBufferSize, "%f", value);
-    return __format_strlen(buffer);
+    return formatFloatingPoint(value, true, formatArg, buffer, remainingBufferSize);
   }
 };
 
 template <> struct formatter<double> {
   static size_t format(const double& value, String formatArg, char* buffer, size_t remainingBufferSize)
   {
-    __format_vsnprintf(buffer, remainingBufferSize, "%lf", value);
-    return __format_strlen(buffer);
+    return formatFloatingPoint(value, false, formatArg, buffer, remainingBufferSize);
   }
 };
 
@@ -1841,6 +1912,22 @@ template <> struct formatter<unsigned long> {
   }
 };
 
+template <> struct formatter<long long> {
+  static size_t format(const long long& value, String formatArg, char* buffer, size_t remainingBufferSize)
+  {
+    __format_vsnprintf(buffer, remainingBufferSize, "%lld", value);
+    return __format_strlen(buffer);
+  }
+};
+
+template <> struct formatter<unsigned long long> {
+  static size_t format(const unsigned long long& value, String formatArg, char* buffer, size_t remainingBufferSize)
+  {
+    __format_vsnprintf(buffer, remainingBufferSize, "%llu", value);
+    return __format_strlen(buffer);
+  }
+};
+
 template <> struct formatter<short> {
   static size_t format(const short& value, String formatArg, char* buffer, size_t remainingBufferSize)
   {
@@ -2455,7 +2542,7 @@ struct Subprocess {
     StringBuffer stderr;
   };
 
-  static Result<Subprocess, String> create(List<String> args)
+  static Result<Subprocess, String> create(List<String> args, int options = subprocess_option_inherit_environment)
   {
     StackArena<1024> arena;
     const char** cmds = arena.allocate<const char*>(args.length + 1);
@@ -2465,7 +2552,7 @@ struct Subprocess {
     cmds[args.length] = NULL;
 
     Subprocess process;
-    int result = subprocess_create(cmds, subprocess_option_inherit_environment, &process.subprocess);
+    int result = subprocess_create(cmds, options, &process.subprocess);
     if (0 != result) {
       return String::view(strerror(errno));
     }
@@ -2510,7 +2597,7 @@ struct Subprocess {
       return String::view(strerror(errno));
     }
 
-    return { { .exitCode = 0, .stdout = stdout, .stderr = stderr } };
+    return { { .exitCode = (size_t)return_code, .stdout = stdout, .stderr = stderr } };
   }
 
   FILE* stdin()
@@ -2528,6 +2615,11 @@ struct Subprocess {
     return subprocess_stderr(&subprocess);
   }
 
+  bool alive()
+  {
+    return subprocess_alive(&subprocess) != 0;
+  }
+
   void readStdoutToBuffer(Arena& arena, StringBuffer& stringBuffer);
   void writeToStdin(String str);
 };
@@ -2647,6 +2739,18 @@ void Arena::clearAndReinit()
   }
 }
 
+// NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
+size_t Arena::bytesUsed() const
+{
+  size_t used = 0;
+  ArenaChunk* current = this->firstChunk;
+  while (current) {
+    used += current->used;
+    current = current->nextChunk;
+  }
+  return used;
+}
+
 // NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
 String String::concat(Arena& arena, String other)
 {
@@ -2846,6 +2950,42 @@ StringBuffer& StringBuffer::append(Arena& arena, String str)
   return *this;
 }
 
+// NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
+StringBuffer& StringBuffer::appendNumber(Arena& arena, double value)
+{
+  if (this->capacity < this->length + FLOAT_FORMAT_MAX_LENGTH) {
+    this->enlarge(arena, this->length + FLOAT_FORMAT_MAX_LENGTH);
+  }
+  this->length += formatShortest(value, this->data + this->length);
+  return *this;
+}
+
+// NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
+StringBuffer& StringBuffer::appendNumber(Arena& arena, float value)
+{
+  if (this->capacity < this->length + FLOAT_FORMAT_MAX_LENGTH) {
+    this->enlarge(arena, this->length + FLOAT_FORMAT_MAX_LENGTH);
+  }
+  this->length += formatShortest(value, this->data + this->length);
+  return *this;
+}
+
+// NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
+StringBuffer& StringBuffer::appendFixed(Arena& arena, double value, int decimals)
+{
+  if (this->capacity < this->length + FLOAT_FORMAT_MAX_LENGTH) {
+    this->enlarge(arena, this->length + FLOAT_FORMAT_MAX_LENGTH);
+  }
+  size_t length = formatFixed(value, decimals, this->data + this->length, this->capacity - this->length);
+  if (length >= this->capacity - this->length) {
+    // Large values: Written again with the exact length, snprintf needs space for its null terminator
+    this->enlarge(arena, this->length + length + 1);
+    length = formatFixed(value, decimals, this->data + this->length, this->capacity - this->length);
+  }
+  this->length += length;
+  return *this;
+}
+
 String StringBuffer::findUntil(String criteria, size_t skip)
 {
   char* ptr = this->data + skip;
@@ -2894,6 +3034,380 @@ void __format_vsnprintf(char* buffer, size_t bufferSize, const char* format, ...
   va_end(args);
 }
 
+// Grisu2 as described by Florian Loitsch in "Printing Floating-Point Numbers Quickly and Accurately with Integers"
+// (PLDI 2010). A DiyFp is f * 2^e with a 64-bit significand.
+struct __DiyFp {
+  uint64_t f;
+  int e;
+};
+
+struct __CachedPower {
+  uint64_t f;
+  int e;
+  int k;
+};
+
+// Normalized powers 10^k for k = -300, -292, ..., 340
+const __CachedPower __CACHED_POWERS[] = {
+  { 0xAB70FE17C79AC6CA, -1060, -300 },
+  { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+  { 0xBE5691EF416BD60C, -1007, -284 },
+  { 0x8DD01FAD907FFC3C, -980, -276 },
+  { 0xD3515C2831559A83, -954, -268 },
+  { 0x9D71AC8FADA6C9B5, -927, -260 },
+  { 0xEA9C227723EE8BCB, -901, -252 },
+  { 0xAECC49914078536D, -874, -244 },
+  { 0x823C12795DB6CE57, -847, -236 },
+  { 0xC21094364DFB5637, -821, -228 },
+  { 0x9096EA6F3848984F, -794, -220 },
+  { 0xD77485CB25823AC7, -768, -212 },
+  { 0xA086CFCD97BF97F4, -741, -204 },
+  { 0xEF340A98172AACE5, -715, -196 },
+  { 0xB23867FB2A35B28E, -688, -188 },
+  { 0x84C8D4DFD2C63F3B, -661, -180 },
+  { 0xC5DD44271AD3CDBA, -635, -172 },
+  { 0x936B9FCEBB25C996, -608, -164 },
+  { 0xDBAC6C247D62A584, -582, -156 },
+  { 0xA3AB66580D5FDAF6, -555, -148 },
+  { 0xF3E2F893DEC3F126, -529, -140 },
+  { 0xB5B5ADA8AAFF80B8, -502, -132 },
+  { 0x87625F056C7C4A8B, -475, -124 },
+  { 0xC9BCFF6034C13053, -449, -116 },
+  { 0x964E858C91BA2655, -422, -108 },
+  { 0xDFF9772470297EBD, -396, -100 },
+  { 0xA6DFBD9FB8E5B88F, -369, -92 },
+  { 0xF8A95FCF88747D94, -343, -84 },
+  { 0xB94470938FA89BCF, -316, -76 },
+  { 0x8A08F0F8BF0F156B, -289, -68 },
+  { 0xCDB02555653131B6, -263, -60 },
+  { 0x993FE2C6D07B7FAC, -236, -52 },
+  { 0xE45C10C42A2B3B06, -210, -44 },
+  { 0xAA242499697392D3, -183, -36 },
+  { 0xFD87B5F28300CA0E, -157, -28 },
+  { 0xBCE5086492111AEB, -130, -20 },
+  { 0x8CBCCC096F5088CC, -103, -12 },
+  { 0xD1B71758E219652C, -77, -4 },
+  { 0x9C40000000000000, -50, 4 },
+  { 0xE8D4A51000000000, -24, 12 },
+  { 0xAD78EBC5AC620000, 3, 20 },
+  { 0x813F3978F8940984, 30, 28 },
+  { 0xC097CE7BC90715B3, 56, 36 },
+  { 0x8F7E32CE7BEA5C70, 83, 44 },
+  { 0xD5D238A4ABE98068, 109, 52 },
+  { 0x9F4F2726179A2245, 136, 60 },
+  { 0xED63A231D4C4FB27, 162, 68 },
+  { 0xB0DE65388CC8ADA8, 189, 76 },
+  { 0x83C7088E1AAB65DB, 216, 84 },
+  { 0xC45D1DF942711D9A, 242, 92 },
+  { 0x924D692CA61BE758, 269, 100 },
+  { 0xDA01EE641A708DEA, 295, 108 },
+  { 0xA26DA3999AEF774A, 322, 116 },
+  { 0xF209787BB47D6B85, 348, 124 },
+  { 0xB454E4A179DD1877, 375, 132 },
+  { 0x865B86925B9BC5C2, 402, 140 },
+  { 0xC83553C5C8965D3D, 428, 148 },
+  { 0x952AB45CFA97A0B3, 455, 156 },
+  { 0xDE469FBD99A05FE3, 481, 164 },
+  { 0xA59BC234DB398C25, 508, 172 },
+  { 0xF6C69A72A3989F5C, 534, 180 },
+  { 0xB7DCBF5354E9BECE, 561, 188 },
+  { 0x88FCF317F22241E2, 588, 196 },
+  { 0xCC20CE9BD35C78A5, 614, 204 },
+  { 0x98165AF37B2153DF, 641, 212 },
+  { 0xE2A0B5DC971F303A, 667, 220 },
+  { 0xA8D9D1535CE3B396, 694, 228 },
+  { 0xFB9B7CD9A4A7443C, 720, 236 },
+  { 0xBB764C4CA7A44410, 747, 244 },
+  { 0x8BAB8EEFB6409C1A, 774, 252 },
+  { 0xD01FEF10A657842C, 800, 260 },
+  { 0x9B10A4E5E9913129, 827, 268 },
+  { 0xE7109BFBA19C0C9D, 853, 276 },
+  { 0xAC2820D9623BF429, 880, 284 },
+  { 0x80444B5E7AA7CF85, 907, 292 },
+  { 0xBF21E44003ACDD2D, 933, 300 },
+  { 0x8E679C2F5E44FF8F, 960, 308 },
+  { 0xD433179D9C8CB841, 986, 316 },
+  { 0x9E19DB92B4E31BA9, 1013, 324 },
+  { 0xEB96BF6EBADF77D9, 1039, 332 },
+  { 0xAF87023B9BF0EE6B, 1066, 340 },
+};
+
+const int __GRISU_ALPHA = -60;
+const int __GRISU_GAMMA = -32;
+const int __CACHED_POWERS_MIN_DECIMAL_EXPONENT = -300;
+const int __CACHED_POWERS_DECIMAL_STEP = 8;
+
+static __DiyFp __diyFpMultiply(__DiyFp x, __DiyFp y)
+{
+  uint64_t xLo = x.f & 0xFFFFFFFFu;
+  uint64_t xHi = x.f >> 32;
+  uint64_t yLo = y.f & 0xFFFFFFFFu;
+  uint64_t yHi = y.f >> 32;
+  uint64_t p0 = xLo * yLo;
+  uint64_t p1 = xLo * yHi;
+  uint64_t p2 = xHi * yLo;
+  uint64_t p3 = xHi * yHi;
+  uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu) + (1ull << 31);
+  return { p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32), x.e + y.e + 64 };
+}
+
+static __DiyFp __diyFpNormalize(__DiyFp x)
+{
+  while ((x.f >> 63) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+// The value and the two boundaries halfway to its neighbours, all normalized to the same exponent
+static void __computeBoundaries(
+    uint64_t significand, int exponent, bool lowerBoundaryIsCloser, __DiyFp& minus, __DiyFp& value, __DiyFp& plus)
+{
+  plus = __diyFpNormalize({ (significand << 1) + 1, exponent - 1 });
+  minus = lowerBoundaryIsCloser ? __DiyFp { (significand << 2) - 1, exponent - 2 }
+                                : __DiyFp { (significand << 1) - 1, exponent - 1 };
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+  value = __diyFpNormalize({ significand, exponent });
+}
+
+static void __grisuRound(char* buffer, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t tenK)
+{
+  while (rest < distance && delta - rest >= tenK
+      && (rest + tenK < distance || distance - rest > rest + tenK - distance)) {
+    buffer[length - 1]--;
+    rest += tenK;
+  }
+}
+
+// Generates the digits of a number between minus and plus that is closest to value
+static void __grisuDigits(char* buffer, int& length, int& decimalExponent, __DiyFp minus, __DiyFp value, __DiyFp plus)
+{
+  uint64_t delta = plus.f - minus.f;
+  uint64_t distance = plus.f - value.f;
+  int shift = -plus.e;
+  uint64_t one = 1ull << shift;
+  uint32_t integral = (uint32_t)(plus.f >> shift);
+  uint64_t fractional = plus.f & (one - 1);
+
+  uint32_t pow10 = 1;
+  int numberOfDigits = 1;
+  while (numberOfDigits < 10 && integral / pow10 >= 10) {
+    pow10 *= 10;
+    numberOfDigits++;
+  }
+
+  for (int n = numberOfDigits; n > 0; n--) {
+    buffer[length++] = (char)('0' + integral / pow10);
+    integral %= pow10;
+    uint64_t rest = ((uint64_t)integral << shift) + fractional;
+    if (rest <= delta) {
+      decimalExponent += n - 1;
+      __grisuRound(buffer, length, distance, delta, rest, (uint64_t)pow10 << shift);
+      return;
+    }
+    pow10 /= 10;
+  }
+
+  int fractionalDigits = 0;
+  while (true) {
+    fractional *= 10;
+    delta *= 10;
+    distance *= 10;
+    buffer[length++] = (char)('0' + (fractional >> shift));
+    fractional &= one - 1;
+    fractionalDigits++;
+    if (fractional <= delta) {
+      break;
+    }
+  }
+  decimalExponent -= fractionalDigits;
+  __grisuRound(buffer, length, distance, delta, fractional, one);
+}
+
+static size_t __writeExponent(char* buffer, int exponent)
+{
+  size_t length = 0;
+  buffer[length++] = 'e';
+  buffer[length++] = exponent < 0 ? '-' : '+';
+  exponent = exponent < 0 ? -exponent : exponent;
+  if (exponent >= 100) {
+    buffer[length++] = (char)('0' + exponent / 100);
+    exponent %= 100;
+  }
+  buffer[length++] = (char)('0' + exponent / 10);
+  buffer[length++] = (char)('0' + exponent % 10);
+  return length;
+}
+
+// Formats digits * 10^decimalExponent like %g does, with as many digits as needed
+static size_t __formatDigits(char* buffer, const char* digits, int numberOfDigits, int decimalExponent)
+{
+  const int maxFixedExponent = 17;
+  const int minFixedExponent = -5;
+  int point = numberOfDigits + decimalExponent;
+  size_t length = 0;
+
+  if (numberOfDigits <= point && point <= maxFixedExponent) {
+    // 1234e2 -> 123400
+    memcpy(buffer, digits, numberOfDigits);
+    memset(buffer + numberOfDigits, '0', point - numberOfDigits);
+    return point;
+  }
+  if (0 < point && point <= maxFixedExponent) {
+    // 1234e-2 -> 12.34
+    memcpy(buffer, digits, point);
+    buffer[point] = '.';
+    memcpy(buffer + point + 1, digits + point, numberOfDigits - point);
+    return numberOfDigits + 1;
+  }
+  if (minFixedExponent < point && point <= 0) {
+    // 1234e-6 -> 0.001234
+    buffer[length++] = '0';
+    buffer[length++] = '.';
+    memset(buffer + length, '0', -point);
+    length += -point;
+    memcpy(buffer + length, digits, numberOfDigits);
+    return length + numberOfDigits;
+  }
+  // 1234e30 -> 1.234e+33
+  buffer[length++] = digits[0];
+  if (numberOfDigits > 1) {
+    buffer[length++] = '.';
+    memcpy(buffer + length, digits + 1, numberOfDigits - 1);
+    length += numberOfDigits - 1;
+  }
+  return length + __writeExponent(buffer + length, point - 1);
+}
+
+static size_t __formatShortest(
+    bool negative, uint64_t significand, int exponent, bool isZero, bool lowerBoundaryIsCloser, char* buffer)
+{
+  size_t length = 0;
+  if (negative) {
+    buffer[length++] = '-';
+  }
+  if (isZero) {
+    buffer[length++] = '0';
+    return length;
+  }
+
+  __DiyFp minus, value, plus;
+  __computeBoundaries(significand, exponent, lowerBoundaryIsCloser, minus, value, plus);
+
+  int f = __GRISU_ALPHA - plus.e - 1;
+  int k = (f * 78913) / (1 << 18) + (f > 0);
+  int index = (-__CACHED_POWERS_MIN_DECIMAL_EXPONENT + k + (__CACHED_POWERS_DECIMAL_STEP - 1))
+      / __CACHED_POWERS_DECIMAL_STEP;
+  __CachedPower cached = __CACHED_POWERS[index];
+  __DiyFp power = { cached.f, cached.e };
+
+  __DiyFp scaledValue = __diyFpMultiply(value, power);
+  __DiyFp scaledMinus = __diyFpMultiply(minus, power);
+  __DiyFp scaledPlus = __diyFpMultiply(plus, power);
+  scaledMinus.f++;
+  scaledPlus.f--;
+
+  char digits[20];
+  int numberOfDigits = 0;
+  int decimalExponent = -cached.k;
+  __grisuDigits(digits, numberOfDigits, decimalExponent, scaledMinus, scaledValue, scaledPlus);
+  return length + __formatDigits(buffer + length, digits, numberOfDigits, decimalExponent);
+}
+
+// NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
+size_t formatShortest(double value, char* buffer)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint64_t fraction = bits & ((1ull << 52) - 1);
+  int biasedExponent = (int)((bits >> 52) & 0x7FF);
+  bool negative = bits >> 63;
+  if (biasedExponent == 0x7FF) {
+    const char* str = fraction != 0 ? "nan" : negative ? "-inf" : "inf";
+    size_t length = strlen(str);
+    memcpy(buffer, str, length);
+    return length;
+  }
+  if (biasedExponent == 0) {
+    return __formatShortest(negative, fraction, -1074, fraction == 0, false, buffer);
+  }
+  return __formatShortest(
+      negative, fraction | (1ull << 52), biasedExponent - 1075, false, fraction == 0 && biasedExponent > 1, buffer);
+}
+
+// NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
+size_t formatShortest(float value, char* buffer)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t fraction = bits & ((1u << 23) - 1);
+  int biasedExponent = (int)((bits >> 23) & 0xFF);
+  bool negative = bits >> 31;
+  if (biasedExponent == 0xFF) {
+    const char* str = fraction != 0 ? "nan" : negative ? "-inf" : "inf";
+    size_t length = strlen(str);
+    memcpy(buffer, str, length);
+    return length;
+  }
+  if (biasedExponent == 0) {
+    return __formatShortest(negative, fraction, -149, fraction == 0, false, buffer);
+  }
+  return __formatShortest(
+      negative, fraction | (1u << 23), biasedExponent - 150, false, fraction == 0 && biasedExponent > 1, buffer);
+}
+
+// NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
+size_t formatFixed(double value, int decimals, char* buffer, size_t bufferSize)
+{
+  const uint64_t POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+  double magnitude = value < 0 ? -value : value;
+
+  // Values that fit into an integer after scaling are written directly, everything else goes through printf
+  if (decimals < 0 || decimals > 9 || !(magnitude * POWERS_OF_TEN[decimals] < 9e15) || bufferSize < FLOAT_FORMAT_MAX_LENGTH) {
+    int length = snprintf(buffer, bufferSize, "%.*f", decimals, value);
+    return length > 0 ? (size_t)length : 0;
+  }
+
+  // Rounded like printf, half to even on the exact value. The product is rounded itself, so its error is taken into
+  // account as well: fma gives it exactly, and the sign of (fraction - 0.5) + error decides
+  double product = magnitude * POWERS_OF_TEN[decimals];
+  double error = fma(magnitude, (double)POWERS_OF_TEN[decimals], -product);
+  double integer = floor(product);
+  double above = (product - integer - 0.5) + error;
+  uint64_t scaled = (uint64_t)integer;
+  if (above > 0 || (above == 0 && (scaled & 1))) {
+    scaled++;
+  }
+  uint64_t integral = scaled / POWERS_OF_TEN[decimals];
+  uint64_t fractional = scaled % POWERS_OF_TEN[decimals];
+  char digits[20];
+  int numberOfDigits = 0;
+  do {
+    digits[numberOfDigits++] = (char)('0' + integral % 10);
+    integral /= 10;
+  } while (integral > 0);
+
+  // Like printf, the sign is kept when the value rounds to zero
+  size_t length = 0;
+  if (signbit(value)) {
+    buffer[length++] = '-';
+  }
+  while (numberOfDigits > 0) {
+    buffer[length++] = digits[--numberOfDigits];
+  }
+  if (decimals > 0) {
+    buffer[length++] = '.';
+    for (int i = decimals - 1; i >= 0; i--) {
+      buffer[length + i] = (char)('0' + fractional % 10);
+      fractional /= 10;
+    }
+    length += decimals;
+  }
+  return length;
+}
+
 // NOLINTNEXTLINE(misc-definitions-in-headers) -> Implementation Macro is used
 size_t __format_strlen(const char* str)
 {
@@ -24,4 +24,15 @@ bool Page::overlapsWithViewport(App* app)
     return true;
   }
   return false;
-}
\ No newline at end of file
+}
+
+void RecordStartupPhase(App* app, const char* name)
+{
+  auto& report = app->startupReport;
+  if (report.finished || report.numOfPhases >= report.phases.length()) {
+    return;
+  }
+  uint64_t now = SDL_GetTicksNS();
+  report.phases[report.numOfPhases++] = { .scopeName = name, .msTaken = (now - report.phaseStartNs) / 1000000.0 };
+  report.phaseStartNs = now;
+}
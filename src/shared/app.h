@@ -35,6 +35,12 @@ enum class Tool {
   Pen,
 };
 
+enum class PaperStyle {
+  Squared = 0,
+  Lined = 1,
+  Dotted = 2,
+};
+
 struct resvg_options;
 
 struct SamplePoint {
@@ -66,12 +72,59 @@ struct Page {
   bool overlapsWithViewport(App* app);
 };
 
+// Append-only log of the changes since the last snapshot of a document, see journal.cpp
+struct DocumentJournal {
+  FILE* file = {};             // Opened on the first append, or when the journal is rewritten
+  bool disabled = {};          // Nothing is written next to documents that the headless tools open
+  uint64_t nextSequence = {};
+  size_t unsyncedRecords = {};
+  uint64_t lastSyncNs = {};
+  size_t recordsSinceSnapshot = {};
+  uint64_t lastSnapshotNs = {};
+};
+
+struct DocumentSnapshot;
+
+// State of the background save of a document, see snapshot.cpp
+// Written by a worker thread. It lives in the job's own allocation, because documents move when app->documents grows.
+struct BackgroundJobStatus {
+  SDL_AtomicInt progressPermille;
+  SDL_AtomicInt finished;
+};
+
+struct DocumentSave {
+  SDL_Thread* thread = {};
+  DocumentSnapshot* snapshot = {};
+  BackgroundJobStatus* status = {}; // Part of the snapshot, valid while the thread runs
+  bool requested = {};
+  String requestedFilepath = {};
+  double lastDurationMs = {};
+  bool lastSaveFailed = {};
+};
+
+struct DocumentExport;
+
+// State of the background export of a document, see pageexport.cpp
+struct DocumentBackgroundExport {
+  SDL_Thread* thread = {};
+  DocumentExport* job = {};
+  BackgroundJobStatus* status = {}; // Part of the job, valid while the thread runs
+  double lastDurationMs = {};
+  bool lastExportFailed = {};
+};
+
 struct Document {
+  String filepath = {};
+  DocumentJournal journal = {};
+  DocumentSave save = {};
+  DocumentBackgroundExport backgroundExport = {};
   float zoomMmPerPx = {};
   int pageScroll = {};
   Vec2 position = {};
   List<Page> pages = {};
   Color paperColor = {};
+  PaperStyle paperStyle = {};
+  float gridSpacingMm = {};
   LineShape currentLine;
   Arena arena;
 };
@@ -82,12 +135,13 @@ struct ClayVideoDemo_Arena {
 };
 
 struct UICache;
+struct InputTrace;
 
 struct App;
 typedef SDL_AppResult (*EventHandler_t)(App* app, SDL_Event* event);
 typedef void (*LoadApp_t)(App* app, bool firstLoad);
 typedef void (*RenderApp_t)(App* app);
-typedef void (*UnloadApp_t)(App* app);
+typedef void (*UnloadApp_t)(App* app, bool lastUnload);
 
 struct App {
   // Actual application data
@@ -115,8 +169,15 @@ struct App {
 
   // Hotreloading and UI stuff
   RendererData rendererData;
-  uint64_t lastHotreloadUpdate;
   bool compileError;
+  bool buildRunning;
+  bool buildRestartPending;
+  ts::Subprocess buildProcess;
+  uint64_t buildStartNs;
+  Arena buildLogArena;
+  ts::StringBuffer buildLog;
+  double lastCompileMs;
+  double lastReloadSwapMs;
   void* appLibraryHandle;
   EventHandler_t EventHandler;
   LoadApp_t LoadApp;
@@ -124,7 +185,9 @@ struct App {
   UnloadApp_t UnloadApp;
   UICache* uiCache;
   Clay_Context* clayContext;
-  List<Pair<String, time_t>> fileModificationDates;
+  FileWatcher* hotreloadWatcher;
+  size_t appSourceWatchId;
+  InputTrace* inputTrace;
   SDL_Window* window;
   Vec2 windowSize;
   Clay_BoundingBox mainViewportBB;
@@ -143,27 +206,77 @@ struct App {
   SDL_GLContext glContext;
   GLuint mainShader;
   GLuint lineshapeShader;
+  GLuint paperShader;
+  GLuint paperVAO;
   GLuint mainViewportVAO;
   GLuint mainViewportVBO;
   GLuint mainViewportIBO;
   GLuint mainViewportRBO;
   GLuint mainViewportTEX;
+  gl::StreamBuffer mainViewportStreamVBO;
+  gl::StreamBuffer mainViewportStreamIBO;
 
   // SVG
   resvg_options* svgOpts;
 
+  // Version tags of the resources that are kept alive across hot-reloads, 0 means not loaded
+  struct ResourceVersions {
+    uint64_t shaders;
+    uint32_t gpuBuffers;
+    uint32_t svgOptions;
+  };
+  ResourceVersions loadedResourceVersions;
+
   // Profiling
   struct Profiler {
     struct Result {
       const char* scopeName;
       double msTaken;
     };
+    struct Counters {
+      size_t drawCalls;
+      size_t vertices;
+      size_t textureUploadBytes;
+      size_t fboReallocations;
+      size_t shapesRasterized;
+    };
     ts::Array<Result, 100> results;
     size_t numOfResults;
+    ts::Array<Result, 16> gpuResults;
+    size_t numOfGpuResults;
+    Counters counters;
     double frametimeMs;
   };
   Profiler lastFrameProfilingResults;
   Profiler currentProfilingResults;
+
+  // GL_TIME_ELAPSED queries, one set per frame in flight. A set is read back right before it is reused, so the GPU
+  // timings lag behind the CPU timings by a frame but never stall the pipeline. Results that are still not available
+  // by then are dropped.
+  struct GpuProfiler {
+    static const size_t NUM_FRAMES = 2;
+    static const size_t MAX_QUERIES_PER_FRAME = 512;
+    GLuint queries[NUM_FRAMES][MAX_QUERIES_PER_FRAME];
+    const char* scopeNames[NUM_FRAMES][MAX_QUERIES_PER_FRAME];
+    size_t numQueries[NUM_FRAMES];
+    size_t currentFrame;
+    bool queryActive;
+  };
+  GpuProfiler gpuProfiler;
+  bool showRenderStats;
+
+  // Durations of the startup phases, printed once the first LoadApp is done
+  struct StartupReport {
+    ts::Array<Profiler::Result, 24> phases;
+    size_t numOfPhases;
+    uint64_t startNs;
+    uint64_t phaseStartNs;
+    bool finished;
+  };
+  StartupReport startupReport;
 };
 
+// Records the time since the previous phase (or the start) under the given name. Does nothing after startup.
+void RecordStartupPhase(App* app, const char* name);
+
 #endif // APP_H
\ No newline at end of file
@@ -117,8 +117,8 @@ struct Texture {
 };
 
 struct Framebuffer {
-  GLuint fbo;
-  GLuint tex;
+  GLuint fbo = {};
+  GLuint tex = {};
 
   static Framebuffer create()
   {
@@ -183,6 +183,149 @@ struct Framebuffer {
   }
 };
 
+// Ring buffer for geometry that is regenerated every frame. The storage is split into one segment per frame in
+// flight. With GL 4.4 the whole buffer is persistently mapped and a fence guards each segment, otherwise the store
+// is orphaned whenever the ring wraps around and every allocation maps its own unsynchronized range.
+struct StreamBuffer {
+  static const size_t NUM_SEGMENTS = 3;
+
+  GLenum target = {};
+  GLuint buffer = {};
+  size_t segmentSize = {};
+  size_t currentSegment = {};
+  size_t cursor = {};
+  bool persistent = {};
+  uint8_t* persistentData = {};
+  bool rangeMapped = {};
+  GLsync fences[NUM_SEGMENTS] = {};
+
+  static StreamBuffer create(GLenum target, size_t segmentSize)
+  {
+    StreamBuffer stream;
+    stream.target = target;
+    stream.persistent = GLAD_GL_VERSION_4_4;
+    stream.allocateStorage(segmentSize);
+    return stream;
+  }
+
+  void beginFrame()
+  {
+    assert(!rangeMapped);
+    currentSegment = (currentSegment + 1) % NUM_SEGMENTS;
+    cursor = 0;
+    if (persistent) {
+      waitForSegment(currentSegment);
+    } else if (currentSegment == 0) {
+      glBindBuffer(target, buffer);
+      glBufferData(target, segmentSize * NUM_SEGMENTS, NULL, GL_STREAM_DRAW);
+    }
+  }
+
+  // Returns writable memory for `count` elements and the index of the first element within the buffer, so that
+  // it can be passed directly as a base vertex or index offset. Without persistent mapping, flush() must be
+  // called before the data is used and before the next allocation.
+  template <typename T> T* allocate(size_t count, size_t& firstElement)
+  {
+    assert(!rangeMapped);
+    size_t bytes = count * sizeof(T);
+    size_t segmentStart = currentSegment * segmentSize;
+    size_t offset = (segmentStart + cursor + sizeof(T) - 1) / sizeof(T) * sizeof(T);
+    if (offset + bytes > segmentStart + segmentSize) {
+      allocateStorage(max(segmentSize * 2, bytes + sizeof(T)));
+      segmentStart = 0;
+      offset = 0;
+    }
+    cursor = offset + bytes - segmentStart;
+    firstElement = offset / sizeof(T);
+
+    glBindBuffer(target, buffer);
+    if (persistent) {
+      return (T*)(persistentData + offset);
+    }
+    rangeMapped = true;
+    return (T*)glMapBufferRange(
+        target, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+  }
+
+  void flush()
+  {
+    if (rangeMapped) {
+      glBindBuffer(target, buffer);
+      glUnmapBuffer(target);
+      rangeMapped = false;
+    }
+  }
+
+  void endFrame()
+  {
+    flush();
+    if (persistent) {
+      if (fences[currentSegment]) {
+        glDeleteSync(fences[currentSegment]);
+      }
+      fences[currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+  }
+
+  void free()
+  {
+    flush();
+    for (size_t i = 0; i < NUM_SEGMENTS; i++) {
+      if (fences[i]) {
+        glDeleteSync(fences[i]);
+      }
+      fences[i] = 0;
+    }
+    if (buffer) {
+      if (persistentData) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+      }
+      glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    persistentData = 0;
+  }
+
+private:
+  void waitForSegment(size_t segment)
+  {
+    if (!fences[segment]) {
+      return;
+    }
+    GLenum result;
+    do {
+      result = glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (result == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(fences[segment]);
+    fences[segment] = 0;
+  }
+
+  // Draw calls that already reference the old buffer stay valid, GL only releases it once the GPU is done.
+  void allocateStorage(size_t newSegmentSize)
+  {
+    free();
+    segmentSize = newSegmentSize;
+    currentSegment = 0;
+    cursor = 0;
+    glGenBuffers(1, &buffer);
+    if (!buffer) {
+      ts::panic("Creating GL stream buffer failed");
+    }
+    glBindBuffer(target, buffer);
+    if (persistent) {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(target, segmentSize * NUM_SEGMENTS, NULL, flags);
+      persistentData = (uint8_t*)glMapBufferRange(target, 0, segmentSize * NUM_SEGMENTS, flags);
+      if (!persistentData) {
+        ts::panic("Mapping GL stream buffer failed");
+      }
+    } else {
+      glBufferData(target, segmentSize * NUM_SEGMENTS, NULL, GL_STREAM_DRAW);
+    }
+  }
+};
+
 } // namespace gl
 
 #endif // GL_HPP
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -65,6 +66,19 @@ Result<time_t, SystemError> GetFileModificationDate(String path)
   return fileStat.st_mtime;
 }
 
+bool SyncFileToDisk(FILE* file)
+{
+  if (fflush(file) != 0) {
+    return false;
+  }
+  return fsync(fileno(file)) == 0;
+}
+
+bool RenameFileReplacing(Arena& arena, String from, String to)
+{
+  return rename(from.c_str(arena), to.c_str(arena)) == 0;
+}
+
 Result<List<String>, SystemError> ListDirectory(Arena& arena, String path)
 {
   List<String> list;
@@ -112,4 +126,92 @@ Result<void*, String> LoadLibraryFunc(Arena& arena, void* library, String funcna
 void UnloadLibrary(void* handle)
 {
   dlclose(handle);
-}
\ No newline at end of file
+}
+
+const size_t FILE_WATCH_MAX_WATCHES = 32;
+
+struct FileWatcher {
+  int fd;
+  ts::Array<int, FILE_WATCH_MAX_WATCHES> watchDescriptors;
+  size_t numWatches;
+  FileWatchQueue queue;
+};
+
+static uint64_t GetMonotonicTimeMs()
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+Result<FileWatcher*, SystemError> CreateFileWatcher(Arena& arena, uint64_t debounceMs)
+{
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd == -1) {
+    return (SystemError)errno;
+  }
+  auto watcher = arena.allocate<FileWatcher>();
+  watcher->fd = fd;
+  watcher->numWatches = 0;
+  watcher->queue.numPending = 0;
+  watcher->queue.debounceMs = debounceMs;
+  return watcher;
+}
+
+Result<size_t, SystemError> AddFileWatch(Arena& arena, FileWatcher* watcher, String directory)
+{
+  if (watcher->numWatches >= watcher->watchDescriptors.length()) {
+    return SystemError::ProcessFileLimitReached;
+  }
+  uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+  int wd = inotify_add_watch(watcher->fd, directory.c_str(arena), mask);
+  if (wd == -1) {
+    return (SystemError)errno;
+  }
+  watcher->watchDescriptors[watcher->numWatches] = wd;
+  return watcher->numWatches++;
+}
+
+List<FileWatchEvent> PollFileWatcher(Arena& arena, FileWatcher* watcher)
+{
+  alignas(struct inotify_event) char buffer[4096];
+  uint64_t now = GetMonotonicTimeMs();
+
+  while (true) {
+    ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break; // EAGAIN: Nothing more to read
+    }
+    for (char* ptr = buffer; ptr < buffer + length;) {
+      auto event = (struct inotify_event*)ptr;
+      ptr += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        watcher->queue.pushAllDirectories(watcher->numWatches, now);
+        continue;
+      }
+      if (event->len == 0 || (event->mask & IN_ISDIR)) {
+        continue;
+      }
+      for (size_t i = 0; i < watcher->numWatches; i++) {
+        if (watcher->watchDescriptors[i] == event->wd) {
+          watcher->queue.push(i, event->name, now);
+          break;
+        }
+      }
+    }
+  }
+
+  if (watcher->queue.numPending == 0) {
+    return {};
+  }
+  return watcher->queue.popReady(arena, now);
+}
+
+void DestroyFileWatcher(FileWatcher* watcher)
+{
+  if (watcher->fd != -1) {
+    close(watcher->fd);
+  }
+  watcher->fd = -1;
+  watcher->numWatches = 0;
+}
@@ -4,6 +4,8 @@
 
 #include "../TinyStd.hpp"
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 using ts::Arena;
@@ -45,4 +47,121 @@ enum struct SystemError {
 
 extern void UnloadLibrary(void* handle);
 
+// Flushes the stdio buffer and waits until the OS wrote the file contents to the disk
+[[nodiscard]] extern bool SyncFileToDisk(FILE* file);
+
+// Atomically replaces `to` with `from`, readers either see the old or the new file
+[[nodiscard]] extern bool RenameFileReplacing(Arena& arena, String from, String to);
+
+// File watching: Changes in watched directories are collected by the OS and delivered through PollFileWatcher once
+// a file has not changed for the debounce time, so that editors writing a file in several steps only cause one
+// event. Polling is non-blocking and does not touch the file system when nothing changed.
+
+const size_t FILE_WATCH_MAX_PENDING = 64;
+const size_t FILE_WATCH_MAX_FILENAME = 256;
+
+// An empty filename means that changes were lost and anything in the directory may have changed
+struct FileWatchEvent {
+  size_t watchId;
+  String filename;
+};
+
+// Platform independent debounce queue, used by the platform implementations
+struct FileWatchQueue {
+  struct Pending {
+    size_t watchId;
+    char filename[FILE_WATCH_MAX_FILENAME];
+    uint64_t lastChangeMs;
+  };
+  ts::Array<Pending, FILE_WATCH_MAX_PENDING> pending;
+  size_t numPending;
+  uint64_t debounceMs;
+
+  void push(size_t watchId, const char* filename, uint64_t nowMs)
+  {
+    // Editor swap and backup files are not interesting
+    size_t length = strlen(filename);
+    if (length == 0 || filename[0] == '.' || filename[length - 1] == '~') {
+      return;
+    }
+    for (size_t i = 0; i < numPending; i++) {
+      if (pending[i].watchId == watchId && (pending[i].filename[0] == 0 || strcmp(pending[i].filename, filename) == 0)) {
+        pending[i].lastChangeMs = nowMs;
+        return;
+      }
+    }
+    if (numPending >= pending.length()) {
+      // Queue is full: The pending files are reported as changes of their whole directories, which needs one entry
+      // per watch and leaves room for this one, so the change is still reported
+      size_t numDirectories = 0;
+      for (size_t i = 0; i < numPending; i++) {
+        size_t j = 0;
+        while (j < numDirectories && pending[j].watchId != pending[i].watchId) {
+          j++;
+        }
+        if (j == numDirectories) {
+          pending[numDirectories] = pending[i];
+          pending[numDirectories++].filename[0] = 0;
+        } else if (pending[j].lastChangeMs < pending[i].lastChangeMs) {
+          pending[j].lastChangeMs = pending[i].lastChangeMs;
+        }
+      }
+      numPending = numDirectories;
+      for (size_t i = 0; i < numPending; i++) {
+        if (pending[i].watchId == watchId) {
+          pending[i].lastChangeMs = nowMs;
+          return;
+        }
+      }
+      filename = "";
+    }
+    if (numPending >= pending.length()) {
+      return;
+    }
+    auto& entry = pending[numPending++];
+    entry.watchId = watchId;
+    strncpy(entry.filename, filename, sizeof(entry.filename) - 1);
+    entry.filename[sizeof(entry.filename) - 1] = 0;
+    entry.lastChangeMs = nowMs;
+  }
+
+  // The OS dropped changes: Every watched directory is reported as a whole, which covers all pending files
+  void pushAllDirectories(size_t numWatches, uint64_t nowMs)
+  {
+    numPending = 0;
+    for (size_t i = 0; i < numWatches && numPending < pending.length(); i++) {
+      auto& entry = pending[numPending++];
+      entry.watchId = i;
+      entry.filename[0] = 0;
+      entry.lastChangeMs = nowMs;
+    }
+  }
+
+  List<FileWatchEvent> popReady(Arena& arena, uint64_t nowMs)
+  {
+    List<FileWatchEvent> events;
+    size_t i = 0;
+    while (i < numPending) {
+      if (nowMs - pending[i].lastChangeMs >= debounceMs) {
+        events.push(arena, { pending[i].watchId, String::clone(arena, pending[i].filename) });
+        pending[i] = pending[--numPending];
+      } else {
+        i++;
+      }
+    }
+    return events;
+  }
+};
+
+struct FileWatcher;
+
+[[nodiscard]] extern Result<FileWatcher*, SystemError> CreateFileWatcher(Arena& arena, uint64_t debounceMs);
+
+// Watches the files directly inside of the directory (not recursive). Returns the watch id used in FileWatchEvents.
+[[nodiscard]] extern Result<size_t, SystemError> AddFileWatch(Arena& arena, FileWatcher* watcher, String directory);
+
+[[nodiscard]] extern List<FileWatchEvent> PollFileWatcher(Arena& arena, FileWatcher* watcher);
+
+extern void DestroyFileWatcher(FileWatcher* watcher);
+
 #endif // TSK_PLATFORM_H
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "platform.h"
 
 #include <direct.h>
+#include <io.h>
 
 #undef LoadLibrary
 
@@ -81,6 +82,21 @@ Result<time_t, SystemError> GetFileModificationDate(String path)
   return fileStat.st_mtime;
 }
 
+bool SyncFileToDisk(FILE* file)
+{
+  if (fflush(file) != 0) {
+    return false;
+  }
+  return _commit(_fileno(file)) == 0;
+}
+
+bool RenameFileReplacing(Arena& arena, String from, String to)
+{
+  return MoveFileExW(utf8_to_utf16(arena, from), utf8_to_utf16(arena, to),
+             MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)
+      != 0;
+}
+
 Result<List<String>, SystemError> ListDirectory(Arena& arena, String path)
 {
   List<String> list;
@@ -136,4 +152,105 @@ Result<void*, String> LoadLibraryFunc(Arena& arena, void* library, String funcna
 void UnloadLibrary(void* handle)
 {
   FreeLibrary((HMODULE)handle);
-}
\ No newline at end of file
+}
+
+const size_t FILE_WATCH_MAX_WATCHES = 32;
+
+struct FileWatcher {
+  struct Watch {
+    HANDLE directory;
+    OVERLAPPED overlapped;
+    alignas(DWORD) char buffer[4096];
+  };
+  ts::Array<Watch, FILE_WATCH_MAX_WATCHES> watches;
+  size_t numWatches;
+  FileWatchQueue queue;
+};
+
+static bool IssueDirectoryRead(FileWatcher::Watch& watch)
+{
+  DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+  return ReadDirectoryChangesW(
+      watch.directory, watch.buffer, sizeof(watch.buffer), FALSE, filter, NULL, &watch.overlapped, NULL);
+}
+
+Result<FileWatcher*, SystemError> CreateFileWatcher(Arena& arena, uint64_t debounceMs)
+{
+  auto watcher = arena.allocate<FileWatcher>();
+  watcher->numWatches = 0;
+  watcher->queue.numPending = 0;
+  watcher->queue.debounceMs = debounceMs;
+  return watcher;
+}
+
+Result<size_t, SystemError> AddFileWatch(Arena& arena, FileWatcher* watcher, String directory)
+{
+  if (watcher->numWatches >= watcher->watches.length()) {
+    return SystemError::ProcessFileLimitReached;
+  }
+  auto& watch = watcher->watches[watcher->numWatches];
+  watch.directory = CreateFileW(utf8_to_utf16(arena, directory), FILE_LIST_DIRECTORY,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+      FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+  if (watch.directory == INVALID_HANDLE_VALUE) {
+    return (SystemError)GetLastError();
+  }
+  watch.overlapped = {};
+  watch.overlapped.hEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+  if (!IssueDirectoryRead(watch)) {
+    auto error = GetLastError();
+    CloseHandle(watch.overlapped.hEvent);
+    CloseHandle(watch.directory);
+    return (SystemError)error;
+  }
+  return watcher->numWatches++;
+}
+
+List<FileWatchEvent> PollFileWatcher(Arena& arena, FileWatcher* watcher)
+{
+  uint64_t now = GetTickCount64();
+  for (size_t i = 0; i < watcher->numWatches; i++) {
+    auto& watch = watcher->watches[i];
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(watch.directory, &watch.overlapped, &bytes, FALSE)) {
+      continue; // ERROR_IO_INCOMPLETE: Nothing changed
+    }
+    if (bytes == 0) {
+      // The buffer overflowed and the changes were dropped
+      watcher->queue.pushAllDirectories(watcher->numWatches, now);
+    }
+    char* ptr = watch.buffer;
+    while (bytes > 0) {
+      auto info = (FILE_NOTIFY_INFORMATION*)ptr;
+      StackArena<1024> nameArena;
+      int nameLength = WideCharToMultiByte(
+          CP_UTF8, 0, info->FileName, info->FileNameLength / sizeof(WCHAR), NULL, 0, NULL, NULL);
+      char* name = nameArena.allocate<char>(nameLength + 1);
+      WideCharToMultiByte(
+          CP_UTF8, 0, info->FileName, info->FileNameLength / sizeof(WCHAR), name, nameLength, NULL, NULL);
+      name[nameLength] = 0;
+      watcher->queue.push(i, name, now);
+      if (info->NextEntryOffset == 0) {
+        break;
+      }
+      ptr += info->NextEntryOffset;
+    }
+    IssueDirectoryRead(watch);
+  }
+
+  if (watcher->queue.numPending == 0) {
+    return {};
+  }
+  return watcher->queue.popReady(arena, now);
+}
+
+void DestroyFileWatcher(FileWatcher* watcher)
+{
+  for (size_t i = 0; i < watcher->numWatches; i++) {
+    auto& watch = watcher->watches[i];
+    CancelIo(watch.directory);
+    CloseHandle(watch.overlapped.hEvent);
+    CloseHandle(watch.directory);
+  }
+  watcher->numWatches = 0;
+}